@@ -4,6 +4,7 @@
 
 #include <algorithm>
 #include <cerrno>
+#include <chrono>
 #include <cstring>
 #include <deque>
 #include <fcntl.h>
@@ -17,6 +18,50 @@
 #define IORING_OP_ACCEPT 0
 #define IORING_OP_READ 1
 #define IORING_OP_WRITE 2
+#define IORING_OP_TIMEOUT 3
+#define IORING_OP_SEND_ZC 4
+#define IORING_OP_TIMEOUT_REMOVE 5
+
+// Timeout flags: absolute deadlines are on the steady clock
+#define IORING_TIMEOUT_ABS (1U << 0)
+#define IORING_TIMEOUT_UPDATE (1U << 1)
+
+// Lets tests reach the stub's knobs below
+#define IO_URING_STUB 1
+
+// false: behave like a kernel before 5.11, which rejects timeout updates
+// with -EINVAL
+inline bool io_uring_stub_timeout_update = true;
+
+// Zero-copy sends post the result with F_MORE, then an F_NOTIF completion
+// once the buffer may be reused. Like Linux, they fail with -EOPNOTSUPP on
+// sockets without zero-copy support (Unix domain sockets).
+#define IORING_CQE_F_MORE (1U << 1)
+#define IORING_CQE_F_NOTIF (1U << 3)
+
+// Setup flags. SQPOLL and DEFER_TASKRUN are refused (-EINVAL) so callers
+// exercise their fallbacks; the others are accepted and have no effect.
+#define IORING_SETUP_SQPOLL (1U << 1)
+#define IORING_SETUP_SQ_AFF (1U << 2)
+#define IORING_SETUP_COOP_TASKRUN (1U << 8)
+#define IORING_SETUP_SINGLE_ISSUER (1U << 12)
+#define IORING_SETUP_DEFER_TASKRUN (1U << 13)
+
+#define IOSQE_FIXED_FILE (1U << 0)
+
+struct io_uring_params {
+  uint32_t sq_entries;
+  uint32_t cq_entries;
+  uint32_t flags;
+  uint32_t sq_thread_cpu;
+  uint32_t sq_thread_idle;
+  uint32_t features;
+};
+
+struct __kernel_timespec {
+  int64_t tv_sec;
+  long long tv_nsec;
+};
 
 struct io_uring_sqe {
   uint64_t user_data;
@@ -24,12 +69,15 @@ struct io_uring_sqe {
   int fd;
   uint64_t addr;
   uint32_t len;
+  uint8_t flags;       // IOSQE_FIXED_FILE: `fd` is an index in the file table
+  uint64_t off;        // Timeouts: absolute deadline (steady clock, ns) once submitted
   bool active = false; // Internal: is this slot being used?
 };
 
 struct io_uring_cqe {
   uint64_t user_data;
   int32_t res;
+  uint32_t flags;
 };
 
 struct io_uring {
@@ -37,6 +85,7 @@ struct io_uring {
   std::deque<io_uring_sqe> pending_sqes; // Submitted but not completed
   std::deque<io_uring_cqe> cqes;         // Completed
   unsigned entries;
+  std::vector<int> files; // Registered file table
 };
 
 inline int io_uring_queue_init(unsigned entries, struct io_uring *ring,
@@ -46,6 +95,29 @@ inline int io_uring_queue_init(unsigned entries, struct io_uring *ring,
   return 0;
 }
 
+inline int io_uring_queue_init_params(unsigned entries, struct io_uring *ring,
+                                      struct io_uring_params *p) {
+  if (p->flags & (IORING_SETUP_SQPOLL | IORING_SETUP_DEFER_TASKRUN))
+    return -EINVAL;
+  return io_uring_queue_init(entries, ring, p->flags);
+}
+
+inline int io_uring_register_files(struct io_uring *ring, const int *files,
+                                   unsigned nr_files) {
+  if (!ring->files.empty())
+    return -EBUSY;
+  ring->files.assign(files, files + nr_files);
+  return 0;
+}
+
+inline int io_uring_register_files_update(struct io_uring *ring, unsigned off,
+                                          const int *files, unsigned nr_files) {
+  if (off + nr_files > ring->files.size())
+    return -EINVAL;
+  std::copy(files, files + nr_files, ring->files.begin() + off);
+  return nr_files;
+}
+
 inline void io_uring_queue_exit(struct io_uring *) {}
 
 inline struct io_uring_sqe *io_uring_get_sqe(struct io_uring *ring) {
@@ -53,6 +125,7 @@ inline struct io_uring_sqe *io_uring_get_sqe(struct io_uring *ring) {
   for (auto &sqe : ring->sqes) {
     if (!sqe.active) {
       sqe.active = true;
+      sqe.flags = 0;
       return &sqe;
     }
   }
@@ -94,11 +167,99 @@ inline void io_uring_prep_write(struct io_uring_sqe *sqe, int fd,
   (void)offset;
 }
 
+inline void io_uring_prep_send_zc(struct io_uring_sqe *sqe, int sockfd,
+                                  const void *buf, size_t len, int flags,
+                                  unsigned zc_flags) {
+  sqe->opcode = IORING_OP_SEND_ZC;
+  sqe->fd = sockfd;
+  sqe->addr = (uint64_t)buf;
+  sqe->len = len;
+  (void)flags;
+  (void)zc_flags;
+}
+
+// `count` is ignored; `flags` may hold IORING_TIMEOUT_ABS
+inline void io_uring_prep_timeout(struct io_uring_sqe *sqe,
+                                  struct __kernel_timespec *ts, unsigned count,
+                                  unsigned flags) {
+  sqe->opcode = IORING_OP_TIMEOUT;
+  sqe->fd = -1;
+  sqe->addr = (uint64_t)ts;
+  sqe->len = flags;
+  (void)count;
+}
+
+// Move the pending timeout submitted with `user_data` to `ts`. Completes
+// right away: 0, or -ENOENT if no such timeout is pending.
+inline void io_uring_prep_timeout_update(struct io_uring_sqe *sqe,
+                                         struct __kernel_timespec *ts,
+                                         uint64_t user_data, unsigned flags) {
+  sqe->opcode = IORING_OP_TIMEOUT_REMOVE;
+  sqe->fd = -1;
+  sqe->addr = user_data;
+  sqe->off = (uint64_t)ts;
+  sqe->len = flags | IORING_TIMEOUT_UPDATE;
+}
+
+// Cancel the pending timeout submitted with `user_data`: it completes with
+// -ECANCELED, this request with 0 (or -ENOENT if no such timeout is pending).
+inline void io_uring_prep_timeout_remove(struct io_uring_sqe *sqe,
+                                         uint64_t user_data, unsigned flags) {
+  sqe->opcode = IORING_OP_TIMEOUT_REMOVE;
+  sqe->fd = -1;
+  sqe->addr = user_data;
+  sqe->off = 0;
+  sqe->len = flags;
+}
+
+inline uint64_t io_uring_stub_now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+inline uint64_t io_uring_stub_deadline(const struct __kernel_timespec *ts,
+                                       unsigned flags) {
+  uint64_t ns = ts->tv_sec * 1000000000ULL + ts->tv_nsec;
+  return (flags & IORING_TIMEOUT_ABS) ? ns : io_uring_stub_now_ns() + ns;
+}
+
 inline int io_uring_submit(struct io_uring *ring) {
   // Move active SQEs to pending_sqes
   int submitted = 0;
   for (auto &sqe : ring->sqes) {
     if (sqe.active) {
+      if (sqe.flags & IOSQE_FIXED_FILE) {
+        sqe.fd = ring->files[sqe.fd]; // Resolve the registered file
+      }
+      if (sqe.opcode == IORING_OP_TIMEOUT) {
+        sqe.off = io_uring_stub_deadline((struct __kernel_timespec *)sqe.addr,
+                                         sqe.len);
+      }
+      if (sqe.opcode == IORING_OP_TIMEOUT_REMOVE) {
+        bool update = sqe.len & IORING_TIMEOUT_UPDATE;
+        io_uring_cqe cqe{sqe.user_data, -ENOENT, 0};
+        for (auto it = ring->pending_sqes.begin();
+             it != ring->pending_sqes.end(); ++it) {
+          if (it->opcode != IORING_OP_TIMEOUT || it->user_data != sqe.addr)
+            continue;
+          cqe.res = 0;
+          if (!update) {
+            ring->cqes.push_back({it->user_data, -ECANCELED, 0});
+            ring->pending_sqes.erase(it);
+          } else if (io_uring_stub_timeout_update) {
+            it->off = io_uring_stub_deadline(
+                (struct __kernel_timespec *)sqe.off, sqe.len);
+          }
+          break;
+        }
+        if (update && !io_uring_stub_timeout_update)
+          cqe.res = -EINVAL;
+        ring->cqes.push_back(cqe);
+        sqe.active = false;
+        submitted++;
+        continue;
+      }
       ring->pending_sqes.push_back(sqe);
       sqe.active = false; // Clear slot for reuse
       submitted++;
@@ -141,16 +302,25 @@ inline int io_uring_submit_and_wait(struct io_uring *ring, unsigned wait_nr) {
     for (const auto &sqe : ring->pending_sqes) {
       if (sqe.opcode == IORING_OP_READ || sqe.opcode == IORING_OP_ACCEPT) {
         FD_SET(sqe.fd, &readfds);
-      } else if (sqe.opcode == IORING_OP_WRITE) {
+      } else if (sqe.opcode == IORING_OP_WRITE ||
+                 sqe.opcode == IORING_OP_SEND_ZC) {
         FD_SET(sqe.fd, &writefds);
       }
       if (sqe.fd > max_fd)
         max_fd = sqe.fd;
     }
 
+    // 10ms timeout, or less until the first pending timeout expires
+    uint64_t wait_ns = 10000000;
+    for (const auto &sqe : ring->pending_sqes) {
+      if (sqe.opcode == IORING_OP_TIMEOUT) {
+        uint64_t now = io_uring_stub_now_ns();
+        wait_ns = std::min(wait_ns, sqe.off > now ? sqe.off - now : 0);
+      }
+    }
     struct timeval timeout;
     timeout.tv_sec = 0;
-    timeout.tv_usec = 10000; // 10ms timeout
+    timeout.tv_usec = wait_ns / 1000;
 
     int sel_res = select(max_fd + 1, &readfds, &writefds, nullptr, &timeout);
 
@@ -169,18 +339,35 @@ inline int io_uring_submit_and_wait(struct io_uring *ring, unsigned wait_nr) {
       if (it->opcode == IORING_OP_READ || it->opcode == IORING_OP_ACCEPT) {
         if (FD_ISSET(it->fd, &readfds))
           passed = true;
-      } else if (it->opcode == IORING_OP_WRITE) {
+      } else if (it->opcode == IORING_OP_WRITE ||
+                 it->opcode == IORING_OP_SEND_ZC) {
         if (FD_ISSET(it->fd, &writefds))
           passed = true;
+      } else if (it->opcode == IORING_OP_TIMEOUT) {
+        if (io_uring_stub_now_ns() >= it->off) {
+          passed = true;
+          res = -ETIME;
+        }
       }
 
-      if (passed) {
+      if (passed && it->opcode != IORING_OP_TIMEOUT) {
         if (it->opcode == IORING_OP_ACCEPT) {
           res = ::accept(it->fd, nullptr, nullptr);
         } else if (it->opcode == IORING_OP_READ) {
           res = ::read(it->fd, (void *)it->addr, it->len);
         } else if (it->opcode == IORING_OP_WRITE) {
           res = ::write(it->fd, (void *)it->addr, it->len);
+        } else if (it->opcode == IORING_OP_SEND_ZC) {
+          struct sockaddr_storage addr;
+          socklen_t size = sizeof(addr);
+          addr.ss_family = AF_UNIX;
+          getsockname(it->fd, (struct sockaddr *)&addr, &size);
+          if (addr.ss_family == AF_UNIX) {
+            res = -1;
+            errno = EOPNOTSUPP;
+          } else {
+            res = ::send(it->fd, (void *)it->addr, it->len, MSG_NOSIGNAL);
+          }
         }
 
         if (res < 0) {
@@ -198,6 +385,13 @@ inline int io_uring_submit_and_wait(struct io_uring *ring, unsigned wait_nr) {
         io_uring_cqe cqe;
         cqe.user_data = it->user_data;
         cqe.res = res;
+        cqe.flags = 0;
+        if (it->opcode == IORING_OP_SEND_ZC && res >= 0) {
+          cqe.flags = IORING_CQE_F_MORE;
+          ring->cqes.push_back(cqe);
+          cqe.res = 0;
+          cqe.flags = IORING_CQE_F_NOTIF;
+        }
         ring->cqes.push_back(cqe);
 
         // Remove from pending
@@ -220,6 +414,12 @@ inline int io_uring_submit_and_wait(struct io_uring *ring, unsigned wait_nr) {
                                    : (cqe = nullptr, false));                  \
        head++)
 
+// Completions are produced while waiting, in io_uring_submit_and_wait(), and
+// by timeout updates as they are submitted
+inline unsigned io_uring_cq_ready(const struct io_uring *ring) {
+  return ring->cqes.size();
+}
+
 inline void io_uring_cq_advance(struct io_uring *ring, unsigned count) {
   // Remove 'count' items from front of deque
   for (unsigned i = 0; i < count && !ring->cqes.empty(); ++i) {
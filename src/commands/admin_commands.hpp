@@ -1,32 +1,181 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "../core/command.hpp"
 #include "../core/topology.hpp"
 #include "../persistence/rdb_manager.hpp"
+#include "resp.hpp"
 
 namespace quine {
 namespace commands {
 
+/// @brief SAVE as a Job: writes the snapshot a slice at a time, serving
+/// other requests in between, and replies once the file is complete.
+class SaveJob : public core::Job {
+ public:
+  SaveJob(core::Topology& topology, const std::string& filename)
+      : writer_(topology, filename) {}
+
+  bool resume(std::string& out, Clock::time_point deadline) override {
+    while (!writer_.step(persistence::RdbWriter::BUCKETS_PER_STEP)) {
+      if (Clock::now() >= deadline) return false;
+    }
+    out += writer_.ok() ? "+OK\r\n" : "-ERR failed to save\r\n";
+    return true;
+  }
+
+ private:
+  persistence::RdbWriter writer_;
+};
+
 class SaveCommand : public core::Command {
  public:
   std::string name() const override {
     return "SAVE";
   }
 
+  std::string execute(quine::core::Topology& topology, size_t core_id, uint32_t conn_id,
+                      const std::vector<std::string>& args) override {
+    (void)args;
+    // Time-sliced rather than blocking, but still not a point-in-time
+    // snapshot (in production, use BGSAVE). It also reads ALL shards, which
+    // might race with modifications from other cores: for V1, we assume
+    // light load or acceptable risk.
+    return topology.defer(core_id, conn_id, std::make_unique<SaveJob>(topology, "data/dump.rdb"));
+  }
+};
+
+/// @brief FLUSHALL [ASYNC|SYNC]: drop every key of every shard. Each core
+/// flushes its own shard; with ASYNC, large values are destroyed by the
+/// shards' reclaimers in the background of the event loops.
+class FlushAllCommand : public core::Command {
+ public:
+  std::string name() const override {
+    return "FLUSHALL";
+  }
+
+  std::string execute(quine::core::Topology& topology, size_t core_id, uint32_t conn_id,
+                      const std::vector<std::string>& args) override {
+    (void)conn_id;
+    if (args.size() > 2) return "-ERR syntax error\r\n";
+    bool lazy = false;
+    if (args.size() == 2) {
+      std::string mode = args[1];
+      std::transform(mode.begin(), mode.end(), mode.begin(), ::toupper);
+      if (mode != "ASYNC" && mode != "SYNC") return "-ERR syntax error\r\n";
+      lazy = mode == "ASYNC";
+    }
+
+    if (!topology.is_io_core(core_id)) topology.get_shard(core_id)->flush(lazy);
+    topology.flush_all_shards(core_id, lazy);
+    return "+OK\r\n";
+  }
+};
+
+/// @brief INFO [clients|memory|eventloop|all]: client connections per core;
+/// memory accounting from the per-shard slab allocators (the bytes handed
+/// out (`used_memory`), the bytes obtained from the system
+/// (`allocated_memory`), their ratio (`mem_fragmentation_ratio`), the
+/// maxmemory limit, the values awaiting lazy freeing and a per-core
+/// breakdown); and the event loops' busy-poll counters and load (queued
+/// requests, lag, requests shed with -BUSY). Read on the receiving core,
+/// never forwarded.
+class InfoCommand : public core::Command {
+ public:
+  std::string name() const override {
+    return "INFO";
+  }
+
   std::string execute(quine::core::Topology& topology, size_t core_id, uint32_t conn_id,
                       const std::vector<std::string>& args) override {
     (void)core_id;
     (void)conn_id;
-    (void)args;
-    // WARNING: Blocking SAVE. In production, use BGSAVE (fork).
-    // Also, this iterates over ALL shards, which might race with modifications
-    // from other cores if we don't have a global lock or pause mechanism. For
-    // V1 Demo purposes, we assume light load or acceptable risk.
-    if (persistence::RdbManager::save(topology, "data/dump.rdb")) {
-      return "+OK\r\n";
-    } else {
-      return "-ERR failed to save\r\n";
+    if (args.size() > 2) return "-ERR syntax error\r\n";
+    std::string section = args.size() == 2 ? args[1] : "default";
+    std::transform(section.begin(), section.end(), section.begin(), ::tolower);
+    bool all = section == "all" || section == "default";
+
+    std::string info;
+    if (all || section == "clients") info += clients_section(topology);
+    if (all || section == "memory") {
+      if (!info.empty()) info += "\r\n";
+      info += memory_section(topology);
+    }
+    if (all || section == "eventloop") {
+      if (!info.empty()) info += "\r\n";
+      info += eventloop_section(topology);
     }
+    return bulk_string(info);
+  }
+
+ private:
+  // Connections per core, to see how steering spreads them (QUINE_STEERING)
+  static std::string clients_section(core::Topology& topology) {
+    size_t total = 0;
+    std::string cores;
+    for (size_t i = 0; i < topology.core_count(); ++i) {
+      total += topology.clients(i);
+      if (!topology.serves_clients(i) && topology.clients(i) == 0) continue;
+      cores += "core" + std::to_string(i) + ":clients=" + std::to_string(topology.clients(i)) +
+               "\r\n";
+    }
+    return "# Clients\r\nconnected_clients:" + std::to_string(total) + "\r\n" +
+           "client_output_limit_disconnections:" +
+           std::to_string(topology.output_limit_disconnects()) + "\r\n" +
+           "client_read_pauses:" + std::to_string(topology.read_pauses()) + "\r\n" + cores;
+  }
+
+  static std::string memory_section(core::Topology& topology) {
+    std::string info = "# Memory\r\n";
+    info += "used_memory:" + std::to_string(topology.used_memory()) + "\r\n";
+    info += "allocated_memory:" + std::to_string(topology.allocated_memory()) + "\r\n";
+    info += "maxmemory:" + std::to_string(topology.maxmemory()) + "\r\n";
+    info += "mem_fragmentation_ratio:" + ratio(topology.allocated_memory(), topology.used_memory()) +
+            "\r\n";
+    info += "lazyfree_pending_objects:" + std::to_string(topology.lazyfree_pending()) + "\r\n";
+    for (size_t i = 0; i < topology.shard_count(); ++i) {
+      const storage::Shard* shard = topology.get_shard(i);
+      if (!shard) continue;
+      size_t used = shard->memory().used_bytes();
+      size_t allocated = shard->memory().allocated_bytes();
+      info += "core" + std::to_string(i) + ":used=" + std::to_string(used) +
+              ",allocated=" + std::to_string(allocated) + ",frag=" + ratio(allocated, used) +
+              "\r\n";
+    }
+    return info;
+  }
+
+  // Busy-poll window and outcomes (QUINE_BUSY_POLL_US), and the load that
+  // admission control looks at (QUINE_ADMISSION_*), per core
+  static std::string eventloop_section(core::Topology& topology) {
+    uint64_t shed = 0;
+    for (size_t i = 0; i < topology.core_count(); ++i) shed += topology.shed_requests(i);
+    std::string info = "# Eventloop\r\nshed_requests:" + std::to_string(shed) + "\r\n";
+    for (size_t i = 0; i < topology.core_count(); ++i) {
+      const core::LoopStats* stats = topology.loop_stats(i);
+      if (!stats) continue;
+      auto get = [](const std::atomic<uint64_t>& counter) {
+        return std::to_string(counter.load(std::memory_order_relaxed));
+      };
+      info += "core" + std::to_string(i) + ":busy_poll_us=" + get(stats->busy_poll_us) +
+              ",spin_us=" + get(stats->spin_us) + ",spin_hits=" + get(stats->spin_hits) +
+              ",sleeps=" + get(stats->sleeps) +
+              ",queued_requests=" + std::to_string(topology.queued_requests(i)) +
+              ",lag_us=" + std::to_string(topology.loop_lag(i).count()) +
+              ",shed_requests=" + std::to_string(topology.shed_requests(i)) + "\r\n";
+    }
+    return info;
+  }
+
+  static std::string ratio(size_t allocated, size_t used) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.2f", used == 0 ? 1.0 : static_cast<double>(allocated) / used);
+    return buf;
   }
 };
 
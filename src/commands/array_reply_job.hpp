@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+
+#include "../core/scheduler.hpp"
+#include "../core/topology.hpp"
+#include "../storage/value.hpp"
+
+namespace quine {
+namespace commands {
+
+/// @brief Array replies with more elements than this are streamed by an
+/// ArrayReplyJob instead of being built in one go.
+constexpr size_t STREAM_THRESHOLD = 1024;
+
+/// @brief Streams the array reply over one key's collection in slices.
+///
+/// The element count is announced up front. Each slice looks the key up
+/// again and continues after the last element sent, so the collection may
+/// change between slices: like SCAN, the reply is not a point-in-time
+/// snapshot. Should the collection shrink or disappear, the reply is padded
+/// to the announced length with nils, or for replies of pairs (fields and
+/// values, members and scores) with pairs of an empty string and a nil, so
+/// that a field is never nil.
+///
+/// Elements are serialized straight from the collection into the slice's
+/// part, which ends at the deadline or at about PART_BYTES: the reply is
+/// written while it is generated, and at most one part of it is held per
+/// slice however big the collection.
+class ArrayReplyJob : public core::Job {
+ public:
+  /// @brief Array elements produced between two clock checks.
+  static constexpr size_t CHUNK = 128;
+  /// @brief Reply bytes after which a slice ends its part.
+  static constexpr size_t PART_BYTES = 64 * 1024;
+
+  ArrayReplyJob(core::Topology& topology, size_t core_id, std::string key, size_t elements)
+      : topology_(topology), core_id_(core_id), key_(std::move(key)), total_(elements) {}
+
+  bool resume(std::string& out, Clock::time_point deadline) override {
+    if (!started_) {
+      out += "*" + std::to_string(total_) + "\r\n";
+      started_ = true;
+    }
+
+    storage::Value* val = topology_.get_shard(core_id_)->get(key_);
+    while (sent_ < total_) {
+      size_t before = out.size();
+      size_t n = val ? append(*val, out, chunk(out.size())) : 0;
+      if (n == 0) {
+        // Collection gone or shrunk: keep the announced length
+        for (; sent_ < total_; ++sent_) {
+          bool field = entry_size() > 1 && sent_ % entry_size() == 0;
+          out += field ? "$0\r\n\r\n" : "$-1\r\n";
+        }
+        break;
+      }
+      sent_ += n;
+      sent_bytes_ += out.size() - before;
+      if (out.size() >= PART_BYTES || Clock::now() >= deadline) break;
+    }
+    return sent_ == total_;
+  }
+
+ protected:
+  /// @brief Append up to `max` array elements, continuing after the last
+  /// one appended by the previous call.
+  /// @return Elements appended; 0 if `value` has nothing more to give.
+  virtual size_t append(storage::Value& value, std::string& out, size_t max) = 0;
+
+  /// @brief Array elements per entry of the collection: 2 for pairs.
+  virtual size_t entry_size() const {
+    return 1;
+  }
+
+ private:
+  // Elements for the next append: what should fit in the rest of the part
+  // at the average size so far, so that big elements do not overshoot it by
+  // a whole CHUNK. The first pair is appended alone to take a measure.
+  // Never less than a pair: replies of hash fields and values, or members
+  // and scores, only come in pairs.
+  size_t chunk(size_t part_size) const {
+    size_t fit = 2;
+    if (sent_ > 0) {
+      size_t average = sent_bytes_ / sent_ + 1;
+      fit = std::max<size_t>((PART_BYTES - part_size) / average, 2);
+    }
+    return std::min({CHUNK, total_ - sent_, fit});
+  }
+
+  core::Topology& topology_;
+  size_t core_id_;
+  std::string key_;
+  size_t total_;
+  size_t sent_ = 0;
+  size_t sent_bytes_ = 0;  // Serialized size of the elements sent
+  bool started_ = false;
+};
+
+}  // namespace commands
+}  // namespace quine
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../core/command.hpp"
+#include "../core/router.hpp"
+#include "../core/topology.hpp"
+
+namespace quine {
+namespace commands {
+
+/// @brief CLUSTER introspection and slot management commands.
+/// Supported subcommands:
+///   CLUSTER KEYSLOT <key>          Redis Cluster hash slot of the key.
+///   CLUSTER KEYSHARD <key>         Core (shard) that currently owns the key.
+///   CLUSTER MOVESLOT <slot> <core> Migrate one slot to another core online.
+///   CLUSTER ADDCORE                Activate one more worker core.
+///   CLUSTER DELCORE                Retire the highest active worker core.
+/// KEYSLOT and KEYSHARD honour hash tags, so `{user42}:a` and `{user42}:b`
+/// report the same slot and shard. Migrations run in the background; the
+/// commands reply as soon as they are started. Executed on the receiving
+/// core, never forwarded.
+class ClusterCommand : public core::Command {
+ public:
+  std::string name() const override {
+    return "CLUSTER";
+  }
+
+  std::string execute(quine::core::Topology& topology, size_t core_id, uint32_t conn_id,
+                      const std::vector<std::string>& args) override {
+    (void)core_id;
+    (void)conn_id;
+    if (args.size() < 2) return "-ERR wrong number of arguments for 'cluster'\r\n";
+
+    std::string sub = args[1];
+    std::transform(sub.begin(), sub.end(), sub.begin(), ::toupper);
+
+    if (sub == "KEYSLOT") {
+      if (args.size() != 3) return "-ERR wrong number of arguments for 'cluster|keyslot'\r\n";
+      return ":" + std::to_string(core::Router::key_slot(args[2])) + "\r\n";
+    }
+
+    if (sub == "KEYSHARD") {
+      if (args.size() != 3) return "-ERR wrong number of arguments for 'cluster|keyshard'\r\n";
+      return ":" + std::to_string(topology.get_target_core(args[2])) + "\r\n";
+    }
+
+    try {
+      if (sub == "MOVESLOT") {
+        if (args.size() != 4) return "-ERR wrong number of arguments for 'cluster|moveslot'\r\n";
+        long slot = 0;
+        long target = 0;
+        try {
+          slot = std::stol(args[2]);
+          target = std::stol(args[3]);
+        } catch (...) {
+          return "-ERR value is not an integer or out of range\r\n";
+        }
+        // Checked before narrowing: 65541 must not become slot 5
+        if (slot < 0 || slot >= core::Router::NUM_SLOTS || target < 0 ||
+            static_cast<size_t>(target) >= topology.get_num_cores()) {
+          return "-ERR invalid slot or core\r\n";
+        }
+        topology.move_slot(static_cast<uint16_t>(slot), static_cast<size_t>(target));
+        return "+OK\r\n";
+      }
+
+      if (sub == "ADDCORE") {
+        if (args.size() != 2) return "-ERR wrong number of arguments for 'cluster|addcore'\r\n";
+        return ":" + std::to_string(topology.add_core()) + "\r\n";
+      }
+
+      if (sub == "DELCORE") {
+        if (args.size() != 2) return "-ERR wrong number of arguments for 'cluster|delcore'\r\n";
+        return ":" + std::to_string(topology.retire_core()) + "\r\n";
+      }
+    } catch (const std::exception& e) {
+      return std::string("-ERR ") + e.what() + "\r\n";
+    }
+
+    return "-ERR unknown subcommand '" + args[1] + "'\r\n";
+  }
+};
+
+}  // namespace commands
+}  // namespace quine
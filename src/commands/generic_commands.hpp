@@ -45,17 +45,7 @@ class ExpireCommand : public core::Command {
       shard->set_expiry(key, expiry);
       return ":1\r\n";
     } else {
-      // Forwarding
-      size_t target_core = topology.get_target_core(args[1]);
-      core::Message msg;
-      msg.type = core::MessageType::REQUEST;
-      msg.origin_core_id = core_id;
-      msg.conn_id = conn_id;
-      msg.key = args[1];
-      msg.args = args;
-      topology.get_channel(target_core)->push(msg);
-      topology.notify_core(target_core);
-      return "";
+      return topology.forward(core_id, conn_id, args);
     }
   }
 };
@@ -101,17 +91,7 @@ class TtlCommand : public core::Command {
       return ":" + std::to_string(diff / 1000) + "\r\n";
 
     } else {
-      // Forwarding
-      size_t target_core = topology.get_target_core(args[1]);
-      core::Message msg;
-      msg.type = core::MessageType::REQUEST;
-      msg.origin_core_id = core_id;
-      msg.conn_id = conn_id;
-      msg.key = args[1];
-      msg.args = args;
-      topology.get_channel(target_core)->push(msg);
-      topology.notify_core(target_core);
-      return "";
+      return topology.forward(core_id, conn_id, args);
     }
   }
 };
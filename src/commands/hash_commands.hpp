@@ -7,6 +7,8 @@
 #include "../core/message.hpp"
 #include "../core/topology.hpp"
 #include "../storage/value.hpp"
+#include "array_reply_job.hpp"
+#include "resp.hpp"
 
 namespace quine {
 namespace commands {
@@ -16,6 +18,9 @@ class HSetCommand : public core::Command {
   std::string name() const override {
     return "HSET";
   }
+  bool grows_memory() const override {
+    return true;
+  }
 
   std::string execute(quine::core::Topology& topology, size_t core_id, uint32_t conn_id,
                       const std::vector<std::string>& args) override {
@@ -31,11 +36,11 @@ class HSetCommand : public core::Command {
       storage::Hash* hash_ptr = nullptr;
 
       if (!val) {
-        shard->set(key, storage::Hash{});
+        shard->set(key, storage::Hash(shard->allocator()));
         val = shard->get(key);
-        hash_ptr = std::get_if<storage::Hash>(val);
+        hash_ptr = val->get_if<storage::Hash>();
       } else {
-        hash_ptr = std::get_if<storage::Hash>(val);
+        hash_ptr = val->get_if<storage::Hash>();
         if (!hash_ptr) {
           return "-ERR WRONGTYPE Operation against a key holding the wrong "
                  "kind of value\r\n";
@@ -50,27 +55,18 @@ class HSetCommand : public core::Command {
         // inserted using insert_or_assign in C++17 would be better to detect
         // creation vs update But strict generic Redis HSET returns number of
         // fields *added*.
-        auto it = hash_ptr->find(field);
+        auto it = hash_ptr->find(std::string_view(field));
         if (it == hash_ptr->end()) {
           created_fields++;
-          (*hash_ptr)[field] = value;
+          hash_ptr->emplace(field, value);
         } else {
-          (*hash_ptr)[field] = value;
+          it->second.assign(value);
         }
       }
       return ":" + std::to_string(created_fields) + "\r\n";
 
     } else {
-      size_t target_core = topology.get_target_core(args[1]);
-      core::Message msg;
-      msg.type = core::MessageType::REQUEST;
-      msg.origin_core_id = core_id;
-      msg.conn_id = conn_id;
-      msg.key = args[1];
-      msg.args = args;
-      topology.get_channel(target_core)->push(msg);
-      topology.notify_core(target_core);
-      return "";
+      return topology.forward(core_id, conn_id, args);
     }
   }
 };
@@ -94,31 +90,50 @@ class HGetCommand : public core::Command {
 
       if (!val) return "$-1\r\n";
 
-      auto* hash_ptr = std::get_if<storage::Hash>(val);
+      auto* hash_ptr = val->get_if<storage::Hash>();
       if (!hash_ptr)
         return "-ERR WRONGTYPE Operation against a key holding the wrong kind "
                "of value\r\n";
 
-      auto it = hash_ptr->find(field);
+      auto it = hash_ptr->find(std::string_view(field));
       if (it == hash_ptr->end()) {
         return "$-1\r\n";
       }
 
-      return "$" + std::to_string(it->second.size()) + "\r\n" + it->second + "\r\n";
+      return bulk_string(it->second);
 
     } else {
-      size_t target_core = topology.get_target_core(args[1]);
-      core::Message msg;
-      msg.type = core::MessageType::REQUEST;
-      msg.origin_core_id = core_id;
-      msg.conn_id = conn_id;
-      msg.key = args[1];
-      msg.args = args;
-      topology.get_channel(target_core)->push(msg);
-      topology.notify_core(target_core);
-      return "";
+      return topology.forward(core_id, conn_id, args);
+    }
+  }
+};
+
+/// @brief Streams HGETALL of a large hash, in field order.
+class HGetAllJob : public ArrayReplyJob {
+ public:
+  using ArrayReplyJob::ArrayReplyJob;
+
+ protected:
+  size_t append(storage::Value& value, std::string& out, size_t max) override {
+    auto* hash_ptr = value.get_if<storage::Hash>();
+    if (!hash_ptr) return 0;
+    auto it = resumed_ ? hash_ptr->upper_bound(std::string_view(last_)) : hash_ptr->begin();
+    size_t n = 0;
+    for (; it != hash_ptr->end() && n + 2 <= max; ++it, n += 2) {
+      append_bulk(out, it->first);
+      append_bulk(out, it->second);
+      last_ = it->first;
     }
+    resumed_ = true;
+    return n;
   }
+  size_t entry_size() const override {
+    return 2;
+  }
+
+ private:
+  std::string last_;  // Last field sent
+  bool resumed_ = false;
 };
 
 class HGetAllCommand : public core::Command {
@@ -139,30 +154,26 @@ class HGetAllCommand : public core::Command {
 
       if (!val) return "*0\r\n";
 
-      auto* hash_ptr = std::get_if<storage::Hash>(val);
+      auto* hash_ptr = val->get_if<storage::Hash>();
       if (!hash_ptr)
         return "-ERR WRONGTYPE Operation against a key holding the wrong kind "
                "of value\r\n";
 
       // Result is array of field, value, field, value...
+      if (hash_ptr->size() * 2 > STREAM_THRESHOLD) {
+        return topology.defer(
+            core_id, conn_id,
+            std::make_unique<HGetAllJob>(topology, core_id, key, hash_ptr->size() * 2));
+      }
       std::string resp = "*" + std::to_string(hash_ptr->size() * 2) + "\r\n";
       for (const auto& pair : *hash_ptr) {
-        resp += "$" + std::to_string(pair.first.size()) + "\r\n" + pair.first + "\r\n";
-        resp += "$" + std::to_string(pair.second.size()) + "\r\n" + pair.second + "\r\n";
+        append_bulk(resp, pair.first);
+        append_bulk(resp, pair.second);
       }
       return resp;
 
     } else {
-      size_t target_core = topology.get_target_core(args[1]);
-      core::Message msg;
-      msg.type = core::MessageType::REQUEST;
-      msg.origin_core_id = core_id;
-      msg.conn_id = conn_id;
-      msg.key = args[1];
-      msg.args = args;
-      topology.get_channel(target_core)->push(msg);
-      topology.notify_core(target_core);
-      return "";
+      return topology.forward(core_id, conn_id, args);
     }
   }
 };
@@ -185,38 +196,25 @@ class HDelCommand : public core::Command {
 
       if (!val) return ":0\r\n";
 
-      auto* hash_ptr = std::get_if<storage::Hash>(val);
+      auto* hash_ptr = val->get_if<storage::Hash>();
       if (!hash_ptr)
         return "-ERR WRONGTYPE Operation against a key holding the wrong kind "
                "of value\r\n";
 
       int removed = 0;
       for (size_t i = 2; i < args.size(); ++i) {
-        if (hash_ptr->erase(args[i])) {
+        auto it = hash_ptr->find(std::string_view(args[i]));
+        if (it != hash_ptr->end()) {
+          hash_ptr->erase(it);
           removed++;
         }
       }
       return ":" + std::to_string(removed) + "\r\n";
 
     } else {
-      return forward_request(topology, core_id, conn_id, args);
+      return topology.forward(core_id, conn_id, args);
     }
   }
-
- private:
-  std::string forward_request(core::Topology& topology, size_t core_id, uint32_t conn_id,
-                              const std::vector<std::string>& args) {
-    size_t target_core = topology.get_target_core(args[1]);
-    core::Message msg;
-    msg.type = core::MessageType::REQUEST;
-    msg.origin_core_id = core_id;
-    msg.conn_id = conn_id;
-    msg.key = args[1];
-    msg.args = args;
-    topology.get_channel(target_core)->push(msg);
-    topology.notify_core(target_core);
-    return "";
-  }
 };
 
 class HLenCommand : public core::Command {
@@ -237,7 +235,7 @@ class HLenCommand : public core::Command {
 
       if (!val) return ":0\r\n";
 
-      auto* hash_ptr = std::get_if<storage::Hash>(val);
+      auto* hash_ptr = val->get_if<storage::Hash>();
       if (!hash_ptr)
         return "-ERR WRONGTYPE Operation against a key holding the wrong kind "
                "of value\r\n";
@@ -245,24 +243,9 @@ class HLenCommand : public core::Command {
       return ":" + std::to_string(hash_ptr->size()) + "\r\n";
 
     } else {
-      return forward_request(topology, core_id, conn_id, args);
+      return topology.forward(core_id, conn_id, args);
     }
   }
-
- private:
-  std::string forward_request(core::Topology& topology, size_t core_id, uint32_t conn_id,
-                              const std::vector<std::string>& args) {
-    size_t target_core = topology.get_target_core(args[1]);
-    core::Message msg;
-    msg.type = core::MessageType::REQUEST;
-    msg.origin_core_id = core_id;
-    msg.conn_id = conn_id;
-    msg.key = args[1];
-    msg.args = args;
-    topology.get_channel(target_core)->push(msg);
-    topology.notify_core(target_core);
-    return "";
-  }
 };
 
 }  // namespace commands
@@ -8,6 +8,8 @@
 #include "../core/message.hpp"
 #include "../core/topology.hpp"
 #include "../storage/value.hpp"
+#include "array_reply_job.hpp"
+#include "resp.hpp"
 
 namespace quine {
 namespace commands {
@@ -17,6 +19,9 @@ class LPushCommand : public core::Command {
   std::string name() const override {
     return "LPUSH";
   }
+  bool grows_memory() const override {
+    return true;
+  }
 
   std::string execute(core::Topology& topology, size_t core_id, uint32_t conn_id,
                       const std::vector<std::string>& args) override {
@@ -30,12 +35,11 @@ class LPushCommand : public core::Command {
       storage::List* list_ptr = nullptr;
 
       if (!val) {
-        storage::List new_list;
-        shard->set(key, std::move(new_list));
+        shard->set(key, storage::List(shard->allocator()));
         val = shard->get(key);
-        list_ptr = std::get_if<storage::List>(val);
+        list_ptr = val->get_if<storage::List>();
       } else {
-        list_ptr = std::get_if<storage::List>(val);
+        list_ptr = val->get_if<storage::List>();
         if (!list_ptr) {
           return "-ERR WRONGTYPE Operation against a key holding the wrong "
                  "kind of value\r\n";
@@ -43,31 +47,15 @@ class LPushCommand : public core::Command {
       }
 
       for (size_t i = 2; i < args.size(); ++i) {
-        list_ptr->push_front(args[i]);
+        list_ptr->emplace_front(args[i]);
       }
 
       return ":" + std::to_string(list_ptr->size()) + "\r\n";
 
     } else {
-      return forward_request(topology, core_id, conn_id, args);
+      return topology.forward(core_id, conn_id, args);
     }
   }
-
- private:
-  std::string forward_request(core::Topology& topology, size_t core_id, uint32_t conn_id,
-                              const std::vector<std::string>& args) {
-    size_t target_core = topology.get_target_core(args[1]);
-    core::Message msg;
-    msg.type = core::MessageType::REQUEST;
-    msg.origin_core_id = core_id;
-    msg.conn_id = conn_id;
-    msg.key = args[1];
-    msg.args = args;
-
-    topology.get_channel(target_core)->push(msg);
-    topology.notify_core(target_core);
-    return "";
-  }
 };
 
 class LPopCommand : public core::Command {
@@ -90,7 +78,7 @@ class LPopCommand : public core::Command {
         return "$-1\r\n";
       }
 
-      auto* list_ptr = std::get_if<storage::List>(val);
+      auto* list_ptr = val->get_if<storage::List>();
       if (!list_ptr) {
         return "-ERR WRONGTYPE Operation against a key holding the wrong kind "
                "of value\r\n";
@@ -100,31 +88,34 @@ class LPopCommand : public core::Command {
         return "$-1\r\n";
       }
 
-      std::string element = list_ptr->front();
+      std::string reply = bulk_string(list_ptr->front());
       list_ptr->pop_front();
 
-      return "$" + std::to_string(element.size()) + "\r\n" + element + "\r\n";
+      return reply;
 
     } else {
-      return forward_request(topology, core_id, conn_id, args);
+      return topology.forward(core_id, conn_id, args);
     }
   }
+};
 
- private:
-  std::string forward_request(core::Topology& topology, size_t core_id, uint32_t conn_id,
-                              const std::vector<std::string>& args) {
-    size_t target_core = topology.get_target_core(args[1]);
-    core::Message msg;
-    msg.type = core::MessageType::REQUEST;
-    msg.origin_core_id = core_id;
-    msg.conn_id = conn_id;
-    msg.key = args[1];
-    msg.args = args;
-
-    topology.get_channel(target_core)->push(msg);
-    topology.notify_core(target_core);
-    return "";
+/// @brief Streams a long LRANGE, by index.
+class LRangeJob : public ArrayReplyJob {
+ public:
+  LRangeJob(core::Topology& topology, size_t core_id, std::string key, size_t start, size_t stop)
+      : ArrayReplyJob(topology, core_id, std::move(key), stop - start + 1), next_(start) {}
+
+ protected:
+  size_t append(storage::Value& value, std::string& out, size_t max) override {
+    auto* list_ptr = value.get_if<storage::List>();
+    if (!list_ptr) return 0;
+    size_t n = 0;
+    for (; next_ < list_ptr->size() && n < max; ++next_, ++n) append_bulk(out, (*list_ptr)[next_]);
+    return n;
   }
+
+ private:
+  size_t next_;  // Index of the next element to send
 };
 
 class LRangeCommand : public core::Command {
@@ -147,7 +138,7 @@ class LRangeCommand : public core::Command {
         return "*0\r\n";
       }
 
-      auto* list_ptr = std::get_if<storage::List>(val);
+      auto* list_ptr = val->get_if<storage::List>();
       if (!list_ptr) {
         return "-ERR WRONGTYPE Operation against a key holding the wrong kind "
                "of value\r\n";
@@ -166,10 +157,14 @@ class LRangeCommand : public core::Command {
         if (stop >= size) stop = size - 1;
         if (start > stop) return "*0\r\n";
 
+        if (static_cast<size_t>(stop - start + 1) > STREAM_THRESHOLD) {
+          return topology.defer(core_id, conn_id,
+                                std::make_unique<LRangeJob>(topology, core_id, key, start, stop));
+        }
+
         std::string resp = "*" + std::to_string(stop - start + 1) + "\r\n";
         for (int i = start; i <= stop; ++i) {
-          const auto& elem = (*list_ptr)[i];
-          resp += "$" + std::to_string(elem.size()) + "\r\n" + elem + "\r\n";
+          append_bulk(resp, (*list_ptr)[i]);
         }
         return resp;
 
@@ -178,24 +173,9 @@ class LRangeCommand : public core::Command {
       }
 
     } else {
-      return forward_request(topology, core_id, conn_id, args);
+      return topology.forward(core_id, conn_id, args);
     }
   }
-
- private:
-  std::string forward_request(core::Topology& topology, size_t core_id, uint32_t conn_id,
-                              const std::vector<std::string>& args) {
-    size_t target_core = topology.get_target_core(args[1]);
-    core::Message msg;
-    msg.type = core::MessageType::REQUEST;
-    msg.origin_core_id = core_id;
-    msg.conn_id = conn_id;
-    msg.key = args[1];
-    msg.args = args;
-    topology.get_channel(target_core)->push(msg);
-    topology.notify_core(target_core);
-    return "";
-  }
 };
 
 class RPushCommand : public core::Command {
@@ -203,6 +183,9 @@ class RPushCommand : public core::Command {
   std::string name() const override {
     return "RPUSH";
   }
+  bool grows_memory() const override {
+    return true;
+  }
 
   std::string execute(core::Topology& topology, size_t core_id, uint32_t conn_id,
                       const std::vector<std::string>& args) override {
@@ -216,39 +199,24 @@ class RPushCommand : public core::Command {
       storage::List* list_ptr = nullptr;
 
       if (!val) {
-        shard->set(key, storage::List{});
+        shard->set(key, storage::List(shard->allocator()));
         val = shard->get(key);
-        list_ptr = std::get_if<storage::List>(val);
+        list_ptr = val->get_if<storage::List>();
       } else {
-        list_ptr = std::get_if<storage::List>(val);
+        list_ptr = val->get_if<storage::List>();
         if (!list_ptr)
           return "-ERR WRONGTYPE Operation against a key holding the wrong "
                  "kind of value\r\n";
       }
 
       for (size_t i = 2; i < args.size(); ++i) {
-        list_ptr->push_back(args[i]);
+        list_ptr->emplace_back(args[i]);
       }
       return ":" + std::to_string(list_ptr->size()) + "\r\n";
     } else {
-      return forward_request(topology, core_id, conn_id, args);
+      return topology.forward(core_id, conn_id, args);
     }
   }
-
- private:
-  std::string forward_request(core::Topology& topology, size_t core_id, uint32_t conn_id,
-                              const std::vector<std::string>& args) {
-    size_t target_core = topology.get_target_core(args[1]);
-    core::Message msg;
-    msg.type = core::MessageType::REQUEST;
-    msg.origin_core_id = core_id;
-    msg.conn_id = conn_id;
-    msg.key = args[1];
-    msg.args = args;
-    topology.get_channel(target_core)->push(msg);
-    topology.notify_core(target_core);
-    return "";
-  }
 };
 
 class RPopCommand : public core::Command {
@@ -268,35 +236,20 @@ class RPopCommand : public core::Command {
       storage::Value* val = shard->get(key);
       if (!val) return "$-1\r\n";
 
-      auto* list_ptr = std::get_if<storage::List>(val);
+      auto* list_ptr = val->get_if<storage::List>();
       if (!list_ptr)
         return "-ERR WRONGTYPE Operation against a key holding the wrong kind "
                "of value\r\n";
 
       if (list_ptr->empty()) return "$-1\r\n";
 
-      std::string element = list_ptr->back();
+      std::string reply = bulk_string(list_ptr->back());
       list_ptr->pop_back();
-      return "$" + std::to_string(element.size()) + "\r\n" + element + "\r\n";
+      return reply;
     } else {
-      return forward_request(topology, core_id, conn_id, args);
+      return topology.forward(core_id, conn_id, args);
     }
   }
-
- private:
-  std::string forward_request(core::Topology& topology, size_t core_id, uint32_t conn_id,
-                              const std::vector<std::string>& args) {
-    size_t target_core = topology.get_target_core(args[1]);
-    core::Message msg;
-    msg.type = core::MessageType::REQUEST;
-    msg.origin_core_id = core_id;
-    msg.conn_id = conn_id;
-    msg.key = args[1];
-    msg.args = args;
-    topology.get_channel(target_core)->push(msg);
-    topology.notify_core(target_core);
-    return "";
-  }
 };
 
 class LLenCommand : public core::Command {
@@ -316,31 +269,16 @@ class LLenCommand : public core::Command {
       storage::Value* val = shard->get(key);
       if (!val) return ":0\r\n";
 
-      auto* list_ptr = std::get_if<storage::List>(val);
+      auto* list_ptr = val->get_if<storage::List>();
       if (!list_ptr)
         return "-ERR WRONGTYPE Operation against a key holding the wrong kind "
                "of value\r\n";
 
       return ":" + std::to_string(list_ptr->size()) + "\r\n";
     } else {
-      return forward_request(topology, core_id, conn_id, args);
+      return topology.forward(core_id, conn_id, args);
     }
   }
-
- private:
-  std::string forward_request(core::Topology& topology, size_t core_id, uint32_t conn_id,
-                              const std::vector<std::string>& args) {
-    size_t target_core = topology.get_target_core(args[1]);
-    core::Message msg;
-    msg.type = core::MessageType::REQUEST;
-    msg.origin_core_id = core_id;
-    msg.conn_id = conn_id;
-    msg.key = args[1];
-    msg.args = args;
-    topology.get_channel(target_core)->push(msg);
-    topology.notify_core(target_core);
-    return "";
-  }
 };
 
 }  // namespace commands
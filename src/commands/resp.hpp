@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace quine {
+namespace commands {
+
+/// @brief Append a RESP bulk string ("$<len>\r\n<data>\r\n") to a reply.
+inline void append_bulk(std::string& out, std::string_view data) {
+  out += '$';
+  out += std::to_string(data.size());
+  out += "\r\n";
+  out.append(data);
+  out += "\r\n";
+}
+
+/// @brief A RESP bulk string reply.
+inline std::string bulk_string(std::string_view data) {
+  std::string out;
+  out.reserve(data.size() + 16);
+  append_bulk(out, data);
+  return out;
+}
+
+}  // namespace commands
+}  // namespace quine
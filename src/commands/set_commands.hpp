@@ -7,6 +7,8 @@
 #include "../core/message.hpp"
 #include "../core/topology.hpp"
 #include "../storage/value.hpp"
+#include "array_reply_job.hpp"
+#include "resp.hpp"
 
 namespace quine {
 namespace commands {
@@ -16,6 +18,9 @@ class SAddCommand : public core::Command {
   std::string name() const override {
     return "SADD";
   }
+  bool grows_memory() const override {
+    return true;
+  }
 
   std::string execute(quine::core::Topology& topology, size_t core_id, uint32_t conn_id,
                       const std::vector<std::string>& args) override {
@@ -29,11 +34,11 @@ class SAddCommand : public core::Command {
       storage::Set* set_ptr = nullptr;
 
       if (!val) {
-        shard->set(key, storage::Set{});
+        shard->set(key, storage::Set(shard->allocator()));
         val = shard->get(key);
-        set_ptr = std::get_if<storage::Set>(val);
+        set_ptr = val->get_if<storage::Set>();
       } else {
-        set_ptr = std::get_if<storage::Set>(val);
+        set_ptr = val->get_if<storage::Set>();
         if (!set_ptr) {
           return "-ERR WRONGTYPE Operation against a key holding the wrong "
                  "kind of value\r\n";
@@ -42,26 +47,40 @@ class SAddCommand : public core::Command {
 
       int added = 0;
       for (size_t i = 2; i < args.size(); ++i) {
-        if (set_ptr->insert(args[i]).second) {
+        if (set_ptr->emplace(args[i]).second) {
           added++;
         }
       }
       return ":" + std::to_string(added) + "\r\n";
 
     } else {
-      // Forwarding... (simplified duplicate logic, ideally should be shared)
-      size_t target_core = topology.get_target_core(args[1]);
-      core::Message msg;
-      msg.type = core::MessageType::REQUEST;
-      msg.origin_core_id = core_id;
-      msg.conn_id = conn_id;
-      msg.key = args[1];
-      msg.args = args;
-      topology.get_channel(target_core)->push(msg);
-      topology.notify_core(target_core);
-      return "";
+      return topology.forward(core_id, conn_id, args);
+    }
+  }
+};
+
+/// @brief Streams SMEMBERS of a large set, in member order.
+class SMembersJob : public ArrayReplyJob {
+ public:
+  using ArrayReplyJob::ArrayReplyJob;
+
+ protected:
+  size_t append(storage::Value& value, std::string& out, size_t max) override {
+    auto* set_ptr = value.get_if<storage::Set>();
+    if (!set_ptr) return 0;
+    auto it = resumed_ ? set_ptr->upper_bound(std::string_view(last_)) : set_ptr->begin();
+    size_t n = 0;
+    for (; it != set_ptr->end() && n < max; ++it, ++n) {
+      append_bulk(out, *it);
+      last_ = *it;
     }
+    resumed_ = true;
+    return n;
   }
+
+ private:
+  std::string last_;  // Last member sent
+  bool resumed_ = false;
 };
 
 class SMembersCommand : public core::Command {
@@ -84,29 +103,26 @@ class SMembersCommand : public core::Command {
         return "*0\r\n";
       }
 
-      auto* set_ptr = std::get_if<storage::Set>(val);
+      auto* set_ptr = val->get_if<storage::Set>();
       if (!set_ptr) {
         return "-ERR WRONGTYPE Operation against a key holding the wrong kind "
                "of value\r\n";
       }
 
+      if (set_ptr->size() > STREAM_THRESHOLD) {
+        return topology.defer(
+            core_id, conn_id,
+            std::make_unique<SMembersJob>(topology, core_id, key, set_ptr->size()));
+      }
+
       std::string resp = "*" + std::to_string(set_ptr->size()) + "\r\n";
       for (const auto& member : *set_ptr) {
-        resp += "$" + std::to_string(member.size()) + "\r\n" + member + "\r\n";
+        append_bulk(resp, member);
       }
       return resp;
 
     } else {
-      size_t target_core = topology.get_target_core(args[1]);
-      core::Message msg;
-      msg.type = core::MessageType::REQUEST;
-      msg.origin_core_id = core_id;
-      msg.conn_id = conn_id;
-      msg.key = args[1];
-      msg.args = args;
-      topology.get_channel(target_core)->push(msg);
-      topology.notify_core(target_core);
-      return "";
+      return topology.forward(core_id, conn_id, args);
     }
   }
 };
@@ -131,7 +147,7 @@ class SRemCommand : public core::Command {
         return ":0\r\n";
       }
 
-      auto* set_ptr = std::get_if<storage::Set>(val);
+      auto* set_ptr = val->get_if<storage::Set>();
       if (!set_ptr) {
         return "-ERR WRONGTYPE Operation against a key holding the wrong kind "
                "of value\r\n";
@@ -139,31 +155,18 @@ class SRemCommand : public core::Command {
 
       int removed = 0;
       for (size_t i = 2; i < args.size(); ++i) {
-        if (set_ptr->erase(args[i])) {
+        auto it = set_ptr->find(std::string_view(args[i]));
+        if (it != set_ptr->end()) {
+          set_ptr->erase(it);
           removed++;
         }
       }
       return ":" + std::to_string(removed) + "\r\n";
 
     } else {
-      return forward_request(topology, core_id, conn_id, args);
+      return topology.forward(core_id, conn_id, args);
     }
   }
-
- private:
-  std::string forward_request(core::Topology& topology, size_t core_id, uint32_t conn_id,
-                              const std::vector<std::string>& args) {
-    size_t target_core = topology.get_target_core(args[1]);
-    core::Message msg;
-    msg.type = core::MessageType::REQUEST;
-    msg.origin_core_id = core_id;
-    msg.conn_id = conn_id;
-    msg.key = args[1];
-    msg.args = args;
-    topology.get_channel(target_core)->push(msg);
-    topology.notify_core(target_core);
-    return "";
-  }
 };
 
 class SCardCommand : public core::Command {
@@ -186,7 +189,7 @@ class SCardCommand : public core::Command {
         return ":0\r\n";
       }
 
-      auto* set_ptr = std::get_if<storage::Set>(val);
+      auto* set_ptr = val->get_if<storage::Set>();
       if (!set_ptr) {
         return "-ERR WRONGTYPE Operation against a key holding the wrong "
                "kind of value\r\n";
@@ -195,24 +198,9 @@ class SCardCommand : public core::Command {
       return ":" + std::to_string(set_ptr->size()) + "\r\n";
 
     } else {
-      return forward_request(topology, core_id, conn_id, args);
+      return topology.forward(core_id, conn_id, args);
     }
   }
-
- private:
-  std::string forward_request(core::Topology& topology, size_t core_id, uint32_t conn_id,
-                              const std::vector<std::string>& args) {
-    size_t target_core = topology.get_target_core(args[1]);
-    core::Message msg;
-    msg.type = core::MessageType::REQUEST;
-    msg.origin_core_id = core_id;
-    msg.conn_id = conn_id;
-    msg.key = args[1];
-    msg.args = args;
-    topology.get_channel(target_core)->push(msg);
-    topology.notify_core(target_core);
-    return "";
-  }
 };
 
 }  // namespace commands
@@ -1,11 +1,14 @@
 #pragma once
 
+#include <deque>
 #include <iostream>
 
 #include "../core/command.hpp"
 #include "../core/message.hpp"
+#include "../core/task.hpp"
 #include "../core/topology.hpp"
 #include "../storage/value.hpp"
+#include "resp.hpp"
 
 namespace quine {
 namespace commands {
@@ -15,30 +18,22 @@ class SetCommand : public core::Command {
   std::string name() const override {
     return "SET";
   }
+  bool grows_memory() const override {
+    return true;
+  }
 
   std::string execute(core::Topology& topology, size_t core_id, uint32_t conn_id,
                       const std::vector<std::string>& args) override {
     if (args.size() != 3) return "-ERR wrong number of arguments for 'set'\r\n";
 
     if (topology.is_local(core_id, args[1])) {
-      // Construct Value variant from string
-      storage::Value val = std::string(args[2]);
-      topology.get_shard(core_id)->set(args[1], std::move(val));
+      // Construct the value directly in the shard's memory
+      auto* shard = topology.get_shard(core_id);
+      storage::Value val(args[2], shard->allocator());
+      shard->set(args[1], std::move(val));
       return "+OK\r\n";
     } else {
-      // Forwarding
-      size_t target_core = topology.get_target_core(args[1]);
-      core::Message msg;
-      msg.type = core::MessageType::REQUEST;
-      msg.origin_core_id = core_id;
-      msg.conn_id = conn_id;
-      msg.key = args[1];
-      msg.args = args;
-
-      topology.get_channel(target_core)->push(msg);
-      topology.notify_core(target_core);
-
-      return "";  // Async response
+      return topology.forward(core_id, conn_id, args);
     }
   }
 };
@@ -56,8 +51,8 @@ class GetCommand : public core::Command {
     if (topology.is_local(core_id, args[1])) {
       storage::Value* val = topology.get_shard(core_id)->get(args[1]);
       if (val) {
-        if (auto str_val = std::get_if<std::string>(val)) {
-          return "$" + std::to_string(str_val->size()) + "\r\n" + *str_val + "\r\n";
+        if (val->is_string()) {
+          return topology.bulk_reply(core_id, *val);
         } else {
           return "-ERR WRONGTYPE Operation against a key holding the wrong "
                  "kind of value\r\n";
@@ -66,20 +61,89 @@ class GetCommand : public core::Command {
         return "$-1\r\n";
       }
     } else {
-      // Forwarding
-      size_t target_core = topology.get_target_core(args[1]);
-      core::Message msg;
-      msg.type = core::MessageType::REQUEST;
-      msg.origin_core_id = core_id;
-      msg.conn_id = conn_id;
-      msg.key = args[1];
-      msg.args = args;
-
-      topology.get_channel(target_core)->push(msg);
-      topology.notify_core(target_core);
+      return topology.forward(core_id, conn_id, args);
+    }
+  }
+};
+
+/// @brief MGET key [key ...]. Keys held by this core are resolved in one
+/// batched lookup. Keys held by other cores are fetched with one GET per
+/// key, all in flight at once, and the reply is sent once they are all in.
+/// Like in a Redis cluster, the values from different cores are not read at
+/// a single point in time.
+class MGetCommand : public core::Command {
+ public:
+  std::string name() const override {
+    return "MGET";
+  }
+
+  std::string execute(core::Topology& topology, size_t core_id, uint32_t conn_id,
+                      const std::vector<std::string>& args) override {
+    if (args.size() < 2) return "-ERR wrong number of arguments for 'mget'\r\n";
+
+    std::vector<std::string_view> keys(args.begin() + 1, args.end());
+    std::vector<bool> remote(keys.size());
+    bool any_remote = false;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      remote[i] = !topology.is_local(core_id, keys[i]);
+      any_remote = any_remote || remote[i];
+    }
+
+    // Remote keys come back as nulls here and are filled in by gather()
+    std::vector<storage::Value*> values(keys.size());
+    if (!topology.is_io_core(core_id)) {
+      topology.get_shard(core_id)->get_many(keys.data(), keys.size(), values.data());
+    }
+    std::vector<std::string> replies(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+      if (remote[i]) continue;
+      if (values[i] && values[i]->is_string()) {
+        append_bulk(replies[i], values[i]->string());
+      } else {
+        replies[i] = "$-1\r\n";  // Missing or not a string
+      }
+    }
 
+    if (any_remote) {
+      gather(topology, core_id, topology.reply_target(core_id, conn_id), args,
+             std::move(replies))
+          .detach();
       return "";
     }
+    return array_reply(replies);
+  }
+
+ private:
+  static std::string array_reply(const std::vector<std::string>& replies) {
+    std::string resp = "*" + std::to_string(replies.size()) + "\r\n";
+    for (const auto& reply : replies) resp += reply;
+    return resp;
+  }
+
+  // Fill in the replies for the keys of other cores, then send the result.
+  // Arguments are taken by value: they must outlive execute().
+  static core::Task<> gather(core::Topology& topology, size_t core_id,
+                             core::Scheduler::Target target, std::vector<std::string> args,
+                             std::vector<std::string> replies) {
+    std::deque<core::Call> calls;  // Never moved: the topology holds their address
+    for (size_t i = 0; i < replies.size(); ++i) {
+      if (!replies[i].empty()) continue;
+      calls.emplace_back(topology, core_id, std::vector<std::string>{"GET", args[i + 1]});
+    }
+
+    auto call = calls.begin();
+    for (auto& reply : replies) {
+      if (!reply.empty()) continue;
+      core::Call& pending = *call++;
+      reply = co_await pending;
+      if (reply.starts_with("-BUSY")) {
+        // A key's core shed the call: so does the whole command
+        topology.reply(core_id, target, std::move(reply));
+        co_return;
+      }
+      if (reply[0] != '$') reply = "$-1\r\n";  // WRONGTYPE: null, like a local key
+    }
+    topology.reply(core_id, target, array_reply(replies));
   }
 };
 
@@ -97,19 +161,28 @@ class DelCommand : public core::Command {
       bool deleted = topology.get_shard(core_id)->del(args[1]);
       return ":" + std::to_string(deleted ? 1 : 0) + "\r\n";
     } else {
-      // Forwarding
-      size_t target_core = topology.get_target_core(args[1]);
-      core::Message msg;
-      msg.type = core::MessageType::REQUEST;
-      msg.origin_core_id = core_id;
-      msg.conn_id = conn_id;
-      msg.key = args[1];
-      msg.args = args;
-
-      topology.get_channel(target_core)->push(msg);
-      topology.notify_core(target_core);
+      return topology.forward(core_id, conn_id, args);
+    }
+  }
+};
 
-      return "";
+/// @brief UNLINK key: DEL that leaves destroying a large value to the
+/// shard's reclaimer, so the core keeps serving other keys meanwhile.
+class UnlinkCommand : public core::Command {
+ public:
+  std::string name() const override {
+    return "UNLINK";
+  }
+
+  std::string execute(quine::core::Topology& topology, size_t core_id, uint32_t conn_id,
+                      const std::vector<std::string>& args) override {
+    if (args.size() != 2) return "-ERR wrong number of arguments for 'unlink'\r\n";
+
+    if (topology.is_local(core_id, args[1])) {
+      bool deleted = topology.get_shard(core_id)->unlink(args[1]);
+      return ":" + std::to_string(deleted ? 1 : 0) + "\r\n";
+    } else {
+      return topology.forward(core_id, conn_id, args);
     }
   }
 };
@@ -8,6 +8,8 @@
 #include "../core/message.hpp"
 #include "../core/topology.hpp"
 #include "../storage/value.hpp"
+#include "array_reply_job.hpp"
+#include "resp.hpp"
 
 namespace quine {
 namespace commands {
@@ -17,6 +19,9 @@ class ZAddCommand : public core::Command {
   std::string name() const override {
     return "ZADD";
   }
+  bool grows_memory() const override {
+    return true;
+  }
 
   std::string execute(quine::core::Topology& topology, size_t core_id, uint32_t conn_id,
                       const std::vector<std::string>& args) override {
@@ -32,11 +37,11 @@ class ZAddCommand : public core::Command {
       storage::ZSet* zset_ptr = nullptr;
 
       if (!val) {
-        shard->set(key, storage::ZSet{});
+        shard->set(key, storage::ZSet(shard->allocator()));
         val = shard->get(key);
-        zset_ptr = std::get_if<storage::ZSet>(val);
+        zset_ptr = val->get_if<storage::ZSet>();
       } else {
-        zset_ptr = std::get_if<storage::ZSet>(val);
+        zset_ptr = val->get_if<storage::ZSet>();
         if (!zset_ptr) {
           return "-ERR WRONGTYPE Operation against a key holding the wrong "
                  "kind of value\r\n";
@@ -54,33 +59,78 @@ class ZAddCommand : public core::Command {
         const std::string& member = args[i + 1];
 
         // Optimized lookup using internal dictionary
-        auto it = zset_ptr->dict.find(member);
+        auto it = zset_ptr->dict.find(std::string_view(member));
         if (it != zset_ptr->dict.end()) {
           if (it->second != score) {
             // Update existing
-            zset_ptr->insert({score, member});
+            zset_ptr->insert(score, member);
           }
         } else {
           // New insert
-          zset_ptr->insert({score, member});
+          zset_ptr->insert(score, member);
           added++;
         }
       }
       return ":" + std::to_string(added) + "\r\n";
 
     } else {
-      size_t target_core = topology.get_target_core(args[1]);
-      core::Message msg;
-      msg.type = core::MessageType::REQUEST;
-      msg.origin_core_id = core_id;
-      msg.conn_id = conn_id;
-      msg.key = args[1];
-      msg.args = args;
-      topology.get_channel(target_core)->push(msg);
-      topology.notify_core(target_core);
-      return "";
+      return topology.forward(core_id, conn_id, args);
+    }
+  }
+};
+
+/// @brief Append a score as a RESP bulk string, without trailing zeros.
+inline void append_score(std::string& out, double score) {
+  // Clean formatting for float? std::to_string gives trailing zeros.
+  // Redis removes trailing zeros usually.
+  std::string score_str = std::to_string(score);
+  // Strip trailing zeros
+  score_str.erase(score_str.find_last_not_of('0') + 1, std::string::npos);
+  if (score_str.back() == '.') score_str.pop_back();
+  append_bulk(out, score_str);
+}
+
+/// @brief Streams a long ZRANGE, in score order.
+class ZRangeJob : public ArrayReplyJob {
+ public:
+  ZRangeJob(core::Topology& topology, size_t core_id, std::string key, size_t start,
+            size_t elements, bool withscores)
+      : ArrayReplyJob(topology, core_id, std::move(key), elements),
+        start_(start),
+        withscores_(withscores) {}
+
+ protected:
+  size_t append(storage::Value& value, std::string& out, size_t max) override {
+    auto* zset_ptr = value.get_if<storage::ZSet>();
+    if (!zset_ptr) return 0;
+    auto it = zset_ptr->begin();
+    if (resumed_) {
+      it = zset_ptr->tree.upper_bound(storage::ZSetKey{last_score_, last_member_});
+    } else {
+      std::advance(it, std::min(start_, zset_ptr->size()));
+    }
+
+    size_t per_entry = withscores_ ? 2 : 1;
+    size_t n = 0;
+    for (; it != zset_ptr->end() && n + per_entry <= max; ++it, n += per_entry) {
+      append_bulk(out, it->member);
+      if (withscores_) append_score(out, it->score);
+      last_score_ = it->score;
+      last_member_ = it->member;
     }
+    resumed_ = true;
+    return n;
   }
+  size_t entry_size() const override {
+    return withscores_ ? 2 : 1;
+  }
+
+ private:
+  size_t start_;
+  bool withscores_;
+  double last_score_ = 0;  // Last entry sent
+  std::string last_member_;
+  bool resumed_ = false;
 };
 
 class ZRangeCommand : public core::Command {
@@ -101,7 +151,7 @@ class ZRangeCommand : public core::Command {
 
       if (!val) return "*0\r\n";
 
-      auto* zset_ptr = std::get_if<storage::ZSet>(val);
+      auto* zset_ptr = val->get_if<storage::ZSet>();
       if (!zset_ptr)
         return "-ERR WRONGTYPE Operation against a key holding the wrong kind "
                "of value\r\n";
@@ -126,23 +176,21 @@ class ZRangeCommand : public core::Command {
           if (opt == "WITHSCORES") withscores = true;
         }
 
-        std::string resp = "*" + std::to_string((stop - start + 1) * (withscores ? 2 : 1)) + "\r\n";
+        size_t elements = (stop - start + 1) * (withscores ? 2 : 1);
+        if (elements > STREAM_THRESHOLD) {
+          return topology.defer(core_id, conn_id,
+                                std::make_unique<ZRangeJob>(topology, core_id, key, start,
+                                                            elements, withscores));
+        }
+
+        std::string resp = "*" + std::to_string(elements) + "\r\n";
 
         auto it = zset_ptr->begin();
         std::advance(it, start);
         for (int i = start; i <= stop; ++i) {
           const auto& entry = *it;
-          resp += "$" + std::to_string(entry.member.size()) + "\r\n" + entry.member + "\r\n";
-          if (withscores) {
-            // Clean formatting for float? std::to_string gives trailing zeros.
-            // Redis removes trailing zeros usually.
-            std::string score_str = std::to_string(entry.score);
-            // Strip trailing zeros
-            score_str.erase(score_str.find_last_not_of('0') + 1, std::string::npos);
-            if (score_str.back() == '.') score_str.pop_back();
-
-            resp += "$" + std::to_string(score_str.size()) + "\r\n" + score_str + "\r\n";
-          }
+          append_bulk(resp, entry.member);
+          if (withscores) append_score(resp, entry.score);
           it++;
         }
         return resp;
@@ -152,16 +200,7 @@ class ZRangeCommand : public core::Command {
       }
 
     } else {
-      size_t target_core = topology.get_target_core(args[1]);
-      core::Message msg;
-      msg.type = core::MessageType::REQUEST;
-      msg.origin_core_id = core_id;
-      msg.conn_id = conn_id;
-      msg.key = args[1];
-      msg.args = args;
-      topology.get_channel(target_core)->push(msg);
-      topology.notify_core(target_core);
-      return "";
+      return topology.forward(core_id, conn_id, args);
     }
   }
 };
@@ -184,7 +223,7 @@ class ZRemCommand : public core::Command {
 
       if (!val) return ":0\r\n";
 
-      auto* zset_ptr = std::get_if<storage::ZSet>(val);
+      auto* zset_ptr = val->get_if<storage::ZSet>();
       if (!zset_ptr)
         return "-ERR WRONGTYPE Operation against a key holding the wrong kind "
                "of value\r\n";
@@ -198,24 +237,9 @@ class ZRemCommand : public core::Command {
       return ":" + std::to_string(removed) + "\r\n";
 
     } else {
-      return forward_request(topology, core_id, conn_id, args);
+      return topology.forward(core_id, conn_id, args);
     }
   }
-
- private:
-  std::string forward_request(core::Topology& topology, size_t core_id, uint32_t conn_id,
-                              const std::vector<std::string>& args) {
-    size_t target_core = topology.get_target_core(args[1]);
-    core::Message msg;
-    msg.type = core::MessageType::REQUEST;
-    msg.origin_core_id = core_id;
-    msg.conn_id = conn_id;
-    msg.key = args[1];
-    msg.args = args;
-    topology.get_channel(target_core)->push(msg);
-    topology.notify_core(target_core);
-    return "";
-  }
 };
 
 class ZCardCommand : public core::Command {
@@ -236,7 +260,7 @@ class ZCardCommand : public core::Command {
 
       if (!val) return ":0\r\n";
 
-      auto* zset_ptr = std::get_if<storage::ZSet>(val);
+      auto* zset_ptr = val->get_if<storage::ZSet>();
       if (!zset_ptr)
         return "-ERR WRONGTYPE Operation against a key holding the wrong kind "
                "of value\r\n";
@@ -244,24 +268,9 @@ class ZCardCommand : public core::Command {
       return ":" + std::to_string(zset_ptr->size()) + "\r\n";
 
     } else {
-      return forward_request(topology, core_id, conn_id, args);
+      return topology.forward(core_id, conn_id, args);
     }
   }
-
- private:
-  std::string forward_request(core::Topology& topology, size_t core_id, uint32_t conn_id,
-                              const std::vector<std::string>& args) {
-    size_t target_core = topology.get_target_core(args[1]);
-    core::Message msg;
-    msg.type = core::MessageType::REQUEST;
-    msg.origin_core_id = core_id;
-    msg.conn_id = conn_id;
-    msg.key = args[1];
-    msg.args = args;
-    topology.get_channel(target_core)->push(msg);
-    topology.notify_core(target_core);
-    return "";
-  }
 };
 
 class ZScoreCommand : public core::Command {
@@ -283,12 +292,12 @@ class ZScoreCommand : public core::Command {
 
       if (!val) return "$-1\r\n";
 
-      auto* zset_ptr = std::get_if<storage::ZSet>(val);
+      auto* zset_ptr = val->get_if<storage::ZSet>();
       if (!zset_ptr)
         return "-ERR WRONGTYPE Operation against a key holding the wrong kind "
                "of value\r\n";
 
-      auto it = zset_ptr->dict.find(member);
+      auto it = zset_ptr->dict.find(std::string_view(member));
       if (it == zset_ptr->dict.end()) {
         return "$-1\r\n";
       }
@@ -301,24 +310,9 @@ class ZScoreCommand : public core::Command {
       return "$" + std::to_string(score_str.size()) + "\r\n" + score_str + "\r\n";
 
     } else {
-      return forward_request(topology, core_id, conn_id, args);
+      return topology.forward(core_id, conn_id, args);
     }
   }
-
- private:
-  std::string forward_request(core::Topology& topology, size_t core_id, uint32_t conn_id,
-                              const std::vector<std::string>& args) {
-    size_t target_core = topology.get_target_core(args[1]);
-    core::Message msg;
-    msg.type = core::MessageType::REQUEST;
-    msg.origin_core_id = core_id;
-    msg.conn_id = conn_id;
-    msg.key = args[1];
-    msg.args = args;
-    topology.get_channel(target_core)->push(msg);
-    topology.notify_core(target_core);
-    return "";
-  }
 };
 
 }  // namespace commands
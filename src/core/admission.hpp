@@ -0,0 +1,24 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+namespace quine {
+namespace core {
+
+/// @brief When a core is too far behind to accept more forwarded requests.
+///
+/// A request forwarded to another core waits in that core's inbox until
+/// its event loop gets to it. Once the core has more requests queued than
+/// `max_queued_requests`, or its current loop iteration has run longer
+/// than `max_loop_lag`, new client requests for it are refused right away
+/// with a retryable -BUSY error instead of joining the queue. Latency then
+/// stays bounded while one shard takes a spike. Requests already queued,
+/// and requests forwarded again after a slot moved, are never shed.
+struct AdmissionLimits {
+  size_t max_queued_requests = 0;             // Per core; 0 = no limit
+  std::chrono::microseconds max_loop_lag{0};  // 0 = no limit
+};
+
+}  // namespace core
+}  // namespace quine
@@ -0,0 +1,91 @@
+#include "buffer_pool.hpp"
+
+#include <new>
+#include <stdexcept>
+
+namespace quine {
+namespace core {
+
+thread_local BufferPool* BufferPool::current_ = nullptr;
+
+static void free_list(BufferBlock* block) {
+  while (block) {
+    BufferBlock* next = block->next;
+    ::operator delete(block);
+    block = next;
+  }
+}
+
+void Buffer::reset() {
+  if (block_) {
+    block_->home->release(block_);
+    block_ = nullptr;
+  }
+}
+
+BufferPool::~BufferPool() {
+  free_list(free_);
+  free_list(remote_free_.exchange(nullptr, std::memory_order_acquire));
+}
+
+Buffer BufferPool::acquire(size_t size) {
+  if (size > UINT32_MAX) throw std::length_error("ITC buffer too large");
+
+  BufferBlock* block = nullptr;
+  if (size <= BLOCK_CAPACITY) {
+    if (!free_) reclaim_remote();
+    if (free_) {
+      block = free_;
+      free_ = block->next;
+      cached_--;
+    } else {
+      block = new (::operator new(BLOCK_SIZE)) BufferBlock{this, nullptr, BLOCK_CAPACITY, 0};
+    }
+  } else {
+    block = new (::operator new(sizeof(BufferBlock) + size))
+        BufferBlock{this, nullptr, static_cast<uint32_t>(size), 0};
+  }
+
+  block->size = static_cast<uint32_t>(size);
+  return Buffer(block);
+}
+
+void BufferPool::release(BufferBlock* block) {
+  if (block->capacity != BLOCK_CAPACITY) {
+    ::operator delete(block);  // Oversized: never cached
+  } else if (current_ == this) {
+    if (cached_ >= MAX_CACHED) {
+      ::operator delete(block);
+      return;
+    }
+    block->next = free_;
+    free_ = block;
+    cached_++;
+  } else {
+    // Foreign core: push onto the owner's return stack. Only the owner pops,
+    // and it takes the whole stack at once, so there is no ABA hazard.
+    BufferBlock* head = remote_free_.load(std::memory_order_relaxed);
+    do {
+      block->next = head;
+    } while (!remote_free_.compare_exchange_weak(head, block, std::memory_order_release,
+                                                 std::memory_order_relaxed));
+  }
+}
+
+void BufferPool::reclaim_remote() {
+  BufferBlock* block = remote_free_.exchange(nullptr, std::memory_order_acquire);
+  while (block) {
+    BufferBlock* next = block->next;
+    if (cached_ < MAX_CACHED) {
+      block->next = free_;
+      free_ = block;
+      cached_++;
+    } else {
+      ::operator delete(block);
+    }
+    block = next;
+  }
+}
+
+}  // namespace core
+}  // namespace quine
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace quine {
+namespace core {
+
+class BufferPool;
+
+/// @brief Header of a pooled allocation; the bytes follow it in memory.
+struct BufferBlock {
+  BufferPool* home;   // Pool the block is returned to
+  BufferBlock* next;  // Free-list link while the block is cached
+  uint32_t capacity;  // Usable bytes after the header
+  uint32_t size;      // Bytes in use
+
+  char* data() {
+    return reinterpret_cast<char*>(this + 1);
+  }
+};
+
+/// @brief Move-only handle to a byte buffer owned by a core's BufferPool.
+/// Destroying the handle returns the block to its home pool, on whatever
+/// core the handle ends up.
+class Buffer {
+ public:
+  Buffer() = default;
+  explicit Buffer(BufferBlock* block) : block_(block) {}
+  ~Buffer() {
+    reset();
+  }
+
+  Buffer(const Buffer&) = delete;
+  Buffer& operator=(const Buffer&) = delete;
+
+  Buffer(Buffer&& other) noexcept : block_(other.block_) {
+    other.block_ = nullptr;
+  }
+  Buffer& operator=(Buffer&& other) noexcept {
+    if (this != &other) {
+      reset();
+      block_ = other.block_;
+      other.block_ = nullptr;
+    }
+    return *this;
+  }
+
+  char* data() {
+    return block_ ? block_->data() : nullptr;
+  }
+  const char* data() const {
+    return block_ ? block_->data() : nullptr;
+  }
+  size_t size() const {
+    return block_ ? block_->size : 0;
+  }
+  bool empty() const {
+    return size() == 0;
+  }
+  std::string_view view() const {
+    return {data(), size()};
+  }
+
+  /// @brief Return the block to its pool (no-op on an empty handle).
+  void reset();
+
+ private:
+  BufferBlock* block_ = nullptr;
+};
+
+/// @brief Per-core cache of fixed-size buffer blocks for ITC payloads.
+///
+/// Only the owning core acquires. Blocks are released wherever their last
+/// handle dies: on the owning core they go straight back to the local free
+/// list, from other cores onto a lock-free return stack that the owner
+/// drains on its next acquire. Oversized requests bypass the cache.
+class BufferPool {
+ public:
+  static constexpr size_t BLOCK_SIZE = 1024;  // Bytes per pooled block, header included
+  static constexpr size_t MAX_CACHED = 1024;  // Free blocks kept per pool
+  static constexpr size_t BLOCK_CAPACITY = BLOCK_SIZE - sizeof(BufferBlock);
+
+  BufferPool() = default;
+  ~BufferPool();
+
+  BufferPool(const BufferPool&) = delete;
+  BufferPool& operator=(const BufferPool&) = delete;
+
+  /// @brief Get a buffer of `size` bytes (contents uninitialized).
+  /// Must be called by the owning core only.
+  Buffer acquire(size_t size);
+
+  /// @brief Mark this pool as the calling thread's own (worker startup).
+  void bind_to_current_thread() {
+    current_ = this;
+  }
+
+  /// @brief Number of free blocks in the local cache.
+  size_t cached() const {
+    return cached_;
+  }
+
+ private:
+  friend class Buffer;
+
+  // Any thread
+  void release(BufferBlock* block);
+  // Owner: move blocks returned by other cores into the local cache
+  void reclaim_remote();
+
+  BufferBlock* free_ = nullptr;  // Owner only
+  size_t cached_ = 0;
+  std::atomic<BufferBlock*> remote_free_{nullptr};
+
+  static thread_local BufferPool* current_;
+};
+
+}  // namespace core
+}  // namespace quine
@@ -18,12 +18,19 @@ class Command {
   /// @param topology Access to the cluster topology and shards.
   /// @param core_id The ID of the current core executing the command.
   /// @param args The command arguments (including the command name).
-  /// @return The RESP-formatted response string.
+  /// @return The RESP-formatted response string, or empty if the reply
+  /// comes later (Topology::forward, Topology::defer).
   virtual std::string execute(quine::core::Topology& topology, size_t core_id, uint32_t conn_id,
                               const std::vector<std::string>& args) = 0;
 
   /// @brief Get the command name (e.g., "SET").
   virtual std::string name() const = 0;
+
+  /// @brief Whether the command may add data; such commands are refused
+  /// while the server is over its maxmemory limit.
+  virtual bool grows_memory() const {
+    return false;
+  }
 };
 
 }  // namespace core
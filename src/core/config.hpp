@@ -3,6 +3,13 @@
 #include <string>
 #include <vector>
 
+#include "../network/client_limits.hpp"
+#include "../network/reuseport_group.hpp"
+#include "../storage/defragmenter.hpp"
+#include "../storage/table_allocator.hpp"
+#include "admission.hpp"
+#include "io_context.hpp"
+
 namespace quine {
 namespace core {
 
@@ -27,6 +34,51 @@ struct Config {
   // Network Configuration
   int port = 6379;
   int worker_threads = 0;  // 0 = auto-detect
+  // Upper bound for cores added at runtime (CLUSTER ADDCORE).
+  // 0 = no headroom beyond worker_threads.
+  int max_worker_threads = 0;
+  // Split topology: this many of the worker threads only serve clients and
+  // forward every command to the others, which only own shards.
+  // 0 = every worker does both.
+  int io_threads = 0;
+  // Close clients idle for this many seconds (0 = never). Clients waiting
+  // for a reply are not idle.
+  int timeout = 0;
+  // Which core's listener takes a new connection
+  network::Steering steering = network::Steering::HASH;
+  // Unix domain socket for clients on the same host ("" = none)
+  std::string unixsocket;
+  // Permissions of the socket file, e.g. 0770 (0 = left to the umask)
+  unsigned unixsocket_perm = 0;
+  // One socket per client core, "<unixsocket>.<core id>", instead of one
+  // shared by all cores
+  bool unixsocket_per_core = false;
+  // Output buffer limits and read backpressure, per client
+  network::ClientLimits client_limits;
+  // Load shedding: requests to an overloaded core fail with -BUSY
+  AdmissionLimits admission;
+
+  // CPU Affinity
+  bool pin_workers = true;
+  // The i-th worker launched runs on worker_cpus[i % size]: the data cores,
+  // then the I/O cores, then cores added at runtime. Empty = the CPUs in
+  // the process affinity mask, in order.
+  std::vector<int> worker_cpus;
+
+  // io_uring setup of every worker
+  RingConfig ring;
+  // With ring.sqpoll, the i-th worker's poller runs on sqpoll_cpus[i % size].
+  // Empty = unpinned.
+  std::vector<int> sqpoll_cpus;
+
+  // Memory Configuration
+  // Backing of tables of 2 MiB and more, such as each shard's key table
+  storage::HugePageMode huge_pages = storage::HugePageMode::OFF;
+  // Limit on the bytes held by all shards; writes are refused beyond it.
+  // 0 = unlimited.
+  size_t maxmemory = 0;
+  // Active defragmentation of shard memory (off by default)
+  storage::DefragConfig defrag;
 };
 
 }  // namespace core
@@ -0,0 +1,78 @@
+#include "cpu_affinity.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace quine {
+namespace core {
+
+static int parse_cpu(std::string_view text) {
+  if (text.empty()) throw std::invalid_argument("empty CPU number in CPU list");
+  int cpu = 0;
+  for (char c : text) {
+    if (c < '0' || c > '9') {
+      throw std::invalid_argument("invalid CPU number '" + std::string(text) + "'");
+    }
+    cpu = cpu * 10 + (c - '0');
+  }
+  return cpu;
+}
+
+std::vector<int> parse_cpu_list(std::string_view list) {
+  std::vector<int> cpus;
+  while (!list.empty()) {
+    size_t comma = list.find(',');
+    std::string_view item = list.substr(0, comma);
+    list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
+
+    size_t dash = item.find('-');
+    if (dash == std::string_view::npos) {
+      cpus.push_back(parse_cpu(item));
+      continue;
+    }
+    int first = parse_cpu(item.substr(0, dash));
+    int last = parse_cpu(item.substr(dash + 1));
+    if (last < first) throw std::invalid_argument("descending CPU range in CPU list");
+    for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+std::vector<int> allowed_cpus() {
+  std::vector<int> cpus;
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+    }
+  }
+#endif
+  if (cpus.empty()) {
+    for (unsigned cpu = 0; cpu < std::thread::hardware_concurrency(); ++cpu) {
+      cpus.push_back(static_cast<int>(cpu));
+    }
+  }
+  return cpus;
+}
+
+bool pin_current_thread(int cpu) {
+#ifdef __linux__
+  if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+  (void)cpu;
+  return false;
+#endif
+}
+
+}  // namespace core
+}  // namespace quine
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+namespace quine {
+namespace core {
+
+/// @brief Parse a CPU list like "0-3,8,10-11" (Linux cpuset syntax).
+/// @throws std::invalid_argument on malformed input.
+std::vector<int> parse_cpu_list(std::string_view list);
+
+/// @brief CPUs this process may run on (its affinity mask), in ascending order.
+/// Falls back to 0..hardware_concurrency-1 where affinity is not supported.
+std::vector<int> allowed_cpus();
+
+/// @brief Pin the calling thread to a single CPU.
+/// @return false if the platform or the kernel refused.
+bool pin_current_thread(int cpu);
+
+}  // namespace core
+}  // namespace quine
@@ -1,12 +1,16 @@
 #include "io_context.hpp"
 
 #include <fcntl.h>
+#include <sys/resource.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <cstring>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <utility>
 
 #include "liburing.h"
 #include "operation.hpp"
@@ -14,6 +18,17 @@
 #include <sys/eventfd.h>
 #endif
 
+// Setup flags missing from older liburing headers: never requested
+#ifndef IORING_SETUP_COOP_TASKRUN
+#define IORING_SETUP_COOP_TASKRUN 0U
+#endif
+#ifndef IORING_SETUP_SINGLE_ISSUER
+#define IORING_SETUP_SINGLE_ISSUER 0U
+#endif
+#ifndef IORING_SETUP_DEFER_TASKRUN
+#define IORING_SETUP_DEFER_TASKRUN 0U
+#endif
+
 namespace quine {
 namespace core {
 
@@ -38,13 +53,146 @@ struct IoContext::NotificationOp : public Operation {
   }
 };
 
-IoContext::IoContext(unsigned entries, uint32_t flags) {
+struct IoContext::TimerOp : public Operation {
+  IoContext* ctx;
+  struct __kernel_timespec ts {};  // Absolute, on the monotonic (steady) clock
+  explicit TimerOp(IoContext* c) : ctx(c) {}
+
+  void complete(int res) override {
+    (void)res;  // -ETIME: the timeout expired; -ECANCELED: see TimerUpdateOp
+    ctx->timer_armed_ = false;
+    ctx->timers_.advance(TimerWheel::Clock::now());
+  }
+};
+
+// Completion of a request moving the armed timeout
+struct IoContext::TimerUpdateOp : public Operation {
+  IoContext* ctx;
+  explicit TimerUpdateOp(IoContext* c) : ctx(c) {}
+
+  void complete(int res) override {
+    // -ENOENT: it expired meanwhile, and is re-armed after this tick
+    if (res != -EINVAL) return;
+    // No updates before Linux 5.11: cancel the timeout instead. It is
+    // re-armed once cancelled, from then on never past the next tick.
+    ctx->timer_updates_ = false;
+    struct io_uring_sqe* sqe = ctx->get_sqe();
+    io_uring_prep_timeout_remove(sqe, reinterpret_cast<uint64_t>(ctx->timer_op_.get()), 0);
+    io_uring_sqe_set_data(sqe, nullptr);
+  }
+};
+
+IoContext::IoContext(unsigned entries, uint32_t flags) : setup_flags_(flags) {
   int ret = io_uring_queue_init(entries, &ring_, flags);
   if (ret < 0) {
     throw std::system_error(-ret, std::generic_category(), "io_uring_queue_init failed");
   }
   setup_event_fd();
+  create_ops();
+}
+
+IoContext::IoContext(const RingConfig& config)
+    : zero_copy_send_min_(config.zero_copy_send_min),
+      busy_poll_max_(config.busy_poll_us),
+      busy_poll_(config.busy_poll_us) {
+  init_ring(config);
+  stats_.busy_poll_us.store(config.busy_poll_us, std::memory_order_relaxed);
+
+  // The table counts against the open-files limit
+  unsigned files = config.registered_files;
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < files) files = limit.rlim_cur;
+  if (files > 0) {
+    // Sparse table: -1 marks a free slot
+    std::vector<int> table(files, -1);
+    if (io_uring_register_files(&ring_, table.data(), table.size()) == 0) {
+      registered_files_ = files;
+      for (unsigned slot = registered_files_; slot > 0; --slot) free_slots_.push_back(slot - 1);
+    }
+  }
+
+  setup_event_fd();
+  event_slot_ = register_file(event_fd_);
+  create_ops();
+}
+
+void IoContext::create_ops() {
   notification_op_ = std::make_unique<NotificationOp>(this);
+  timer_op_ = std::make_unique<TimerOp>(this);
+  timer_update_op_ = std::make_unique<TimerUpdateOp>(this);
+}
+
+void IoContext::init_ring(const RingConfig& config) {
+  // Most capable first; each kernel takes the first set it supports
+  std::vector<uint32_t> candidates;
+  if (config.sqpoll) {
+    uint32_t sqpoll = IORING_SETUP_SQPOLL | (config.sqpoll_cpu >= 0 ? IORING_SETUP_SQ_AFF : 0);
+    if (config.single_issuer) candidates.push_back(sqpoll | IORING_SETUP_SINGLE_ISSUER);
+    candidates.push_back(sqpoll);
+  }
+  if (config.single_issuer && config.busy_poll_us > 0) {
+    // Deferred task work would hold completions back from the spinning loop
+    candidates.push_back(IORING_SETUP_SINGLE_ISSUER);
+  } else if (config.single_issuer) {
+    candidates.push_back(IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN);
+    candidates.push_back(IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN);
+    candidates.push_back(IORING_SETUP_COOP_TASKRUN);
+  }
+  candidates.push_back(0);
+
+  int ret = 0;
+  for (uint32_t flags : candidates) {
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    params.flags = flags;
+    if (flags & IORING_SETUP_SQPOLL) {
+      params.sq_thread_idle = config.sqpoll_idle_ms;
+      if (config.sqpoll_cpu >= 0) params.sq_thread_cpu = config.sqpoll_cpu;
+    }
+    ret = io_uring_queue_init_params(config.entries, &ring_, &params);
+    if (ret == 0) {
+      setup_flags_ = flags;
+      return;
+    }
+  }
+  throw std::system_error(-ret, std::generic_category(), "io_uring_queue_init failed");
+}
+
+std::string IoContext::features() const {
+  std::string out;
+  auto add = [&](const std::string& name) {
+    if (!out.empty()) out += ' ';
+    out += name;
+  };
+  const std::pair<uint32_t, const char*> flags[] = {
+      {IORING_SETUP_SQPOLL, "SQPOLL"},
+      {IORING_SETUP_SQ_AFF, "SQ_AFF"},
+      {IORING_SETUP_SINGLE_ISSUER, "SINGLE_ISSUER"},
+      {IORING_SETUP_DEFER_TASKRUN, "DEFER_TASKRUN"},
+      {IORING_SETUP_COOP_TASKRUN, "COOP_TASKRUN"},
+  };
+  for (const auto& [flag, name] : flags) {
+    if (flag != 0 && (setup_flags_ & flag) == flag) add(name);
+  }
+  if (registered_files_ > 0) {
+    add("REGISTERED_FILES(" + std::to_string(registered_files_) + ")");
+  }
+  return out.empty() ? "none" : out;
+}
+
+int IoContext::register_file(int fd) {
+  if (free_slots_.empty()) return -1;
+  int slot = free_slots_.back();
+  if (io_uring_register_files_update(&ring_, slot, &fd, 1) < 0) return -1;
+  free_slots_.pop_back();
+  return slot;
+}
+
+void IoContext::unregister_file(int slot) {
+  if (slot < 0) return;
+  int empty = -1;
+  io_uring_register_files_update(&ring_, slot, &empty, 1);
+  free_slots_.push_back(slot);
 }
 
 IoContext::~IoContext() {
@@ -87,6 +235,40 @@ void IoContext::set_notification_handler(std::function<void()> handler) {
   notification_handler_ = handler;
 }
 
+void IoContext::set_tick_handler(std::function<void()> handler) {
+  tick_handler_ = std::move(handler);
+}
+
+TimerWheel::Handle IoContext::schedule(std::chrono::steady_clock::duration delay,
+                                      TimerWheel::Callback callback) {
+  auto when = TimerWheel::Clock::now() + delay;
+  auto handle = timers_.schedule(when, std::move(callback));
+  if (!timer_armed_ || when < timer_deadline_) arm_timer();
+  return handle;
+}
+
+void IoContext::arm_timer() {
+  if (timers_.empty()) return;
+  auto next = timers_.next_expiry();
+  if (!timer_updates_) next = std::min(next, TimerWheel::Clock::now() + TimerWheel::TICK);
+  if (timer_armed_ && (next >= timer_deadline_ || !timer_updates_)) return;
+
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(next.time_since_epoch());
+  timer_op_->ts.tv_sec = ns.count() / 1000000000;
+  timer_op_->ts.tv_nsec = ns.count() % 1000000000;
+  struct io_uring_sqe* sqe = get_sqe();
+  if (timer_armed_) {
+    io_uring_prep_timeout_update(sqe, &timer_op_->ts, reinterpret_cast<uint64_t>(timer_op_.get()),
+                                 IORING_TIMEOUT_ABS);
+    io_uring_sqe_set_data(sqe, timer_update_op_.get());
+  } else {
+    io_uring_prep_timeout(sqe, &timer_op_->ts, 0, IORING_TIMEOUT_ABS);
+    io_uring_sqe_set_data(sqe, timer_op_.get());
+  }
+  timer_armed_ = true;
+  timer_deadline_ = next;
+}
+
 void IoContext::submit_notification_read() {
   if (event_fd_ < 0) return;
 
@@ -94,6 +276,7 @@ void IoContext::submit_notification_read() {
   // Use read on the event_fd
   // NotificationOp has the buffer member
   io_uring_prep_read(sqe, event_fd_, &notification_op_->buffer, sizeof(uint64_t), 0);
+  use_registered(sqe, event_slot_);
   io_uring_sqe_set_data(sqe, notification_op_.get());
 }
 
@@ -116,12 +299,50 @@ void IoContext::submit_and_wait(int wait_nr) {
   // check_error(ret, "io_uring_submit_and_wait"); // Stub often returns 0
 }
 
+bool IoContext::busy_poll() {
+  if (busy_poll_max_.count() == 0) return false;
+
+  io_uring_submit(&ring_);  // What this iteration queued goes out now
+  auto start = std::chrono::steady_clock::now();
+  auto deadline = start + busy_poll_;
+  bool found = false;
+  for (unsigned spins = 0;; ++spins) {
+    if (io_uring_cq_ready(&ring_) > 0 || (poll_handler_ && poll_handler_(true))) {
+      found = true;
+      break;
+    }
+    // The clock is read every few spins only
+    if (spins % 16 == 15 && std::chrono::steady_clock::now() >= deadline) break;
+  }
+  // Leaving the spin: the handler takes one last look before we sleep
+  if (!found && poll_handler_) found = poll_handler_(false);
+
+  auto spent = std::chrono::steady_clock::now() - start;
+  stats_.add(stats_.spin_us,
+             std::chrono::duration_cast<std::chrono::microseconds>(spent).count());
+  if (found) {
+    stats_.add(stats_.spin_hits, 1);
+    busy_poll_ = busy_poll_max_;
+  } else {
+    busy_poll_ = std::max(busy_poll_ / 2, busy_poll_max_ / 16);
+  }
+  stats_.busy_poll_us.store(busy_poll_.count(), std::memory_order_relaxed);
+  return found;
+}
+
 void IoContext::run() {
   // Submit the initial notification listener
   submit_notification_read();
 
-  while (true) {
-    submit_and_wait(1);
+  while (!stopped_) {
+    stats_.busy_since_ns.store(0, std::memory_order_relaxed);
+    if (!busy_poll()) {
+      stats_.add(stats_.sleeps, 1);
+      submit_and_wait(1);
+    }
+    auto woke = std::chrono::steady_clock::now().time_since_epoch();
+    stats_.busy_since_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(woke).count(),
+                               std::memory_order_relaxed);
 
     struct io_uring_cqe* cqe;
     unsigned head;
@@ -132,13 +353,19 @@ void IoContext::run() {
       count++;
       if (cqe->user_data) {
         auto* op = reinterpret_cast<Operation*>(cqe->user_data);
-        op->complete(cqe->res);
+        op->complete_with_flags(cqe->res, cqe->flags);
       }
     }
 
     if (count > 0) {
       io_uring_cq_advance(&ring_, count);
     }
+
+    if (tick_handler_) {
+      tick_handler_();
+    }
+    // Timers left after this tick's callbacks keep the wheel turning
+    if (!timer_armed_) arm_timer();
   }
 }
 
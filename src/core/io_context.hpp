@@ -2,21 +2,57 @@
 
 #include <liburing.h>
 
+#include <chrono>
 #include <cstdint>
 #include <functional>  // [NEW]
 #include <memory>
+#include <string>
 #include <system_error>
 #include <vector>
 
+#include "loop_stats.hpp"
+#include "timer_wheel.hpp"
+
 namespace quine {
 namespace core {
 
+/// @brief How a worker's ring is set up. Features the kernel does not
+/// support are dropped at startup; IoContext::features() tells what is on.
+struct RingConfig {
+  unsigned entries = 4096;
+  // A kernel thread polls the submission queue, so submitting takes no
+  // syscall, at the cost of one polling CPU per worker
+  bool sqpoll = false;
+  int sqpoll_cpu = -1;             // CPU of the poller; -1 = unpinned
+  unsigned sqpoll_idle_ms = 1000;  // The poller sleeps after this long idle
+  // Only the owning thread submits (thread-per-core), and completion work
+  // runs when it waits for events instead of interrupting it
+  // (SINGLE_ISSUER + DEFER_TASKRUN, or COOP_TASKRUN on older kernels)
+  bool single_issuer = true;
+  // Slots in the registered file table (eventfd, connections), which saves
+  // an fd-table lookup per operation. 0 = raw fds only.
+  unsigned registered_files = 4096;
+  // Before sleeping, spin up to this long for completions and poll-handler
+  // work (ITC messages), trading CPU for wakeup latency. 0 = always sleep.
+  // Completions must then be posted without a syscall, so DEFER_TASKRUN and
+  // COOP_TASKRUN are not used.
+  unsigned busy_poll_us = 0;
+  // Stored values of at least this many bytes are sent with
+  // IORING_OP_SEND_ZC: the NIC reads them where they are, and they stay
+  // pinned until the kernel's notification. 0 = plain writes only.
+  size_t zero_copy_send_min = 64 * 1024;
+};
+
 class IoContext {
  public:
   /// @brief Initializes the io_uring instance.
   /// @param entries Size of the submission/completion queue rings.
   /// @param flags Configuration flags for io_uring setup.
   explicit IoContext(unsigned entries = 4096, uint32_t flags = 0);
+
+  /// @brief Initializes the io_uring instance from a profile, falling back
+  /// to fewer features when the kernel refuses some.
+  explicit IoContext(const RingConfig& config);
   ~IoContext();
 
   // Delete copy/move to prevent double-free of ring for now
@@ -34,19 +70,74 @@ class IoContext {
   /// @param wait_nr Minimum number of completions to wait for (default 1).
   void submit_and_wait(int wait_nr = 1);
 
-  /// @brief Run the event loop indefinitely.
+  /// @brief Run the event loop until stop() is called.
   /// Dispatches completions to the Operation* stored in user_data.
   void run();
 
+  /// @brief Make run() return at the end of the current iteration (called
+  /// from a completion or handler on the loop's own thread).
+  void stop() {
+    stopped_ = true;
+  }
+
   /// @brief Register a callback to be invoked when the event_fd is signaled.
   /// Used for integrating ITC/Messaging.
   void set_notification_handler(std::function<void()> handler);
 
+  /// @brief Register the busy-poll hook (see RingConfig::busy_poll_us). It
+  /// is called repeatedly while the loop spins, with `spinning` set, and
+  /// once with `spinning` clear right before the loop sleeps.
+  /// @return true if it found (and did) work: the loop then does not sleep.
+  void set_poll_handler(std::function<bool(bool spinning)> handler) {
+    poll_handler_ = std::move(handler);
+  }
+
+  /// @brief Register a callback invoked once per event-loop iteration, after
+  /// all ready completions have been dispatched. Used to flush work batched
+  /// during the iteration (e.g. cross-core messages).
+  void set_tick_handler(std::function<void()> handler);
+
+  // Registered files
+
+  /// @brief Put `fd` in the ring's file table.
+  /// @return Its slot, or -1 if the table is full or disabled (use the fd).
+  int register_file(int fd);
+
+  /// @brief Free a slot from register_file() (no-op for -1).
+  void unregister_file(int slot);
+
+  /// @brief Point a prepared SQE at registered file `slot` instead of its
+  /// raw fd (no-op for -1).
+  static void use_registered(struct io_uring_sqe* sqe, int slot) {
+    if (slot < 0) return;
+    sqe->fd = slot;
+    sqe->flags |= IOSQE_FIXED_FILE;
+  }
+
   // Accessors
   struct io_uring* get_ring() {
     return &ring_;
   }
 
+  /// @brief Loop counters (busy-poll time and outcomes).
+  const LoopStats& stats() const {
+    return stats_;
+  }
+
+  /// @brief Size from which stored values are sent zero-copy (0 = never).
+  size_t zero_copy_send_min() const {
+    return zero_copy_send_min_;
+  }
+
+  /// @brief Setup flags the ring runs with.
+  uint32_t setup_flags() const {
+    return setup_flags_;
+  }
+
+  /// @brief Active optional features, for the startup log
+  /// (e.g. "SINGLE_ISSUER DEFER_TASKRUN REGISTERED_FILES(4096)").
+  std::string features() const;
+
   /// @brief Helper for cross-thread wakeups.
   /// On Linux: eventfd. On macOS: pipe.
   /// Returns the read-end FD.
@@ -65,24 +156,88 @@ class IoContext {
   /// @brief Notify the event loop (wake up from wait).
   void notify();
 
+  // Timers
+
+  /// @brief Run `callback` on this loop once `delay` has passed (rounded up
+  /// to TimerWheel::TICK). O(1); call from the loop's own thread.
+  TimerWheel::Handle schedule(std::chrono::steady_clock::duration delay,
+                              TimerWheel::Callback callback);
+
+  /// @brief Cancel a timer from schedule(). No-op if it already fired.
+  bool cancel(TimerWheel::Handle handle) {
+    return timers_.cancel(handle);
+  }
+
+  /// @brief Timers pending on this loop.
+  size_t timer_count() const {
+    return timers_.size();
+  }
+
   /// @brief Submit a read request for the eventfd/pipe (internal use).
   void submit_notification_read();  // [NEW]
 
  private:
   struct io_uring ring_;
-  int event_fd_ = -1;   // Read end
-  int notify_fd_ = -1;  // Write end
+  uint32_t setup_flags_ = 0;
+  int event_fd_ = -1;    // Read end
+  int notify_fd_ = -1;   // Write end
+  int event_slot_ = -1;  // Registered slot of event_fd_
+
+  // Registered file table: size and free slots (stack)
+  unsigned registered_files_ = 0;
+  std::vector<int> free_slots_;
+  bool stopped_ = false;
+  size_t zero_copy_send_min_ = RingConfig().zero_copy_send_min;
 
   // Notification handling
   std::function<void()> notification_handler_;  // [NEW]
+  std::function<void()> tick_handler_;
+  std::function<bool(bool)> poll_handler_;
+
+  // Busy polling: the window shrinks while spins come back empty and is
+  // reset by the first one that finds work
+  std::chrono::microseconds busy_poll_max_{0};
+  std::chrono::microseconds busy_poll_{0};
+  LoopStats stats_;
 
   struct NotificationOp;  // [NEW] Forward decl
   friend struct NotificationOp;
   std::unique_ptr<NotificationOp> notification_op_;  // [NEW]
 
+  // One ring timeout, in flight while timers are pending, drives the wheel.
+  // It expires when the earliest timer is due, not every tick, so a loop
+  // with only distant timers sleeps until then.
+  TimerWheel timers_;
+  struct TimerOp;
+  struct TimerUpdateOp;
+  friend struct TimerOp;
+  friend struct TimerUpdateOp;
+  std::unique_ptr<TimerOp> timer_op_;
+  std::unique_ptr<TimerUpdateOp> timer_update_op_;
+  bool timer_armed_ = false;
+  TimerWheel::Clock::time_point timer_deadline_;  // Of the armed timeout
+  // Kernels before 5.11 cannot move an armed timeout. Once one refused,
+  // it expires every tick instead, as any new earlier timer may be due
+  bool timer_updates_ = true;
+
+  // Arm the ring timeout for the earliest timer, or bring an armed one
+  // forward if that timer is due sooner
+  void arm_timer();
+
+  // Spin for work for up to the busy-poll window.
+  // @return true if some was found: completions, or poll-handler work
+  bool busy_poll();
+
+  // Create the ring with the first flag set the kernel accepts
+  void init_ring(const RingConfig& config);
+
   // Setup notification mechanism
   void setup_event_fd();
 
+  // Allocate the operations the context submits for itself (notification,
+  // timers), whichever constructor built it
+  void create_ops();
+
   // Check ring status
   void check_error(int result, const char* msg);
 };
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <deque>
 #include <functional>
 #include <mutex>
@@ -23,6 +24,7 @@ class ItcChannel {
   void push(T item) {
     std::lock_guard<std::mutex> lock(mutex_);
     queue_.push_back(std::move(item));
+    size_.store(queue_.size(), std::memory_order_seq_cst);
     // TODO: Signal eventfd here to wake up the consumer's event loop!
   }
 
@@ -36,6 +38,7 @@ class ItcChannel {
     }
     T item = std::move(queue_.front());
     queue_.pop_front();
+    size_.store(queue_.size(), std::memory_order_relaxed);
     return item;
   }
 
@@ -47,6 +50,7 @@ class ItcChannel {
     {
       std::lock_guard<std::mutex> lock(mutex_);
       batch.swap(queue_);
+      size_.store(0, std::memory_order_relaxed);
     }
 
     for (auto& item : batch) {
@@ -59,9 +63,18 @@ class ItcChannel {
     return queue_.empty();
   }
 
+  /// @brief Lock-free check for the consumer's busy-poll loop: true if an
+  /// item was pushed and not consumed yet. Sequentially consistent, so a
+  /// consumer that stops polling and then checks, pairs with a producer
+  /// that pushes and then checks whether the consumer polls.
+  bool has_items() const {
+    return size_.load(std::memory_order_seq_cst) != 0;
+  }
+
  private:
   std::deque<T> queue_;
   mutable std::mutex mutex_;
+  std::atomic<size_t> size_{0};
 };
 
 }  // namespace core
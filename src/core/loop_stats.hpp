@@ -0,0 +1,37 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace quine {
+namespace core {
+
+/// @brief Event-loop counters of one core, written by its thread and
+/// readable from any core (INFO).
+struct LoopStats {
+  std::atomic<uint64_t> busy_poll_us{0};  // Current spin window; 0 = busy-poll off
+  std::atomic<uint64_t> spin_us{0};       // Time spent spinning, in total
+  std::atomic<uint64_t> spin_hits{0};     // Spins that found work
+  std::atomic<uint64_t> sleeps{0};        // Times the loop blocked in the kernel
+  // Start of the iteration being run (steady clock, ns); 0 while waiting
+  std::atomic<int64_t> busy_since_ns{0};
+
+  void add(std::atomic<uint64_t>& counter, uint64_t n) {
+    // Single writer: no read-modify-write needed
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  /// @brief How long the current iteration has been running: how late the
+  /// loop is to look at new work. Zero while it waits for some.
+  std::chrono::microseconds lag() const {
+    int64_t since = busy_since_ns.load(std::memory_order_relaxed);
+    if (since == 0) return std::chrono::microseconds(0);
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        now - std::chrono::nanoseconds(since));
+  }
+};
+
+}  // namespace core
+}  // namespace quine
@@ -1,26 +1,118 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring>
+#include <memory>
 #include <string>
-#include <variant>
 #include <vector>
 
+#include "../storage/value.hpp"
+#include "buffer_pool.hpp"
+#include "router.hpp"
+
 namespace quine {
+namespace network {
+class Connection;
+}
+
 namespace core {
 
-enum class MessageType { REQUEST, RESPONSE };
+enum class MessageType : uint8_t {
+  REQUEST,
+  RESPONSE,
+  BATCH,          // Several REQUEST/RESPONSE messages for the same core
+  MIGRATE_START,  // Source core: begin moving `migration->slot_moves` to their targets
+  MIGRATE_STEP,   // Source core (self-posted): move the next batch of keys
+  MIGRATE_BATCH,  // Target core: install `migration->keys`
+  CORE_RETIRE,    // Core leaves the active set: stop accepting connections
+  CORE_RESUME,    // Parked core rejoins the active set: accept again
+  CONN_HANDOFF,   // Target core: adopt `migration->connection`
+  FLUSH           // Drop every key of the target's shard (FLUSHALL), lazily if `lazy`
+};
 
-struct Message {
-  MessageType type;
-  size_t origin_core_id;  // [NEW] To route response back to the correct core
-  uint32_t conn_id;       // To route response back to the correct connection
+/// @brief A key handed over to another shard during slot migration.
+struct MigratedKey {
   std::string key;
-  std::vector<std::string> args;  // For the command (e.g. SET key value)
+  storage::Value value;
+  long long expiry_ms;  // -1 if the key has no TTL
+};
+
+/// @brief Payload of slot and connection migration messages (rare, kept out of line).
+struct MigrationPayload {
+  std::vector<Router::SlotMove> slot_moves;   // MIGRATE_START
+  std::vector<MigratedKey> keys;              // MIGRATE_BATCH
+  network::Connection* connection = nullptr;  // CONN_HANDOFF, owned by the receiver
+};
+
+/// @brief Inter-core message. Move-only and one cache line: the request
+/// arguments or reply bytes travel in a pooled Buffer that returns to the
+/// sending core's pool once the receiver drops the message.
+struct Message {
+  MessageType type = MessageType::REQUEST;
+  bool asking = false;          // ASK redirect for a slot being imported
+  bool lazy = false;            // FLUSH: leave large values to the reclaimer
+  bool partial = false;         // RESPONSE: more parts of this reply follow
+  uint32_t origin_core_id = 0;  // Core holding the client connection
+  uint32_t conn_id = 0;         // To route response back to the correct connection
+  uint64_t seq = 0;             // Request order on the connection (replies are written in order)
+
+  // REQUEST: encoded arguments (see encode_args). RESPONSE: RESP reply bytes.
+  Buffer payload;
+
+  // For BATCH: messages coalesced during one event-loop tick
+  std::vector<Message> batch;
+
+  // For slot migration
+  std::unique_ptr<MigrationPayload> migration;
 
-  // For Response
-  std::string payload;
-  bool success;
+  Message() = default;
+  Message(Message&&) noexcept = default;
+  Message& operator=(Message&&) noexcept = default;
+  Message(const Message&) = delete;
+  Message& operator=(const Message&) = delete;
 };
 
+static_assert(sizeof(Message) <= 64, "Message should fit in one cache line");
+
+/// @brief Pack command arguments into one pooled buffer:
+/// [u32 argc] then [u32 len][bytes] per argument.
+inline Buffer encode_args(BufferPool& pool, const std::vector<std::string>& args) {
+  size_t size = sizeof(uint32_t);
+  for (const auto& arg : args) size += sizeof(uint32_t) + arg.size();
+
+  Buffer buf = pool.acquire(size);
+  char* out = buf.data();
+  auto put_u32 = [&](uint32_t v) {
+    std::memcpy(out, &v, sizeof(v));
+    out += sizeof(v);
+  };
+  put_u32(static_cast<uint32_t>(args.size()));
+  for (const auto& arg : args) {
+    put_u32(static_cast<uint32_t>(arg.size()));
+    std::memcpy(out, arg.data(), arg.size());
+    out += arg.size();
+  }
+  return buf;
+}
+
+/// @brief Unpack arguments written by encode_args into `args`.
+/// Reuses the strings already in `args`, so a per-core scratch vector
+/// decodes without allocating once warmed up.
+inline void decode_args(const Buffer& buf, std::vector<std::string>& args) {
+  const char* in = buf.data();
+  auto get_u32 = [&]() {
+    uint32_t v;
+    std::memcpy(&v, in, sizeof(v));
+    in += sizeof(v);
+    return v;
+  };
+  args.resize(get_u32());
+  for (auto& arg : args) {
+    uint32_t len = get_u32();
+    arg.assign(in, len);
+    in += len;
+  }
+}
+
 }  // namespace core
 }  // namespace quine
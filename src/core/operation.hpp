@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 namespace quine {
 namespace core {
 
@@ -12,6 +14,14 @@ struct Operation {
   /// @param res The result of the operation (e.g., number of bytes read, or
   /// -errno).
   virtual void complete(int res) = 0;
+
+  /// @brief Called instead, with the completion's flags, by the event loop.
+  /// Only operations that post several completions (IORING_CQE_F_MORE)
+  /// need them.
+  virtual void complete_with_flags(int res, uint32_t flags) {
+    (void)flags;
+    complete(res);
+  }
 };
 
 }  // namespace core
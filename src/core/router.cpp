@@ -1,64 +1,132 @@
 #include "router.hpp"
 
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
 namespace quine {
 namespace core {
 
-// Basic wrapper around std::hash or similar.
-static uint32_t hash_key(const std::string& key) {
-  // Use FNV-1a or similar simple hash
-  uint32_t hash = 2166136261u;
-  for (char c : key) {
-    hash ^= (uint8_t)c;
-    hash *= 16777619;
+// CRC16-CCITT (XMODEM) lookup table, generated at compile time.
+static constexpr std::array<uint16_t, 256> make_crc16_table() {
+  std::array<uint16_t, 256> table{};
+  for (int i = 0; i < 256; i++) {
+    uint16_t crc = static_cast<uint16_t>(i << 8);
+    for (int j = 0; j < 8; j++) {
+      if (crc & 0x8000)
+        crc = (crc << 1) ^ 0x1021;
+      else
+        crc = crc << 1;
+    }
+    table[i] = crc;
   }
-  return hash;
+  return table;
 }
 
+static constexpr std::array<uint16_t, 256> CRC16_TABLE = make_crc16_table();
+
 Router::Router(size_t num_shards) : num_shards_(num_shards) {
-  initialize_ring(num_shards);
+  if (num_shards > NUM_SLOTS) {
+    throw std::invalid_argument("Router: more shards than hash slots");
+  }
+  for (size_t slot = 0; slot < NUM_SLOTS; ++slot) {
+    slots_[slot].store(num_shards == 0 ? 0 : static_cast<uint16_t>(slot * num_shards / NUM_SLOTS),
+                       std::memory_order_relaxed);
+    migrating_to_[slot].store(NO_SHARD, std::memory_order_relaxed);
+  }
 }
 
-void Router::initialize_ring(size_t num_shards) {
-  if (num_shards == 0) return;
-  ring_.clear();
-  for (size_t shard_id = 0; shard_id < num_shards; ++shard_id) {
-    for (size_t v = 0; v < VIRTUAL_NODES_PER_SHARD; ++v) {
-      std::string virtual_node_key =
-          "SHARD-" + std::to_string(shard_id) + "-VN-" + std::to_string(v);
-      uint32_t hash = hash_key(virtual_node_key);
-      ring_[hash] = shard_id;
-    }
+void Router::assign_slot(uint16_t slot, size_t shard_id) {
+  if (slot >= NUM_SLOTS) throw std::out_of_range("Invalid slot");
+  slots_[slot].store(static_cast<uint16_t>(shard_id), std::memory_order_release);
+}
+
+void Router::set_migration_target(uint16_t slot, size_t shard_id) {
+  if (slot >= NUM_SLOTS) throw std::out_of_range("Invalid slot");
+  migrating_to_[slot].store(static_cast<uint16_t>(shard_id), std::memory_order_release);
+}
+
+std::vector<size_t> Router::slots_per_shard() const {
+  std::vector<size_t> counts(num_shards(), 0);
+  for (const auto& entry : slots_) {
+    size_t owner = entry.load(std::memory_order_relaxed);
+    if (owner >= counts.size()) counts.resize(owner + 1, 0);
+    counts[owner]++;
   }
+  return counts;
 }
 
-size_t Router::get_shard_id(const std::string& key) const {
-  if (num_shards_ == 0) return 0;
+std::vector<Router::SlotMove> Router::plan_rebalance(size_t num_shards) const {
+  if (num_shards == 0 || num_shards > NUM_SLOTS) {
+    throw std::invalid_argument("Router: invalid shard count for rebalance");
+  }
+
+  std::vector<size_t> counts = slots_per_shard();
+  if (counts.size() < num_shards) counts.resize(num_shards, 0);
+
+  // Target: NUM_SLOTS / n each, the `extra` largest shards keep one more.
+  // Picking the currently largest shards for the extra slot minimizes moves.
+  size_t base = NUM_SLOTS / num_shards;
+  size_t extra = NUM_SLOTS % num_shards;
 
-  if (ring_.empty()) {
-    // Fallback
-    return crc16(key) % num_shards_;
+  std::vector<size_t> order(num_shards);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](size_t a, size_t b) { return counts[a] > counts[b]; });
+
+  std::vector<size_t> target(counts.size(), 0);  // Retired shards keep 0
+  for (size_t i = 0; i < num_shards; ++i) {
+    target[order[i]] = base + (i < extra ? 1 : 0);
+  }
+
+  // Collect surplus slots from over-full shards, highest slots first
+  std::vector<size_t> surplus(counts.size(), 0);
+  for (size_t s = 0; s < counts.size(); ++s) {
+    if (counts[s] > target[s]) surplus[s] = counts[s] - target[s];
   }
 
-  uint32_t hash = hash_key(key);
-  auto it = ring_.lower_bound(hash);
-  if (it == ring_.end()) {
-    // Wrap around
-    it = ring_.begin();
+  std::vector<SlotMove> moves;
+  size_t receiver = 0;
+  for (size_t slot = NUM_SLOTS; slot-- > 0;) {
+    size_t owner = get_slot_owner(static_cast<uint16_t>(slot));
+    if (surplus[owner] == 0) continue;
+
+    while (counts[receiver] >= target[receiver]) receiver++;
+
+    moves.push_back({static_cast<uint16_t>(slot), owner, receiver});
+    surplus[owner]--;
+    counts[owner]--;
+    counts[receiver]++;
   }
-  return it->second;
+  return moves;
 }
 
-// Standard CRC16 implementation (XMODEM)
-uint16_t Router::crc16(const std::string& key) {
+size_t Router::rebalance(size_t num_shards) {
+  auto moves = plan_rebalance(num_shards);
+  for (const auto& move : moves) {
+    assign_slot(move.slot, move.to);
+  }
+  set_num_shards(num_shards);
+  return moves.size();
+}
+
+std::string_view Router::hash_tag(std::string_view key) {
+  size_t open = key.find('{');
+  if (open == std::string_view::npos) return key;
+
+  size_t close = key.find('}', open + 1);
+  if (close == std::string_view::npos || close == open + 1) {
+    // No closing brace or empty tag "{}": hash the whole key
+    return key;
+  }
+  return key.substr(open + 1, close - open - 1);
+}
+
+// Standard CRC16 implementation (XMODEM), table driven
+uint16_t Router::crc16(std::string_view key) {
   uint16_t crc = 0;
   for (char c : key) {
-    crc = crc ^ ((uint16_t)c << 8);
-    for (int i = 0; i < 8; i++) {
-      if (crc & 0x8000)
-        crc = (crc << 1) ^ 0x1021;
-      else
-        crc = crc << 1;
-    }
+    crc = (crc << 8) ^ CRC16_TABLE[((crc >> 8) ^ static_cast<uint8_t>(c)) & 0xFF];
   }
   return crc;
 }
@@ -1,41 +1,117 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <cstdint>
-#include <map>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace quine {
 namespace core {
 
 /// @brief Handles key-to-shard mapping (Routing).
-/// Currently supports static partitioning based on modulo hashing.
-/// Flexible enough to be extended to Consistent Hashing (Ring) later.
+/// Keys are hashed into one of NUM_SLOTS Redis Cluster compatible slots, and
+/// a flat slot table maps every slot to its owning shard. Routing a key is a
+/// CRC16 followed by a single array load; rebalancing moves individual slots
+/// instead of rebuilding the whole mapping.
+///
+/// The table is shared by all cores. Entries are atomics so that a slot can
+/// be handed to another shard while the node is serving traffic; a slot that
+/// is being moved is marked with its migration target until the move is done.
+///
+/// Keys containing a Redis-style hash tag (e.g. `user:{42}:cart`) are routed
+/// by the tag only, so related keys always land on the same shard.
 class Router {
  public:
+  /// @brief Number of hash slots in the Redis Cluster keyspace.
+  static constexpr uint16_t NUM_SLOTS = 16384;
+
+  /// @brief Marker for "no shard" (e.g. slot not being migrated).
+  static constexpr size_t NO_SHARD = UINT16_MAX;
+
+  /// @brief A single slot reassignment produced by plan_rebalance().
+  struct SlotMove {
+    uint16_t slot;
+    size_t from;
+    size_t to;
+  };
+
   /// @brief Initialize the router with the number of shards (cores).
+  /// Slots are split into contiguous, evenly sized ranges.
   /// @param num_shards Total number of available shards.
   explicit Router(size_t num_shards);
 
   /// @brief Determines which shard owns the given key.
   /// @param key The key to look up.
   /// @return The Shard ID (0 to num_shards - 1).
-  size_t get_shard_id(const std::string& key) const;
+  size_t get_shard_id(std::string_view key) const {
+    return slots_[key_slot(key)].load(std::memory_order_acquire);
+  }
+
+  /// @brief Returns the shard currently owning a slot.
+  size_t get_slot_owner(uint16_t slot) const {
+    return slots_[slot].load(std::memory_order_acquire);
+  }
+
+  /// @brief Reassign a single slot to another shard.
+  /// Only updates the routing table; moving the keys is up to the caller.
+  void assign_slot(uint16_t slot, size_t shard_id);
+
+  /// @brief Mark a slot as being migrated to `shard_id` (NO_SHARD to clear).
+  /// While set, the owner keeps serving keys it still holds and redirects
+  /// everything else to the target (Redis MIGRATING/IMPORTING semantics).
+  void set_migration_target(uint16_t slot, size_t shard_id);
+
+  /// @brief Shard a slot is being migrated to, or NO_SHARD.
+  size_t get_migration_target(uint16_t slot) const {
+    return migrating_to_[slot].load(std::memory_order_acquire);
+  }
+
+  /// @brief Number of slots owned by each shard (indexed by shard id).
+  std::vector<size_t> slots_per_shard() const;
+
+  /// @brief Compute the minimal set of slot moves that evenly spreads the
+  /// slots over num_shards shards. Shards >= num_shards give up all slots.
+  std::vector<SlotMove> plan_rebalance(size_t num_shards) const;
+
+  /// @brief Apply plan_rebalance(num_shards) to the table.
+  /// @return Number of slots that changed owner.
+  size_t rebalance(size_t num_shards);
+
+  size_t num_shards() const {
+    return num_shards_.load(std::memory_order_acquire);
+  }
+
+  /// @brief Update the number of shards slots are spread over.
+  void set_num_shards(size_t num_shards) {
+    num_shards_.store(num_shards, std::memory_order_release);
+  }
+
+  /// @brief Returns the part of the key that is hashed for routing.
+  /// Follows Redis Cluster rules: if the key contains a '{' followed later by
+  /// a '}' with at least one character in between, only the content of the
+  /// first such pair is hashed. Otherwise the whole key is used.
+  static std::string_view hash_tag(std::string_view key);
+
+  /// @brief Redis Cluster compatible hash slot of a key (CLUSTER KEYSLOT).
+  /// @return CRC16 of the hash tag modulo NUM_SLOTS.
+  static uint16_t key_slot(std::string_view key) {
+    return crc16(hash_tag(key)) & (NUM_SLOTS - 1);
+  }
 
   /// @brief Calculates CRC16 hash of a string.
   /// Used internally but exposed for testing/debug.
-  static uint16_t crc16(const std::string& key);
+  static uint16_t crc16(std::string_view key);
 
  private:
-  // Maps Hash -> ShardID
-  std::map<uint32_t, size_t> ring_;
-
-  // Number of virtual nodes per shard
-  static const size_t VIRTUAL_NODES_PER_SHARD = 100;
+  // Slot -> ShardID. 16384 * 2 bytes = 32 KiB, small enough to stay cached.
+  std::array<std::atomic<uint16_t>, NUM_SLOTS> slots_;
 
-  size_t num_shards_;  // Kept for fallback or reloading
+  // Slot -> migration target (NO_SHARD when the slot is stable)
+  std::array<std::atomic<uint16_t>, NUM_SLOTS> migrating_to_;
 
-  void initialize_ring(size_t num_shards);
+  std::atomic<size_t> num_shards_;
 };
 
 }  // namespace core
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace quine {
+namespace core {
+
+/// @brief A command whose reply takes long to produce (a huge collection,
+/// SAVE). It runs in time slices between event-loop iterations instead of
+/// in one go, and its reply is sent in parts as they are produced.
+class Job {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  virtual ~Job() = default;
+
+  /// @brief Append the next part of the reply to `out`. Implementations
+  /// check `deadline` after each bounded chunk of work and return once it
+  /// has passed.
+  /// @return true when the reply is complete.
+  virtual bool resume(std::string& out, Clock::time_point deadline) = 0;
+};
+
+/// @brief Per-core queue of Jobs, run round robin from the event-loop tick
+/// within a time budget. Commands queue jobs via Topology::defer; regular
+/// requests are served between slices, so their latency stays bounded while
+/// big replies stream. A job whose client is not ready for more (see
+/// set_ready) skips its slices until it is, so a reply is generated at the
+/// speed the client consumes it rather than buffered whole.
+class Scheduler {
+ public:
+  /// @brief Maximum time spent on jobs per event-loop iteration.
+  static constexpr std::chrono::microseconds BUDGET{500};
+
+  /// @brief Where a job's reply goes: the request it answers.
+  struct Target {
+    size_t origin_core_id;  // Core holding the client connection
+    uint32_t conn_id;
+    uint64_t seq;
+  };
+
+  /// @brief Receives each part of a reply; `last` marks the final one.
+  /// Returns false if the client is gone, which cancels the job.
+  using Sink = std::function<bool(const Target&, std::string_view part, bool last)>;
+
+  /// @brief Whether the target can take another part now. A job waiting
+  /// for it needs no tick: the write completion that makes room runs one.
+  using Ready = std::function<bool(const Target&)>;
+
+  /// @brief Set where replies go (the worker's connections, or other cores).
+  void set_sink(Sink sink) {
+    sink_ = std::move(sink);
+  }
+
+  /// @brief Set the readiness check; without one, jobs always run.
+  void set_ready(Ready ready) {
+    ready_ = std::move(ready);
+  }
+
+  /// @brief Send (a part of) a reply produced outside a job, e.g. by a
+  /// coroutine.
+  /// @return false if the client is gone.
+  bool deliver(const Target& target, std::string_view part, bool last) {
+    return sink_ && sink_(target, part, last);
+  }
+
+  void add(const Target& target, std::unique_ptr<Job> job) {
+    jobs_.push_back({target, std::move(job)});
+  }
+
+  bool active() const {
+    return !jobs_.empty();
+  }
+  size_t size() const {
+    return jobs_.size();
+  }
+
+  /// @brief Give every queued job whose target is ready one slice of
+  /// `budget`, sending what they produce to the sink. Call once per tick.
+  /// @return true if ready jobs remain and another tick is needed.
+  bool run(std::chrono::microseconds budget = BUDGET) {
+    size_t count = jobs_.size();
+    if (count == 0) return false;
+
+    auto slice = budget / count;
+    bool runnable = false;
+    for (size_t i = 0; i < count; ++i) {
+      Entry entry = std::move(jobs_.front());
+      jobs_.pop_front();
+      if (ready_ && !ready_(entry.target)) {
+        jobs_.push_back(std::move(entry));
+        continue;
+      }
+
+      part_.clear();
+      bool done = entry.job->resume(part_, Job::Clock::now() + slice);
+      bool alive = true;
+      if (done || !part_.empty()) alive = deliver(entry.target, part_, done);
+      if (!done && alive) {
+        jobs_.push_back(std::move(entry));
+        runnable = true;
+      }
+    }
+    return runnable;
+  }
+
+ private:
+  struct Entry {
+    Target target;
+    std::unique_ptr<Job> job;
+  };
+
+  Sink sink_;
+  Ready ready_;
+  std::deque<Entry> jobs_;
+  std::string part_;  // Reused between slices
+};
+
+}  // namespace core
+}  // namespace quine
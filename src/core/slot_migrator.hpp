@@ -0,0 +1,130 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "message.hpp"
+#include "router.hpp"
+#include "topology.hpp"
+
+namespace quine {
+namespace core {
+
+/// @brief Per-core driver for online slot migration.
+///
+/// On the source core, the migrator walks the local shard in bounded steps
+/// and ships the keys of migrating slots to their targets as MIGRATE_BATCH
+/// messages. Every step is posted to the core's own inbox, so regular
+/// requests are served between batches. While a slot is in flight, the source
+/// keeps serving keys it still holds and ASK-forwards the rest (see
+/// Topology::is_local). Once the walk completes, ownership of the slots is
+/// flipped in the Router.
+///
+/// On the target core, it installs received keys into the local shard.
+class SlotMigrator {
+ public:
+  /// @brief Hash table buckets visited per step (bounds the work per tick).
+  static constexpr size_t BUCKETS_PER_STEP = 1024;
+
+  SlotMigrator(Topology& topology, size_t core_id) : topology_(topology), core_id_(core_id) {}
+
+  SlotMigrator(const SlotMigrator&) = delete;
+  SlotMigrator& operator=(const SlotMigrator&) = delete;
+
+  /// @brief Begin moving the given slots away from this core.
+  void start(std::vector<Router::SlotMove> moves) {
+    moves_ = std::move(moves);
+    targets_.clear();
+    for (const auto& move : moves_) targets_[move.slot] = move.to;
+    cursor_ = 0;
+    schedule_step();
+  }
+
+  /// @brief Move the keys found in the next window of the shard.
+  void step() {
+    if (moves_.empty()) return;
+    auto* shard = topology_.get_shard(core_id_);
+
+    std::vector<std::string> keys;
+    cursor_ = shard->scan(cursor_, BUCKETS_PER_STEP,
+                          [&](std::string_view key, const storage::Value&) {
+                            if (targets_.count(Router::key_slot(key))) keys.emplace_back(key);
+                          });
+
+    std::unordered_map<size_t, std::vector<MigratedKey>> batches;
+    for (auto& key : keys) {
+      long long expiry = shard->get_expiry(key);
+      storage::Value* val = shard->get(key);  // Lazily drops expired keys
+      if (!val) continue;
+
+      size_t target = targets_[Router::key_slot(key)];
+      // Copy out of this shard's slab: the batch is freed on the target core
+      batches[target].push_back(
+          {key, storage::rehome(std::move(*val), std::pmr::new_delete_resource()), expiry});
+      shard->del(key);
+    }
+
+    for (auto& [target, batch] : batches) {
+      Message msg;
+      msg.type = MessageType::MIGRATE_BATCH;
+      msg.origin_core_id = core_id_;
+      msg.migration = std::make_unique<MigrationPayload>();
+      msg.migration->keys = std::move(batch);
+      topology_.get_channel(target)->push(std::move(msg));
+      topology_.notify_core(target);
+    }
+
+    if (cursor_ == 0) {
+      finish();
+    } else {
+      schedule_step();
+    }
+  }
+
+  /// @brief Install keys received from a source core.
+  void import(std::vector<MigratedKey>&& keys) {
+    auto* shard = topology_.get_shard(core_id_);
+    for (auto& entry : keys) {
+      shard->set(entry.key, std::move(entry.value));
+      if (entry.expiry_ms != -1) shard->set_expiry(entry.key, entry.expiry_ms);
+    }
+  }
+
+  bool active() const {
+    return !moves_.empty();
+  }
+
+ private:
+  Topology& topology_;
+  size_t core_id_;
+
+  std::vector<Router::SlotMove> moves_;
+  std::unordered_map<uint16_t, size_t> targets_;  // Slot -> target core
+  size_t cursor_ = 0;
+
+  void schedule_step() {
+    Message msg;
+    msg.type = MessageType::MIGRATE_STEP;
+    msg.origin_core_id = core_id_;
+    topology_.get_channel(core_id_)->push(std::move(msg));
+    topology_.notify_core(core_id_);
+  }
+
+  // All keys are shipped (batches were queued before this point, so targets
+  // see them before any request routed by the new owner): flip ownership.
+  void finish() {
+    auto& router = topology_.get_router();
+    for (const auto& move : moves_) {
+      router.assign_slot(move.slot, move.to);
+      router.set_migration_target(move.slot, Router::NO_SHARD);
+    }
+    moves_.clear();
+    targets_.clear();
+    topology_.migration_finished();
+  }
+};
+
+}  // namespace core
+}  // namespace quine
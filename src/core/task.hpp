@@ -0,0 +1,309 @@
+#pragma once
+
+#include <liburing.h>
+
+#include <array>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "io_context.hpp"
+#include "operation.hpp"
+
+namespace quine {
+namespace core {
+
+/// @brief Per-thread free lists for coroutine frames.
+///
+/// Every Task allocates its frame on creation. Frames are recycled by size
+/// class on the core that runs them (coroutines never change cores), so a
+/// command written as a coroutine costs no malloc once the pool is warm.
+class FramePool {
+ public:
+  /// @brief Frame sizes are rounded up to a multiple of this.
+  static constexpr size_t GRANULARITY = 64;
+  /// @brief Larger frames come from (and go back to) the global heap.
+  static constexpr size_t MAX_POOLED = 1024;
+
+  /// @brief The calling thread's pool.
+  static FramePool& local() {
+    static thread_local FramePool pool;
+    return pool;
+  }
+
+  FramePool() = default;
+  FramePool(const FramePool&) = delete;
+  FramePool& operator=(const FramePool&) = delete;
+
+  ~FramePool() {
+    for (auto& list : free_) {
+      for (void* frame : list) ::operator delete(frame);
+    }
+  }
+
+  void* allocate(size_t size) {
+    if (size > MAX_POOLED) return ::operator new(size);
+    auto& list = free_[size_class(size)];
+    if (list.empty()) {
+      allocated_++;
+      return ::operator new(size_class(size) * GRANULARITY + GRANULARITY);
+    }
+    void* frame = list.back();
+    list.pop_back();
+    return frame;
+  }
+
+  void deallocate(void* frame, size_t size) {
+    if (size > MAX_POOLED) {
+      ::operator delete(frame);
+      return;
+    }
+    free_[size_class(size)].push_back(frame);
+  }
+
+  /// @brief Frames obtained from the heap so far (pooled sizes only).
+  size_t allocated() const {
+    return allocated_;
+  }
+
+ private:
+  static size_t size_class(size_t size) {
+    return size == 0 ? 0 : (size - 1) / GRANULARITY;
+  }
+
+  std::array<std::vector<void*>, MAX_POOLED / GRANULARITY> free_;
+  size_t allocated_ = 0;
+};
+
+template <typename T>
+class Task;
+
+namespace detail {
+
+// What Task<T> and Task<void> promises share: frame allocation, lazy start,
+// resuming the awaiting coroutine at the end, self-destruction if detached.
+class PromiseBase {
+ public:
+  static void* operator new(size_t size) {
+    return FramePool::local().allocate(size);
+  }
+  static void operator delete(void* frame, size_t size) {
+    FramePool::local().deallocate(frame, size);
+  }
+
+  std::suspend_always initial_suspend() noexcept {
+    return {};
+  }
+
+  struct FinalAwaiter {
+    bool await_ready() noexcept {
+      return false;
+    }
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+      PromiseBase& promise = handle.promise();
+      if (promise.detached_) {
+        handle.destroy();
+        return std::noop_coroutine();
+      }
+      // Symmetric transfer: no stack growth along chains of co_await
+      return promise.continuation_ ? promise.continuation_ : std::noop_coroutine();
+    }
+    void await_resume() noexcept {}
+  };
+
+  FinalAwaiter final_suspend() noexcept {
+    return {};
+  }
+
+  void unhandled_exception() {
+    if (detached_) {
+      // Nobody to rethrow to: a detached task must handle its own errors
+      try {
+        throw;
+      } catch (const std::exception& e) {
+        std::cerr << "[Task] Uncaught exception: " << e.what() << std::endl;
+      }
+      return;
+    }
+    exception_ = std::current_exception();
+  }
+
+ protected:
+  template <typename T>
+  friend class core::Task;
+
+  std::coroutine_handle<> continuation_;
+  std::exception_ptr exception_;
+  bool detached_ = false;
+};
+
+template <typename T>
+class Promise : public PromiseBase {
+ public:
+  Task<T> get_return_object();
+
+  template <typename U>
+  void return_value(U&& value) {
+    value_.emplace(std::forward<U>(value));
+  }
+
+  T take() {
+    if (exception_) std::rethrow_exception(exception_);
+    return std::move(*value_);
+  }
+
+ private:
+  std::optional<T> value_;
+};
+
+template <>
+class Promise<void> : public PromiseBase {
+ public:
+  Task<void> get_return_object();
+
+  void return_void() {}
+
+  void take() {
+    if (exception_) std::rethrow_exception(exception_);
+  }
+};
+
+}  // namespace detail
+
+/// @brief Coroutine returning a T, for multi-step commands and I/O flows
+/// written as straight-line code.
+///
+/// Tasks are lazy: the body starts when the task is awaited, or when
+/// detach() hands a top-level task to the event loop. Awaiting a task
+/// suspends the caller until the task finishes; suspension points inside
+/// are io_uring operations (async_read()...) and requests to other cores
+/// (Call). Everything runs on the core that started the task.
+template <typename T = void>
+class [[nodiscard]] Task {
+ public:
+  using promise_type = detail::Promise<T>;
+
+  explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+  Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+  Task& operator=(Task&&) = delete;
+
+  ~Task() {
+    if (handle_) handle_.destroy();
+  }
+
+  /// @brief Start the task and let it run to completion on its own; its
+  /// frame is freed when it finishes.
+  void detach() && {
+    auto handle = std::exchange(handle_, nullptr);
+    handle.promise().detached_ = true;
+    handle.resume();
+  }
+
+  /// @brief True once the body has returned (or thrown).
+  bool done() const {
+    return handle_ && handle_.done();
+  }
+
+  bool await_ready() const noexcept {
+    return false;
+  }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+    handle_.promise().continuation_ = caller;
+    return handle_;
+  }
+  T await_resume() {
+    return handle_.promise().take();
+  }
+
+ private:
+  std::coroutine_handle<promise_type> handle_;
+};
+
+template <typename T>
+Task<T> detail::Promise<T>::get_return_object() {
+  return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> detail::Promise<void>::get_return_object() {
+  return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+/// @brief One io_uring operation awaited by a coroutine: the SQE is prepared
+/// when the coroutine suspends, and the CQE resumes it with the result
+/// (bytes transferred, new fd, or -errno).
+class IoAwaiter : public Operation {
+ public:
+  enum class Kind { READ, WRITE, ACCEPT };
+
+  IoAwaiter(IoContext& ctx, Kind kind, int fd, void* buf = nullptr, unsigned len = 0)
+      : ctx_(ctx), kind_(kind), fd_(fd), buf_(buf), len_(len) {}
+
+  /// @brief Address the file through its registered slot (see
+  /// IoContext::register_file()); -1 uses the fd.
+  void set_file_slot(int slot) {
+    slot_ = slot;
+  }
+
+  bool await_ready() const noexcept {
+    return false;
+  }
+
+  void await_suspend(std::coroutine_handle<> handle) {
+    handle_ = handle;
+    struct io_uring_sqe* sqe = ctx_.get_sqe();
+    switch (kind_) {
+      case Kind::READ:
+        io_uring_prep_read(sqe, fd_, buf_, len_, 0);
+        break;
+      case Kind::WRITE:
+        io_uring_prep_write(sqe, fd_, buf_, len_, 0);
+        break;
+      case Kind::ACCEPT:
+        io_uring_prep_accept(sqe, fd_, nullptr, nullptr, 0);
+        break;
+    }
+    IoContext::use_registered(sqe, slot_);
+    io_uring_sqe_set_data(sqe, this);
+  }
+
+  int await_resume() const noexcept {
+    return result_;
+  }
+
+  void complete(int res) override {
+    result_ = res;
+    handle_.resume();
+  }
+
+ private:
+  IoContext& ctx_;
+  Kind kind_;
+  int fd_;
+  int slot_ = -1;
+  void* buf_;
+  unsigned len_;
+  int result_ = 0;
+  std::coroutine_handle<> handle_;
+};
+
+inline IoAwaiter async_read(IoContext& ctx, int fd, void* buf, unsigned len) {
+  return IoAwaiter(ctx, IoAwaiter::Kind::READ, fd, buf, len);
+}
+
+inline IoAwaiter async_write(IoContext& ctx, int fd, const void* buf, unsigned len) {
+  return IoAwaiter(ctx, IoAwaiter::Kind::WRITE, fd, const_cast<void*>(buf), len);
+}
+
+inline IoAwaiter async_accept(IoContext& ctx, int fd) {
+  return IoAwaiter(ctx, IoAwaiter::Kind::ACCEPT, fd);
+}
+
+}  // namespace core
+}  // namespace quine
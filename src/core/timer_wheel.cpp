@@ -0,0 +1,117 @@
+#include "timer_wheel.hpp"
+
+#include <algorithm>
+
+namespace quine {
+namespace core {
+
+TimerWheel::TimerWheel(Clock::time_point now) : origin_(now), slots_(SLOTS, NIL) {}
+
+uint64_t TimerWheel::tick_of(Clock::time_point when) const {
+  if (when <= origin_) return 0;
+  return static_cast<uint64_t>((when - origin_) / TICK);
+}
+
+TimerWheel::Handle TimerWheel::schedule(Clock::time_point when, Callback callback) {
+  uint32_t index = free_;
+  if (index == NIL) {
+    index = static_cast<uint32_t>(nodes_.size());
+    nodes_.emplace_back();
+  } else {
+    free_ = nodes_[index].next;
+  }
+
+  Node& node = nodes_[index];
+  node.callback = std::move(callback);
+  // Round up: never fire early. Past times fire on the next tick.
+  uint64_t expiry = tick_of(when);
+  if (origin_ + expiry * TICK < when) expiry++;
+  node.expiry = std::max(expiry, current_ + 1);
+  node.pending = true;
+  link(index);
+  size_++;
+  return {index, node.generation};
+}
+
+bool TimerWheel::cancel(Handle handle) {
+  if (handle.index >= nodes_.size()) return false;
+  Node& node = nodes_[handle.index];
+  if (!node.pending || node.generation != handle.generation) return false;
+  unlink(handle.index);
+  node.callback = nullptr;
+  release(handle.index);
+  return true;
+}
+
+size_t TimerWheel::advance(Clock::time_point now) {
+  uint64_t target = tick_of(now);
+  if (target <= current_) return 0;
+
+  // One turn at most: after that every slot has been visited
+  uint64_t last = std::min(target, current_ + SLOTS);
+  for (uint64_t tick = current_ + 1; tick <= last; ++tick) {
+    uint32_t index = slots_[tick % SLOTS];
+    while (index != NIL) {
+      uint32_t next = nodes_[index].next;
+      if (nodes_[index].expiry <= target) {
+        unlink(index);
+        due_.push_back(std::move(nodes_[index].callback));
+        nodes_[index].callback = nullptr;
+        release(index);
+      }
+      index = next;
+    }
+  }
+  current_ = target;
+
+  // Callbacks run last: they may touch the wheel
+  size_t fired = due_.size();
+  for (auto& callback : due_) callback();
+  due_.clear();
+  return fired;
+}
+
+TimerWheel::Clock::time_point TimerWheel::next_expiry() const {
+  if (size_ == 0) return Clock::time_point::max();
+  // The first slot holding a timer due in that very tick has the earliest.
+  // Timers of later turns only show there with later expiries.
+  uint64_t earliest = UINT64_MAX;
+  for (uint64_t tick = current_ + 1; tick <= current_ + SLOTS; ++tick) {
+    for (uint32_t index = slots_[tick % SLOTS]; index != NIL; index = nodes_[index].next) {
+      if (nodes_[index].expiry == tick) return origin_ + tick * TICK;
+      earliest = std::min(earliest, nodes_[index].expiry);
+    }
+  }
+  return origin_ + earliest * TICK;
+}
+
+void TimerWheel::link(uint32_t index) {
+  Node& node = nodes_[index];
+  uint32_t& head = slots_[node.expiry % SLOTS];
+  node.prev = NIL;
+  node.next = head;
+  if (head != NIL) nodes_[head].prev = index;
+  head = index;
+}
+
+void TimerWheel::unlink(uint32_t index) {
+  Node& node = nodes_[index];
+  if (node.prev != NIL) {
+    nodes_[node.prev].next = node.next;
+  } else {
+    slots_[node.expiry % SLOTS] = node.next;
+  }
+  if (node.next != NIL) nodes_[node.next].prev = node.prev;
+}
+
+void TimerWheel::release(uint32_t index) {
+  Node& node = nodes_[index];
+  node.pending = false;
+  node.generation++;
+  node.next = free_;
+  free_ = index;
+  size_--;
+}
+
+}  // namespace core
+}  // namespace quine
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace quine {
+namespace core {
+
+/// @brief Hashed timing wheel: one core's timers (idle clients, periodic
+/// jobs, deadlines) without a thread or a heap per timer.
+///
+/// Time is cut into TICK-long ticks and a timer hangs in the slot of its
+/// expiry tick modulo SLOTS, in an intrusive list, so scheduling and
+/// cancelling are O(1). Timers further away than one turn of the wheel
+/// share slots with nearer ones and are skipped until their tick comes.
+/// The owner calls advance() once next_expiry() has passed (IoContext
+/// arms a single io_uring timeout for it). Single-threaded.
+class TimerWheel {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Callback = std::function<void()>;
+
+  /// @brief Resolution: timers fire at the first tick at or after their time.
+  static constexpr std::chrono::milliseconds TICK{10};
+  /// @brief Slots per turn (5.12 s at 10 ms per tick).
+  static constexpr size_t SLOTS = 512;
+
+  /// @brief Identifies a scheduled timer; stale once it fired or was
+  /// cancelled (cancel() is then a no-op).
+  struct Handle {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+  };
+
+  explicit TimerWheel(Clock::time_point now = Clock::now());
+
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  /// @brief Run `callback` from the first advance() at or after `when`.
+  Handle schedule(Clock::time_point when, Callback callback);
+
+  /// @return true if the timer was pending (and will no longer fire).
+  bool cancel(Handle handle);
+
+  /// @brief Fire every timer due at `now`. Callbacks may schedule and
+  /// cancel timers; those scheduled for `now` fire on the next call.
+  /// @return Number of timers fired.
+  size_t advance(Clock::time_point now);
+
+  /// @brief When the earliest pending timer is due (the start of its tick);
+  /// Clock::time_point::max() if none is. Visits the slots of one turn at
+  /// most, skipping empty ones.
+  Clock::time_point next_expiry() const;
+
+  size_t size() const {
+    return size_;
+  }
+  bool empty() const {
+    return size_ == 0;
+  }
+
+ private:
+  static constexpr uint32_t NIL = UINT32_MAX;
+
+  struct Node {
+    Callback callback;
+    uint64_t expiry = 0;  // Tick
+    uint32_t prev = NIL;
+    uint32_t next = NIL;  // Next in the slot, or in the free list
+    uint32_t generation = 0;
+    bool pending = false;
+  };
+
+  uint64_t tick_of(Clock::time_point when) const;
+  void link(uint32_t index);
+  void unlink(uint32_t index);
+  void release(uint32_t index);
+
+  Clock::time_point origin_;
+  uint64_t current_ = 0;  // Last tick processed by advance()
+  std::vector<Node> nodes_;
+  std::vector<uint32_t> slots_;  // Head of each slot's list
+  uint32_t free_ = NIL;          // Free nodes, linked through `next`
+  size_t size_ = 0;
+  std::vector<Callback> due_;  // Reused by advance()
+};
+
+}  // namespace core
+}  // namespace quine
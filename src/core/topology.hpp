@@ -2,51 +2,137 @@
 
 #include <unistd.h>  // for write
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <future>
 #include <memory>
+#include <optional>
 #include <stdexcept>
+#include <string>
+#include <string_view>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include "../storage/shard.hpp"
+#include "admission.hpp"
+#include "buffer_pool.hpp"
 #include "itc_channel.hpp"
+#include "loop_stats.hpp"
 #include "message.hpp"
 #include "router.hpp"
+#include "scheduler.hpp"
 
 namespace quine {
 namespace core {
 
-/// @brief Holds the static topology of the node/cluster.
+/// @brief Reply slot of a request a coroutine sent to another core, see Call.
+struct CallState {
+  std::string reply;
+  bool done = false;
+  std::coroutine_handle<> waiter;  // Resumed once the reply is complete
+};
+
+/// @brief Holds the topology of the node/cluster.
 /// Contains the Router, Shards, and ITC Channels for all cores.
+///
+/// Resources are allocated up front for `max_cores` cores, but only the first
+/// `num_cores` are active (own slots and accept connections). Cores can be
+/// added or retired at runtime; the slots they gain or lose are migrated
+/// online by each source core's SlotMigrator.
+///
+/// With `io_cores`, the topology is split: that many more cores, numbered
+/// after the `max_cores` data cores, own no shard and only terminate client
+/// connections (parsing, replies). Every keyed command they receive is
+/// forwarded, batched per tick, to the data core owning its key; the data
+/// cores then accept no connections.
 class Topology {
  public:
-  Topology(size_t num_cores) : router_(num_cores), num_cores_(num_cores) {
-    // Initialize resources for each core
-    for (size_t i = 0; i < num_cores; ++i) {
-      shards_.push_back(std::make_unique<storage::Shard>());
+  /// @brief Who allocates the per-core shards.
+  enum class ShardAllocation {
+    EAGER,     // All shards in the constructor (tests, tools)
+    BY_WORKER  // Each worker calls init_shard() on its own (pinned) thread
+  };
+
+  Topology(size_t num_cores, size_t max_cores = 0,
+           ShardAllocation allocation = ShardAllocation::EAGER, size_t io_cores = 0)
+      : router_(num_cores),
+        num_cores_(num_cores),
+        io_cores_(io_cores),
+        shards_(std::max(num_cores, max_cores)),
+        owned_shards_(shards_.size()),
+        published_used_(shards_.size()),
+        notify_fds_(shards_.size() + io_cores),
+        polling_(notify_fds_.size()),
+        loop_stats_(notify_fds_.size()),
+        clients_(notify_fds_.size()),
+        load_(notify_fds_.size()),
+        requests_(notify_fds_.size()),
+        outboxes_(notify_fds_.size()),
+        schedulers_(notify_fds_.size()),
+        calls_(notify_fds_.size()),
+        next_call_token_(notify_fds_.size()) {
+    // Initialize resources for each core; I/O cores get everything but a shard
+    for (size_t i = 0; i < notify_fds_.size(); ++i) {
+      if (i < shards_.size() && allocation == ShardAllocation::EAGER) init_shard(i);
       channels_.push_back(std::make_unique<ItcChannel<Message>>());
-      notify_fds_.push_back(-1);  // Init with invalid FD
+      notify_fds_[i] = -1;  // Init with invalid FD
+      outboxes_[i].pending.resize(notify_fds_.size());
+      outboxes_[i].requests.resize(notify_fds_.size());
+      buffer_pools_.push_back(std::make_unique<BufferPool>());
     }
   }
 
+  /// @brief Allocate the shard of `core_id` on the calling thread.
+  /// Called by the owning worker after pinning, so the shard's memory is
+  /// first touched (and placed) on that worker's NUMA node. Cores started
+  /// at runtime do so while the others run: the shard is published only
+  /// once fully constructed.
+  void init_shard(size_t core_id) {
+    if (core_id >= shards_.size()) throw std::out_of_range("Invalid core_id");
+    if (owned_shards_[core_id]) return;
+    owned_shards_[core_id] = std::make_unique<storage::Shard>();
+    shards_[core_id].store(owned_shards_[core_id].get(), std::memory_order_release);
+  }
+
   // Register the write-end of the eventfd/pipe for a core
   void register_notify_fd(size_t core_id, int fd) {
     if (core_id >= notify_fds_.size()) throw std::out_of_range("Invalid core_id");
-    notify_fds_[core_id] = fd;
+    notify_fds_[core_id].store(fd, std::memory_order_release);
     registered_count_++;
   }
 
   // Barrier to ensure all cores have registered their FDs
   void wait_for_all_cores() {
-    while (registered_count_ < num_cores_) {
+    while (registered_count_ < num_cores_ + io_cores_) {
+      std::this_thread::yield();
+    }
+  }
+
+  /// @brief Open the data set for clients (after the RDB snapshot is loaded).
+  void mark_loaded() {
+    loaded_.store(true, std::memory_order_release);
+  }
+
+  /// @brief Barrier for workers: wait until mark_loaded() was called.
+  void wait_until_loaded() {
+    while (!loaded_.load(std::memory_order_acquire)) {
       std::this_thread::yield();
     }
   }
 
-  // Wake up a specific core
+  // Wake up a specific core (after pushing to its channel)
   void notify_core(size_t core_id) {
     if (core_id >= notify_fds_.size()) return;
-    int fd = notify_fds_[core_id];
+    // A busy-polling core sees the message without the syscall; it clears
+    // the flag before checking its inbox one last time and sleeping
+    if (polling_[core_id].load(std::memory_order_seq_cst)) return;
+    int fd = notify_fds_[core_id].load(std::memory_order_acquire);
     if (fd >= 0) {
       uint64_t u = 1;
       if (::write(fd, &u, sizeof(u)) < 0) {
@@ -55,27 +141,81 @@ class Topology {
     }
   }
 
+  /// @brief Called by `core_id`'s busy-poll loop: set while it spins on its
+  /// inbox, cleared before it sleeps.
+  void set_polling(size_t core_id, bool polling) {
+    if (polling_[core_id].load(std::memory_order_relaxed) != polling) {
+      polling_[core_id].store(polling, std::memory_order_seq_cst);
+    }
+  }
+
+  /// @brief Publish the event-loop counters of `core_id` (for INFO).
+  void register_loop_stats(size_t core_id, const LoopStats* stats) {
+    loop_stats_[core_id].store(stats, std::memory_order_release);
+  }
+  /// @brief Event-loop counters of `core_id`; nullptr if it never started.
+  const LoopStats* loop_stats(size_t core_id) const {
+    return loop_stats_[core_id].load(std::memory_order_acquire);
+  }
+
   // -- Accessors --
 
+  /// @brief Number of active cores (owning slots).
   size_t get_num_cores() const {
     return num_cores_;
   }
+  /// @brief Number of allocated shards, including inactive ones.
   size_t shard_count() const {
-    return num_cores_;
+    return shards_.size();
+  }
+  size_t get_max_cores() const {
+    return shards_.size();
+  }
+
+  /// @brief Number of I/O-only cores (0 unless the topology is split).
+  size_t io_core_count() const {
+    return io_cores_;
+  }
+  /// @brief All worker cores: data cores (active or not), then I/O cores.
+  size_t core_count() const {
+    return notify_fds_.size();
+  }
+  /// @brief True if `core_id` only serves clients and owns no shard.
+  bool is_io_core(size_t core_id) const {
+    return core_id >= shards_.size() && core_id < notify_fds_.size();
+  }
+  /// @brief True if `core_id` should accept client connections: the I/O
+  /// cores of a split topology, otherwise every active core.
+  bool serves_clients(size_t core_id) const {
+    return io_cores_ > 0 ? is_io_core(core_id) : core_id < num_cores_;
   }
 
   Router& get_router() {
     return router_;
   }
 
+  /// @brief Shard of `core_id`; nullptr if its worker never started
+  /// (ShardAllocation::BY_WORKER).
   storage::Shard* get_shard(size_t core_id) {
     if (core_id >= shards_.size()) throw std::out_of_range("Invalid core_id");
-    return shards_[core_id].get();
+    return shards_[core_id].load(std::memory_order_acquire);
+  }
+
+  /// @brief Pool for the ITC payloads sent by `core_id`.
+  BufferPool* get_buffer_pool(size_t core_id) {
+    if (core_id >= buffer_pools_.size()) throw std::out_of_range("Invalid core_id");
+    return buffer_pools_[core_id].get();
   }
 
   const storage::Shard* get_shard(size_t core_id) const {
     if (core_id >= shards_.size()) throw std::out_of_range("Invalid core_id");
-    return shards_[core_id].get();
+    return shards_[core_id].load(std::memory_order_acquire);
+  }
+
+  /// @brief Jobs (long-running commands) of `core_id`, see defer().
+  Scheduler& get_scheduler(size_t core_id) {
+    if (core_id >= schedulers_.size()) throw std::out_of_range("Invalid core_id");
+    return schedulers_[core_id];
   }
 
   ItcChannel<Message>* get_channel(size_t core_id) {
@@ -84,24 +224,674 @@ class Topology {
   }
 
   // Helper to check if a key belongs to a specific core
-  bool is_local(size_t core_id, const std::string& key) {
-    return router_.get_shard_id(key) == core_id;
+  bool is_local(size_t core_id, std::string_view key) {
+    uint16_t slot = Router::key_slot(key);
+    // Read the migration state first: the source publishes the new owner
+    // before clearing it.
+    size_t migrating_to = router_.get_migration_target(slot);
+    size_t owner = router_.get_slot_owner(slot);
+
+    if (owner == core_id) {
+      // Slot is being moved away: keys already handed over (or not yet
+      // created) are served by the target.
+      if (migrating_to != Router::NO_SHARD && !get_shard(core_id)->get(key)) return false;
+      return true;
+    }
+    // ASK redirect from the source for a slot we are importing
+    return migrating_to == core_id && requests_[core_id] && requests_[core_id]->asking;
   }
 
   // Helper to get target core
-  size_t get_target_core(const std::string& key) {
+  size_t get_target_core(std::string_view key) {
     return router_.get_shard_id(key);
   }
 
+  /// @brief Per-core context of the request currently being executed.
+  struct RequestContext {
+    size_t origin_core_id = 0;    // Core owning the client connection
+    uint64_t seq = 0;             // Request sequence number on that connection
+    bool asking = false;          // ASK redirect for a slot being imported
+    size_t served_by = SIZE_MAX;  // Core the request was forwarded to, if any
+    // Set by client connections of this core: they send large values by
+    // reference, see bulk_reply()
+    bool by_reference = false;
+    storage::SharedString reply_body{};
+  };
+
+  /// @brief Set the context for the request `core_id` is about to execute.
+  /// Must be paired with end_request() on the same core.
+  void begin_request(size_t core_id, const RequestContext& ctx) {
+    requests_[core_id] = ctx;
+  }
+
+  /// @return The core that serves the request: `core_id`, or the core it
+  /// was forwarded to.
+  size_t end_request(size_t core_id) {
+    size_t served_by = requests_[core_id]->served_by;
+    requests_[core_id].reset();
+    return served_by == SIZE_MAX ? core_id : served_by;
+  }
+
+  /// @brief Forward a command to the core owning its key (args[1]).
+  /// The message is queued in this core's outbox and sent with flush().
+  /// The owner replies with a RESPONSE message to the originating core.
+  /// @return Empty string, the "forwarded" marker of Command::execute; or
+  /// a -BUSY error if the owner is overloaded (see AdmissionLimits).
+  std::string forward(size_t core_id, uint32_t conn_id, const std::vector<std::string>& args) {
+    bool asking = false;
+    size_t target_core = route(core_id, args[1], asking);
+
+    if (shed_request(core_id, target_core)) return busy_error(target_core);
+    // Re-forwarding a request keeps the original connection's core
+    auto& ctx = requests_[core_id];
+    if (ctx) ctx->served_by = target_core;
+    Message msg;
+    msg.type = MessageType::REQUEST;
+    msg.origin_core_id = ctx ? ctx->origin_core_id : core_id;
+    msg.conn_id = conn_id;
+    msg.seq = ctx ? ctx->seq : 0;
+    msg.asking = asking;
+    msg.payload = encode_args(*buffer_pools_[core_id], args);
+
+    enqueue(core_id, target_core, std::move(msg));
+    return "";
+  }
+
+  /// @brief The RESP bulk string of a string value. If the request takes
+  /// values by reference and this one is shared (long), only the header
+  /// is returned: the connection sends the bytes from the value itself,
+  /// then the CRLF (see take_reply_body()).
+  std::string bulk_reply(size_t core_id, const storage::Value& value) {
+    std::string_view bytes = value.string();
+    std::string reply = "$" + std::to_string(bytes.size()) + "\r\n";
+    auto& ctx = requests_[core_id];
+    if (ctx && ctx->by_reference && (ctx->reply_body = value.share())) return reply;
+    reply.reserve(reply.size() + bytes.size() + 2);
+    reply.append(bytes);
+    reply.append("\r\n");
+    return reply;
+  }
+
+  /// @brief The value bulk_reply() left out of the reply of the request
+  /// `core_id` is executing; empty if none. Call before end_request().
+  storage::SharedString take_reply_body(size_t core_id) {
+    return std::move(requests_[core_id]->reply_body);
+  }
+
+  /// @brief Connection ID of the requests sent by send_call(); client
+  /// connections are numbered from 1.
+  static constexpr uint32_t CALL_CONN_ID = 0;
+
+  /// @brief Send a command to the core owning its key (args[1]) on behalf
+  /// of a coroutine running on `core_id` (sent with flush()). The reply is
+  /// collected into `state` by complete_call(); `state` must stay valid
+  /// until then or until cancel_call(). Calls made for a client's command
+  /// are subject to admission control like forward(): to an overloaded
+  /// core, `state` is completed at once with the -BUSY error.
+  /// @return The call's token.
+  uint64_t send_call(size_t core_id, const std::vector<std::string>& args, CallState* state) {
+    bool asking = false;
+    size_t target_core = route(core_id, args[1], asking);
+    uint64_t token = next_call_token_[core_id]++;
+    if (shed_request(core_id, target_core)) {
+      state->reply = busy_error(target_core);
+      state->done = true;
+      return token;
+    }
+    calls_[core_id][token] = state;
+
+    Message msg;
+    msg.type = MessageType::REQUEST;
+    msg.origin_core_id = core_id;
+    msg.conn_id = CALL_CONN_ID;
+    msg.seq = token;
+    msg.asking = asking;
+    msg.payload = encode_args(*buffer_pools_[core_id], args);
+    enqueue(core_id, target_core, std::move(msg));
+    return token;
+  }
+
+  /// @brief Handle (a part of) the reply to a call of `core_id`: once the
+  /// last part arrived, the awaiting coroutine resumes, right here.
+  void complete_call(size_t core_id, uint64_t token, std::string_view part, bool last) {
+    auto& calls = calls_[core_id];
+    auto it = calls.find(token);
+    if (it == calls.end()) return;  // Cancelled
+    CallState* state = it->second;
+    state->reply.append(part);
+    if (!last) return;
+    calls.erase(it);
+    state->done = true;
+    if (state->waiter) state->waiter.resume();
+  }
+
+  /// @brief Forget a call whose state is going away; its reply is dropped.
+  void cancel_call(size_t core_id, uint64_t token) {
+    calls_[core_id].erase(token);
+  }
+
+  /// @brief Where the reply to the request `core_id` is executing goes.
+  Scheduler::Target reply_target(size_t core_id, uint32_t conn_id) const {
+    const auto& ctx = requests_[core_id];
+    return {ctx ? ctx->origin_core_id : core_id, conn_id, ctx ? ctx->seq : 0};
+  }
+
+  /// @brief Send the reply to a request answered later than its execute()
+  /// call, e.g. by a coroutine (see reply_target()).
+  /// @return false if the client is gone.
+  bool reply(size_t core_id, const Scheduler::Target& target, std::string_view payload) {
+    return schedulers_[core_id].deliver(target, payload, true);
+  }
+
+  /// @brief Finish the request `core_id` is executing with a Job, run by
+  /// its Scheduler over the next event-loop iterations. The job's reply
+  /// goes to the request's connection, wherever it lives.
+  /// @return Empty string, the "reply comes later" marker of Command::execute.
+  std::string defer(size_t core_id, uint32_t conn_id, std::unique_ptr<Job> job) {
+    schedulers_[core_id].add(reply_target(core_id, conn_id), std::move(job));
+    return "";
+  }
+
+  /// @brief Queue the reply to a forwarded request for its origin core.
+  void respond(size_t core_id, const Message& request, std::string_view payload) {
+    respond(core_id, request.origin_core_id, request.conn_id, request.seq, payload);
+  }
+
+  /// @brief Same, by request coordinates. With `partial`, more parts of
+  /// the reply follow in later messages.
+  void respond(size_t core_id, size_t origin_core_id, uint32_t conn_id, uint64_t seq,
+               std::string_view payload, bool partial = false) {
+    Message reply;
+    reply.type = MessageType::RESPONSE;
+    reply.origin_core_id = core_id;  // Sender (us)
+    reply.conn_id = conn_id;         // Route to original connection
+    reply.seq = seq;
+    reply.partial = partial;
+    reply.payload = buffer_pools_[core_id]->acquire(payload.size());
+    std::memcpy(reply.payload.data(), payload.data(), payload.size());
+    enqueue(core_id, origin_core_id, std::move(reply));
+  }
+
+  /// @brief Send everything queued by `core_id` during this event-loop tick.
+  /// Messages for the same target travel as one BATCH with a single wakeup.
+  void flush(size_t core_id) {
+    publish_memory(core_id);
+    auto& outbox = outboxes_[core_id];
+    for (size_t target : outbox.dirty) {
+      auto& pending = outbox.pending[target];
+      if (outbox.requests[target] > 0) {
+        load_[target].queued.fetch_add(outbox.requests[target], std::memory_order_relaxed);
+        outbox.requests[target] = 0;
+      }
+      if (pending.size() == 1) {
+        get_channel(target)->push(std::move(pending.front()));
+      } else {
+        Message batch;
+        batch.type = MessageType::BATCH;
+        batch.origin_core_id = core_id;
+        batch.batch = std::move(pending);
+        get_channel(target)->push(std::move(batch));
+      }
+      pending.clear();
+      notify_core(target);
+    }
+    outbox.dirty.clear();
+  }
+
+  /// @brief Hand a client connection over to `target_core` (sent with flush()).
+  /// The connection must have no I/O in flight; the target adopts it.
+  void handoff_connection(size_t core_id, size_t target_core, network::Connection* conn) {
+    Message msg;
+    msg.type = MessageType::CONN_HANDOFF;
+    msg.origin_core_id = core_id;
+    msg.migration = std::make_unique<MigrationPayload>();
+    msg.migration->connection = conn;
+    enqueue(core_id, target_core, std::move(msg));
+  }
+
+  /// @brief FLUSHALL: ask every other core to drop the keys of its shard
+  /// (sent with flush()). The caller flushes its own shard. Requests this
+  /// core forwards later arrive after the flush.
+  void flush_all_shards(size_t core_id, bool lazy) {
+    for (size_t target = 0; target < shards_.size(); ++target) {
+      if (target == core_id || !get_shard(target)) continue;
+      Message msg;
+      msg.type = MessageType::FLUSH;
+      msg.origin_core_id = core_id;
+      msg.lazy = lazy;
+      enqueue(core_id, target, std::move(msg));
+    }
+  }
+
+  // -- Elasticity & Slot Migration --
+
+  /// @brief Spawns the worker thread of a new core. The future is ready
+  /// once the worker has registered its inbox, or holds the exception that
+  /// stopped it before.
+  using CoreLauncher = std::function<std::future<void>(size_t)>;
+
+  /// @brief Longest add_core() waits for a new worker to come up.
+  static constexpr std::chrono::seconds CORE_START_TIMEOUT{10};
+
+  /// @brief Set the callback used to spawn a worker thread for a new core.
+  void set_core_launcher(CoreLauncher launcher) {
+    launcher_ = std::move(launcher);
+  }
+
+  /// @brief Activate one more core and migrate its share of slots to it.
+  /// Spawns the worker on first use, or resumes a previously retired one.
+  /// @return The ID of the added core.
+  /// @throws std::runtime_error if no core is left, or the new worker
+  /// failed or did not start within CORE_START_TIMEOUT.
+  size_t add_core() {
+    acquire_rebalance();
+    size_t core_id = num_cores_;
+    if (core_id >= shards_.size() || (!launcher_ && notify_fds_[core_id] < 0)) {
+      rebalancing_ = false;
+      throw std::runtime_error("maximum number of worker cores reached");
+    }
+
+    if (notify_fds_[core_id] < 0) {
+      // Never started: wait until its inbox can be signaled. One that comes
+      // up after the timeout is resumed by the next ADDCORE.
+      std::future<void> started = launcher_(core_id);
+      try {
+        if (started.wait_for(CORE_START_TIMEOUT) != std::future_status::ready) {
+          throw std::runtime_error("timed out");
+        }
+        started.get();
+      } catch (const std::exception& e) {
+        rebalancing_ = false;
+        throw std::runtime_error(std::string("could not start a new core: ") + e.what());
+      }
+    }
+    send_control(core_id, MessageType::CORE_RESUME);
+
+    num_cores_ = core_id + 1;
+    start_migration(router_.plan_rebalance(core_id + 1));
+    router_.set_num_shards(core_id + 1);
+    return core_id;
+  }
+
+  /// @brief Retire the highest active core: it stops accepting connections
+  /// and its slots are migrated to the remaining cores. Existing connections
+  /// on it keep working through forwarding.
+  /// @return The ID of the retired core.
+  size_t retire_core() {
+    acquire_rebalance();
+    size_t count = num_cores_;
+    if (count <= 1) {
+      rebalancing_ = false;
+      throw std::runtime_error("cannot retire the last core");
+    }
+
+    size_t core_id = count - 1;
+    num_cores_ = core_id;
+    send_control(core_id, MessageType::CORE_RETIRE);
+    start_migration(router_.plan_rebalance(core_id));
+    router_.set_num_shards(core_id);
+    return core_id;
+  }
+
+  /// @brief Migrate a single slot to another active core.
+  void move_slot(uint16_t slot, size_t target_core) {
+    if (slot >= Router::NUM_SLOTS) throw std::out_of_range("invalid slot");
+    if (target_core >= num_cores_) throw std::out_of_range("invalid core");
+    acquire_rebalance();
+    size_t owner = router_.get_slot_owner(slot);
+    if (owner == target_core) {
+      rebalancing_ = false;
+      return;
+    }
+    start_migration({{slot, owner, target_core}});
+  }
+
+  /// @brief Called by a source core once all of its slots have moved.
+  void migration_finished() {
+    if (pending_migrations_.fetch_sub(1) == 1) {
+      rebalancing_ = false;
+    }
+  }
+
+  bool is_rebalancing() const {
+    return rebalancing_;
+  }
+
+  // -- Snapshots --
+
+  /// @brief A snapshot writer (SAVE) scans every core's shard from its own
+  /// core, over many ticks. Meanwhile no core may defragment: relocating
+  /// values frees memory the scan may still read, and compaction moves
+  /// entries past its cursor. Safe from any core.
+  void begin_snapshot_scan() {
+    snapshot_scans_.fetch_add(1);
+  }
+  void end_snapshot_scan() {
+    snapshot_scans_.fetch_sub(1);
+  }
+  bool snapshot_scan_active() const {
+    return snapshot_scans_.load() > 0;
+  }
+
+  // -- Client connections --
+
+  /// @brief Count a client connection taken over by `core_id` (accepted or
+  /// handed off to it).
+  void client_connected(size_t core_id) {
+    clients_[core_id].connected.fetch_add(1, std::memory_order_relaxed);
+  }
+  /// @brief A client left `core_id` (closed or handed off).
+  void client_disconnected(size_t core_id) {
+    clients_[core_id].connected.fetch_sub(1, std::memory_order_relaxed);
+  }
+  size_t clients(size_t core_id) const {
+    return clients_[core_id].connected.load(std::memory_order_relaxed);
+  }
+
+  /// @brief A client of `core_id` was disconnected for exceeding its
+  /// output buffer limits (see network::ClientLimits).
+  void count_output_limit_disconnect(size_t core_id) {
+    clients_[core_id].output_limit_disconnects.fetch_add(1, std::memory_order_relaxed);
+  }
+  /// @brief Reading from a client of `core_id` paused for backpressure.
+  void count_read_pause(size_t core_id) {
+    clients_[core_id].read_pauses.fetch_add(1, std::memory_order_relaxed);
+  }
+  /// @brief Totals of both, over all cores.
+  uint64_t output_limit_disconnects() const {
+    uint64_t total = 0;
+    for (const auto& counters : clients_) {
+      total += counters.output_limit_disconnects.load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+  uint64_t read_pauses() const {
+    uint64_t total = 0;
+    for (const auto& counters : clients_) {
+      total += counters.read_pauses.load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+  /// @brief Core serving clients with the fewest connections; `core_id`
+  /// itself unless another one has fewer. Counts are read without
+  /// synchronization, so cores accepting at once may pick the same target.
+  size_t least_loaded_core(size_t core_id) const {
+    size_t best = core_id;
+    size_t best_clients = clients(core_id);
+    for (size_t i = 0; i < clients_.size(); ++i) {
+      if (!serves_clients(i) || clients(i) >= best_clients) continue;
+      best = i;
+      best_clients = clients(i);
+    }
+    return best;
+  }
+
+  // -- Admission control --
+
+  /// @brief Set before the workers start.
+  void set_admission_limits(const AdmissionLimits& limits) {
+    admission_ = limits;
+  }
+  const AdmissionLimits& admission_limits() const {
+    return admission_;
+  }
+
+  /// @brief Called by `core_id` as it executes a request another core
+  /// forwarded to it (sent with flush()).
+  void request_received(size_t core_id) {
+    load_[core_id].queued.fetch_sub(1, std::memory_order_relaxed);
+  }
+  /// @brief Requests sent to `core_id` that it has not executed yet.
+  size_t queued_requests(size_t core_id) const {
+    return load_[core_id].queued.load(std::memory_order_relaxed);
+  }
+  /// @brief How long `core_id`'s current event-loop iteration has run.
+  std::chrono::microseconds loop_lag(size_t core_id) const {
+    const LoopStats* stats = loop_stats(core_id);
+    return stats ? stats->lag() : std::chrono::microseconds(0);
+  }
+  /// @brief True if `core_id` is past one of the admission limits, with
+  /// `unsent` more requests on the way to it (queued for flush()).
+  bool overloaded(size_t core_id, size_t unsent = 0) const {
+    if (admission_.max_queued_requests > 0 &&
+        queued_requests(core_id) + unsent >= admission_.max_queued_requests) {
+      return true;
+    }
+    return admission_.max_loop_lag.count() > 0 && loop_lag(core_id) >= admission_.max_loop_lag;
+  }
+  /// @brief Requests of `core_id`'s clients refused with -BUSY.
+  uint64_t shed_requests(size_t core_id) const {
+    return load_[core_id].shed.load(std::memory_order_relaxed);
+  }
+
+  // -- Memory accounting --
+
+  /// @brief Bytes held by all shards, summed from their slab counters.
+  /// Safe from any core: shards are published by init_shard() and the
+  /// counters are relaxed atomics.
+  size_t used_memory() const {
+    size_t total = 0;
+    for (size_t i = 0; i < shards_.size(); ++i) {
+      if (const storage::Shard* shard = get_shard(i)) total += shard->memory().used_bytes();
+    }
+    return total;
+  }
+
+  /// @brief Values waiting for lazy destruction in all shards.
+  size_t lazyfree_pending() const {
+    size_t total = 0;
+    for (size_t i = 0; i < shards_.size(); ++i) {
+      if (const storage::Shard* shard = get_shard(i)) total += shard->reclaimer().pending();
+    }
+    return total;
+  }
+
+  /// @brief Bytes obtained from the system by all shards (slabs included).
+  size_t allocated_memory() const {
+    size_t total = 0;
+    for (size_t i = 0; i < shards_.size(); ++i) {
+      if (const storage::Shard* shard = get_shard(i)) total += shard->memory().allocated_bytes();
+    }
+    return total;
+  }
+
+  void set_maxmemory(size_t bytes) {
+    maxmemory_ = bytes;
+  }
+  size_t maxmemory() const {
+    return maxmemory_;
+  }
+  /// @brief True when a limit is set and the shards have reached it.
+  /// Checked on every write, so it reads the running total each core
+  /// updates in flush(): up to one tick behind, but a single load.
+  bool over_maxmemory() const {
+    size_t limit = maxmemory_.load(std::memory_order_relaxed);
+    return limit != 0 && used_total_.load(std::memory_order_relaxed) >= limit;
+  }
+
  private:
+  // True (and counted) if a request from `core_id`'s client must not be
+  // sent to `target_core` now. Requests re-forwarded by another core were
+  // admitted where the client is.
+  bool shed_request(size_t core_id, size_t target_core) {
+    const auto& ctx = requests_[core_id];
+    bool from_client = !ctx || ctx->origin_core_id == core_id;
+    if (!from_client || !overloaded(target_core, outboxes_[core_id].requests[target_core])) {
+      return false;
+    }
+    load_[core_id].shed.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+  static std::string busy_error(size_t target_core) {
+    return "-BUSY core " + std::to_string(target_core) + " is overloaded, try again later\r\n";
+  }
+
+  // Add the change in this core's shard usage since its last flush to
+  // the running total
+  void publish_memory(size_t core_id) {
+    if (core_id >= shards_.size()) return;  // I/O core
+    const storage::Shard* shard = get_shard(core_id);
+    size_t used = shard ? shard->memory().used_bytes() : 0;
+    size_t& published = published_used_[core_id];
+    if (used == published) return;
+    used_total_.fetch_add(used - published, std::memory_order_relaxed);  // Wraps when lower
+    published = used;
+  }
+
+  // Messages queued by one core during the current tick, by target core
+  struct Outbox {
+    std::vector<std::vector<Message>> pending;
+    std::vector<size_t> dirty;     // Targets with pending messages
+    std::vector<size_t> requests;  // REQUEST messages among them, by target
+  };
+
   Router router_;
-  size_t num_cores_;
+  std::atomic<size_t> num_cores_;
+  size_t io_cores_;
 
-  // Per-core resources
-  std::vector<std::unique_ptr<storage::Shard>> shards_;
+  // Per-core resources. Pools come first: they must outlive every queued
+  // message holding one of their buffers.
+  std::vector<std::unique_ptr<BufferPool>> buffer_pools_;
+  std::vector<std::atomic<storage::Shard*>> shards_;  // Published by init_shard()
+  std::vector<std::unique_ptr<storage::Shard>> owned_shards_;
+  std::vector<size_t> published_used_;  // Per core: its share of used_total_
   std::vector<std::unique_ptr<ItcChannel<Message>>> channels_;
-  std::vector<int> notify_fds_;
+  std::vector<std::atomic<int>> notify_fds_;
+  std::vector<std::atomic<bool>> polling_;
+  std::vector<std::atomic<const LoopStats*>> loop_stats_;
+  // Per core, written by its worker
+  struct ClientCounters {
+    std::atomic<size_t> connected{0};
+    std::atomic<uint64_t> output_limit_disconnects{0};
+    std::atomic<uint64_t> read_pauses{0};
+  };
+  std::vector<ClientCounters> clients_;
+  // Per core: `queued` is raised by the senders, lowered by the core itself
+  struct LoadCounters {
+    std::atomic<size_t> queued{0};
+    std::atomic<uint64_t> shed{0};  // Requests of this core's clients refused
+  };
+  std::vector<LoadCounters> load_;
+  AdmissionLimits admission_;  // Set before the workers start, read by all cores
+  // Only touched by the owning core
+  std::vector<std::optional<RequestContext>> requests_;
+  std::vector<Outbox> outboxes_;
+  std::vector<Scheduler> schedulers_;
+  std::vector<std::unordered_map<uint64_t, CallState*>> calls_;  // By token
+  std::vector<uint64_t> next_call_token_;
   std::atomic<size_t> registered_count_{0};
+  std::atomic<bool> loaded_{false};
+  std::atomic<size_t> maxmemory_{0};
+  std::atomic<size_t> used_total_{0};  // See over_maxmemory()
+
+  // Elasticity
+  CoreLauncher launcher_;
+  std::atomic<bool> rebalancing_{false};
+  std::atomic<size_t> pending_migrations_{0};
+  std::atomic<size_t> snapshot_scans_{0};  // RdbWriters running
+
+  void acquire_rebalance() {
+    bool expected = false;
+    if (!rebalancing_.compare_exchange_strong(expected, true)) {
+      throw std::runtime_error("slot migration already in progress");
+    }
+  }
+
+  // Core serving `key`: its owner, or the core importing its slot if the
+  // owner no longer holds it (`asking` is then set)
+  size_t route(size_t core_id, std::string_view key, bool& asking) {
+    size_t target_core = router_.get_shard_id(key);
+    if (target_core == core_id) {
+      // We own the slot but no longer hold the key: ASK the importing core
+      size_t importer = router_.get_migration_target(Router::key_slot(key));
+      if (importer != Router::NO_SHARD) {
+        target_core = importer;
+        asking = true;
+      }
+    }
+    return target_core;
+  }
+
+  void enqueue(size_t core_id, size_t target_core, Message msg) {
+    auto& outbox = outboxes_[core_id];
+    if (outbox.pending[target_core].empty()) outbox.dirty.push_back(target_core);
+    if (msg.type == MessageType::REQUEST) outbox.requests[target_core]++;
+    outbox.pending[target_core].push_back(std::move(msg));
+  }
+
+  void send_control(size_t core_id, MessageType type) {
+    Message msg;
+    msg.type = type;
+    msg.origin_core_id = core_id;
+    get_channel(core_id)->push(std::move(msg));
+    notify_core(core_id);
+  }
+
+  // Mark slots as migrating and hand each source core its share of the plan
+  void start_migration(const std::vector<Router::SlotMove>& moves) {
+    std::vector<std::vector<Router::SlotMove>> by_source(shards_.size());
+    for (const auto& move : moves) {
+      router_.set_migration_target(move.slot, move.to);
+      by_source[move.from].push_back(move);
+    }
+
+    size_t sources = 0;
+    for (const auto& group : by_source) sources += group.empty() ? 0 : 1;
+    if (sources == 0) {
+      rebalancing_ = false;
+      return;
+    }
+
+    pending_migrations_ = sources;
+    for (size_t core_id = 0; core_id < by_source.size(); ++core_id) {
+      if (by_source[core_id].empty()) continue;
+      Message msg;
+      msg.type = MessageType::MIGRATE_START;
+      msg.origin_core_id = core_id;
+      msg.migration = std::make_unique<MigrationPayload>();
+      msg.migration->slot_moves = std::move(by_source[core_id]);
+      get_channel(core_id)->push(std::move(msg));
+      notify_core(core_id);
+    }
+  }
+};
+
+/// @brief Awaitable request to the core owning a key, for coroutines
+/// (Task) running on `core_id`: sent on construction, so several calls can
+/// be in flight at once; co_await yields the RESP reply.
+///
+///   Call get(topology, core_id, {"GET", key});
+///   std::string reply = co_await get;
+class Call {
+ public:
+  Call(Topology& topology, size_t core_id, const std::vector<std::string>& args)
+      : topology_(topology), core_id_(core_id) {
+    token_ = topology.send_call(core_id, args, &state_);
+  }
+  ~Call() {
+    if (!state_.done) topology_.cancel_call(core_id_, token_);
+  }
+
+  // The topology keeps our address until the reply arrives
+  Call(const Call&) = delete;
+  Call& operator=(const Call&) = delete;
+
+  bool await_ready() const noexcept {
+    return state_.done;
+  }
+  void await_suspend(std::coroutine_handle<> handle) noexcept {
+    state_.waiter = handle;
+  }
+  std::string await_resume() {
+    return std::move(state_.reply);
+  }
+
+ private:
+  Topology& topology_;
+  size_t core_id_;
+  uint64_t token_;
+  CallState state_;
 };
 
 }  // namespace core
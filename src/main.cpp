@@ -1,14 +1,26 @@
+#include <algorithm>
+#include <chrono>
+#include <csignal>
 #include <cstdlib>
+#include <deque>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <mutex>
+#include <optional>
+#include <sstream>
 #include <thread>
 #include <unordered_map>
 #include <vector>
 
 #include "core/config.hpp"
+#include "core/cpu_affinity.hpp"
 #include "core/io_context.hpp"
+#include "core/slot_migrator.hpp"
 #include "core/topology.hpp"
 #include "network/connection.hpp"
 #include "network/tcp_server.hpp"
+#include "storage/defragmenter.hpp"
 
 /// @file main.cpp
 /// @brief Entry point for the QuineDB Server.
@@ -22,99 +34,293 @@
 #include "commands/registry.hpp"
 #include "commands/string_commands.hpp"
 
-// Worker thread function
-void worker_main(size_t core_id, int port, quine::core::Topology& topology) {
+// Worker thread function. `launch_index` is the thread's place in launch
+// order, which picks its CPUs. `started` is fulfilled once the core's inbox
+// is registered, or gets the error that stopped it before.
+void worker_main(size_t core_id, size_t launch_index, const quine::core::Config& config,
+                 quine::core::Topology& topology, quine::network::ReuseportGroup& reuseport,
+                 std::promise<void> started) {
+  bool registered = false;
   try {
+    // 0. Pin to our CPU, then allocate the shard from this thread so its
+    // memory is placed on the local NUMA node (first touch). I/O cores of a
+    // split topology have no shard.
+    const bool io_core = topology.is_io_core(core_id);
+    int cpu = -1;
+    if (config.pin_workers && !config.worker_cpus.empty()) {
+      cpu = config.worker_cpus[launch_index % config.worker_cpus.size()];
+      if (!quine::core::pin_current_thread(cpu)) {
+        std::cerr << "[Core " << core_id << "] Could not pin to CPU " << cpu << std::endl;
+        cpu = -1;
+      }
+    }
+    if (!io_core) topology.init_shard(core_id);
+    quine::storage::Shard* shard = io_core ? nullptr : topology.get_shard(core_id);
+
     // 1. Initialize Thread-Local Event Loop
-    quine::core::IoContext ctx;
+    quine::core::RingConfig ring = config.ring;
+    if (ring.sqpoll && !config.sqpoll_cpus.empty()) {
+      ring.sqpoll_cpu = config.sqpoll_cpus[launch_index % config.sqpoll_cpus.size()];
+    }
+    quine::core::IoContext ctx(ring);
 
     // Registry for local connections (ID -> Ptr)
     std::unordered_map<uint32_t, quine::network::Connection*> local_connections;
 
+    // Moves slots away from / into this core's shard
+    quine::core::SlotMigrator migrator(topology, core_id);
+
+    // Gives memory back after churn, a budgeted slice per loop iteration
+    std::optional<quine::storage::Defragmenter> defrag;
+    if (shard) defrag.emplace(*shard, config.defrag);
+
+    // Buffers released on this core go straight back to its own pool
+    topology.get_buffer_pool(core_id)->bind_to_current_thread();
+
     topology.register_notify_fd(core_id, ctx.get_notify_fd());
+    registered = true;
+    started.set_value();
 
     // 2.5 Wait for all cores to initialize their FDs
     // This prevents a race condition where a core receives a request (via
     // another core) before it has registered its notification FD.
     topology.wait_for_all_cores();
 
+    // Main thread loads the RDB snapshot into the shards before we serve
+    topology.wait_until_loaded();
+
     // 3. Initialize TCP Server (Shared Port via SO_REUSEPORT)
-    quine::network::TcpServer server(ctx, port, topology, core_id);
+    quine::network::TcpServer server(ctx, config.port, topology, core_id);
+    server.set_reuseport_group(&reuseport, cpu);
+
+    // Idle clients are closed after config.timeout: one timer per
+    // connection, re-armed from its last read when it fires early
+    const std::chrono::seconds idle_timeout(config.timeout);
+    std::unordered_map<uint32_t, quine::core::TimerWheel::Handle> idle_timers;
+    std::function<void(uint32_t, std::chrono::steady_clock::duration)> arm_idle_timer =
+        [&](uint32_t conn_id, std::chrono::steady_clock::duration delay) {
+          idle_timers[conn_id] = ctx.schedule(delay, [&, conn_id]() {
+            auto it = local_connections.find(conn_id);
+            if (it == local_connections.end()) return;
+            auto idle_for = std::chrono::steady_clock::now() - it->second->last_active();
+            if (idle_for >= idle_timeout && it->second->idle()) {
+              it->second->shutdown();  // Disconnects on the read completion
+              return;
+            }
+            // Active since the timer was set, or still owed a reply
+            std::chrono::steady_clock::duration next = idle_timeout;
+            if (idle_for < idle_timeout) next -= idle_for;
+            arm_idle_timer(conn_id, next);
+          });
+        };
+
+    // Track new connections (TCP and Unix socket alike)
+    auto on_connect = [&](quine::network::Connection* conn) {
+      local_connections[conn->get_id()] = conn;
+      topology.client_connected(core_id);
+      if (idle_timeout.count() > 0) arm_idle_timer(conn->get_id(), idle_timeout);
+    };
+
+    auto on_disconnect = [&](uint32_t conn_id) {
+      local_connections.erase(conn_id);
+      topology.client_disconnected(core_id);
+      auto it = idle_timers.find(conn_id);
+      if (it != idle_timers.end()) {
+        ctx.cancel(it->second);
+        idle_timers.erase(it);
+      }
+    };
+    server.set_on_connect(on_connect);
+    server.set_on_disconnect(on_disconnect);
+    server.set_balanced(config.steering == quine::network::Steering::LEAST_CONNECTIONS);
+    server.set_client_limits(&config.client_limits);
+
+    // Unix domain socket for clients on this host: one per core, or a
+    // shared one accepted by the first client core, which spreads its
+    // connections like least-connections steering
+    std::optional<quine::network::TcpServer> unix_server;
+    if (!config.unixsocket.empty()) {
+      size_t first_client_core = topology.io_core_count() > 0 ? topology.get_max_cores() : 0;
+      if (config.unixsocket_per_core) {
+        unix_server.emplace(ctx, config.unixsocket + "." + std::to_string(core_id),
+                            config.unixsocket_perm, topology, core_id);
+      } else if (core_id == first_client_core) {
+        unix_server.emplace(ctx, config.unixsocket, config.unixsocket_perm, topology, core_id);
+        unix_server->set_balanced(true);
+      }
+      if (unix_server) {
+        unix_server->set_client_limits(&config.client_limits);
+        unix_server->set_on_connect(on_connect);
+        unix_server->set_on_disconnect(on_disconnect);
+      }
+    }
+
+    // Cores beyond the active set (spare capacity) and the data cores of a
+    // split topology do not accept connections
+    if (topology.serves_clients(core_id)) {
+      server.start();
+      if (unix_server) unix_server->start();
+    }
+
+    // Connections with forwarded replies waiting to be written
+    std::vector<uint32_t> reply_ready;
+
+    // Arguments of remote requests, decoded in place (strings keep capacity)
+    std::vector<std::string> remote_args;
+
+    // 4. Register ITC Notification Handler
+    auto* my_channel = topology.get_channel(core_id);
+    std::function<void(quine::core::Message&&)> handle_message = [&](quine::core::Message&& msg) {
+      if (msg.type == quine::core::MessageType::BATCH) {
+        // Commands/replies coalesced by another core during one tick
+        for (auto& item : msg.batch) handle_message(std::move(item));
+
+      } else if (msg.type == quine::core::MessageType::REQUEST) {
+        // Execute on local shard (Remote Request)
+        quine::core::decode_args(msg.payload, remote_args);
+        msg.payload.reset();  // Hand the buffer back to the sender's pool early
+        topology.request_received(core_id);
+        std::string response_str;
+
+        // Use Registry to execute command
+        auto* cmd = quine::commands::CommandRegistry::instance().get_command(remote_args[0]);
+        if (cmd) {
+          // Execute the command directly on this core
+          // Note: remote_args contains the full command [SET, key, value]
+          topology.begin_request(core_id, {msg.origin_core_id, msg.seq, msg.asking});
+          response_str = cmd->execute(topology, core_id, msg.conn_id, remote_args);
+          topology.end_request(core_id);
+          // Since we are on the target core, execute() normally returns the
+          // result string. If the slot moved away in the meantime, execute()
+          // forwards it again (empty result) and the new owner replies to
+          // the origin core directly.
+        } else {
+          response_str = "-ERR unknown command '" + remote_args[0] + "'\r\n";
+        }
 
-    // Track new connections
-    server.set_on_connect(
-        [&](quine::network::Connection* conn) { local_connections[conn->get_id()] = conn; });
+        // Send RESPONSE back to origin core (batched until end of tick)
+        if (!response_str.empty()) {
+          topology.respond(core_id, msg, response_str);
+        }
 
-    server.set_on_disconnect([&](uint32_t conn_id) { local_connections.erase(conn_id); });
+      } else if (msg.type == quine::core::MessageType::RESPONSE &&
+                 msg.conn_id == quine::core::Topology::CALL_CONN_ID) {
+        // Reply to a coroutine's Call: resumes it
+        topology.complete_call(core_id, msg.seq, msg.payload.view(), !msg.partial);
+
+      } else if (msg.type == quine::core::MessageType::RESPONSE) {
+        // Received result from another core for one of our connections
+        auto it = local_connections.find(msg.conn_id);
+        if (it != local_connections.end()) {
+          it->second->deliver_reply(msg.seq, msg.payload.view(), !msg.partial);
+          reply_ready.push_back(msg.conn_id);
+        }
 
-    server.start();
+      } else if (msg.type == quine::core::MessageType::MIGRATE_START) {
+        migrator.start(std::move(msg.migration->slot_moves));
+      } else if (msg.type == quine::core::MessageType::MIGRATE_STEP) {
+        migrator.step();
+      } else if (msg.type == quine::core::MessageType::MIGRATE_BATCH) {
+        migrator.import(std::move(msg.migration->keys));
+      } else if (msg.type == quine::core::MessageType::CORE_RETIRE) {
+        server.stop();
+        if (unix_server) unix_server->stop();
+      } else if (msg.type == quine::core::MessageType::CORE_RESUME) {
+        if (topology.io_core_count() == 0) {
+          server.start();
+          if (unix_server) unix_server->start();
+        }
+      } else if (msg.type == quine::core::MessageType::CONN_HANDOFF) {
+        // A client whose keys live here moved over from another core
+        server.adopt(msg.migration->connection);
+      } else if (msg.type == quine::core::MessageType::FLUSH) {
+        shard->flush(msg.lazy);
+      }
+    };
 
-    // 4. Register ITC Notification Handler
-    auto* my_channel = topology.get_channel(core_id);
     ctx.set_notification_handler([&]() {
       // Process all pending messages in the inbox
-      my_channel->consume_all([&](quine::core::Message&& msg) {
-        if (msg.type == quine::core::MessageType::REQUEST) {
-          // Execute on local shard (Remote Request)
-          std::string cmd_name = msg.args[0];
-          std::string response_str;
-
-          // Use Registry to execute command
-          auto* cmd = quine::commands::CommandRegistry::instance().get_command(cmd_name);
-          if (cmd) {
-            // Execute the command directly on this core
-            // Note: msg.args contains the full command [SET, key, value]
-            response_str = cmd->execute(topology, core_id, msg.conn_id, msg.args);
-            // Since we are on the target core, execute() should return the
-            // result string and NOT perform forwarding (as is_local will be
-            // true). However, if the command returns empty string (which
-            // implies "forwarded"), that would be a bug here since we ARE the
-            // destination. But execute() logic checks is_local(core_id, key).
-            // Since we routed it here, it MUST be local.
-          } else {
-            response_str = "-ERR unknown command '" + cmd_name + "'\r\n";
-          }
-
-          // Send RESPONSE back to origin core
-          if (!response_str.empty()) {
-            quine::core::Message reply;
-            reply.type = quine::core::MessageType::RESPONSE;
-            reply.origin_core_id = core_id;  // Sender (us)
-            reply.conn_id = msg.conn_id;     // Route to original connection
-            reply.payload = response_str;
-            reply.success = true;
-
-            auto* origin_channel = topology.get_channel(msg.origin_core_id);
-            if (origin_channel) {
-              origin_channel->push(reply);
-              topology.notify_core(msg.origin_core_id);
-            }
-          }
-
-        } else if (msg.type == quine::core::MessageType::RESPONSE) {
-          // Received result from another core for one of our connections
-          auto it = local_connections.find(msg.conn_id);
-          if (it != local_connections.end()) {
-            auto* conn = it->second;
-            // Convert string to vector<char>
-            std::vector<char> resp_data(msg.payload.begin(), msg.payload.end());
-            conn->submit_write(ctx, std::move(resp_data));
-          }
-        }
-      });
+      my_channel->consume_all(handle_message);
+    });
+
+    // Busy-poll mode: the inbox is drained while the loop spins, and other
+    // cores skip the eventfd write meanwhile
+    ctx.set_poll_handler([&](bool spinning) {
+      topology.set_polling(core_id, spinning);
+      if (!my_channel->has_items()) return false;
+      my_channel->consume_all(handle_message);
+      return true;
+    });
+    topology.register_loop_stats(core_id, &ctx.stats());
+
+    // 5. End of each loop iteration: one write per connection with replies,
+    // one ITC message (and wakeup) per target core.
+    // Replies (or parts) produced outside execute(): by deferred
+    // (long-running) commands and by coroutines
+    auto& scheduler = topology.get_scheduler(core_id);
+    scheduler.set_sink([&](const quine::core::Scheduler::Target& target, std::string_view part,
+                           bool last) {
+      if (target.origin_core_id != core_id) {
+        topology.respond(core_id, target.origin_core_id, target.conn_id, target.seq, part, !last);
+        return true;
+      }
+      if (target.conn_id == quine::core::Topology::CALL_CONN_ID) {
+        // A Call this core sent to itself
+        topology.complete_call(core_id, target.seq, part, last);
+        return true;
+      }
+      auto it = local_connections.find(target.conn_id);
+      if (it == local_connections.end()) return false;  // Client gone: drop the job
+      it->second->deliver_reply(target.seq, part, last);
+      reply_ready.push_back(target.conn_id);
+      return true;
+    });
+    // Streamed replies to local clients advance as the client reads them.
+    // Parts for other cores' clients are not held back.
+    scheduler.set_ready([&](const quine::core::Scheduler::Target& target) {
+      if (target.origin_core_id != core_id) return true;
+      auto it = local_connections.find(target.conn_id);
+      return it == local_connections.end() || it->second->wants_reply_part(target.seq);
+    });
+
+    ctx.set_tick_handler([&]() {
+      // A slice of each long-running command first, so its part goes out now
+      bool jobs_left = scheduler.run();
+
+      for (uint32_t conn_id : reply_ready) {
+        auto it = local_connections.find(conn_id);
+        if (it != local_connections.end()) it->second->flush_replies(ctx);
+      }
+      reply_ready.clear();
+      topology.flush(core_id);
+
+      // Compaction moves entries between buckets: not while the migrator or a
+      // local job scans. A SAVE on any core reads this shard too: no
+      // defragmentation at all until it is done.
+      // Unfinished cycles wake the loop again, like migration steps.
+      if (defrag && !topology.snapshot_scan_active() &&
+          defrag->step(!migrator.active() && !scheduler.active())) {
+        ctx.notify();
+      }
+      // Large values detached by UNLINK, FLUSHALL ASYNC, overwrites, expiry
+      if (shard && shard->reclaimer().step()) ctx.notify();
+      if (jobs_left) ctx.notify();
     });
 
     std::cout << "[Core " << core_id << "] Started on thread " << std::this_thread::get_id()
-              << std::endl;
+              << (cpu >= 0 ? ", CPU " + std::to_string(cpu) : std::string(", unpinned"))
+              << (io_core ? ", I/O only" : "") << ", io_uring: " << ctx.features() << std::endl;
 
-    // 4. Run Event Loop
+    // 6. Run Event Loop
     ctx.run();
   } catch (const std::exception& e) {
     std::cerr << "[Core " << core_id << "] Error: " << e.what() << std::endl;
+    if (!registered) started.set_exception(std::current_exception());
   }
 }
 
 #include "commands/admin_commands.hpp"
+#include "commands/cluster_commands.hpp"
 #include "commands/generic_commands.hpp"
 #include "commands/hash_commands.hpp"
 #include "commands/set_commands.hpp"
@@ -127,6 +333,8 @@ void worker_main(size_t core_id, int port, quine::core::Topology& topology) {
 int main(int argc, char* argv[]) {
   (void)argc;
   (void)argv;
+  // Writes to a client that went away fail with EPIPE instead
+  signal(SIGPIPE, SIG_IGN);
   // 1. Load Configuration
   quine::core::Config config;
 
@@ -137,29 +345,146 @@ int main(int argc, char* argv[]) {
     config.port = std::stoi(env_port);
   }
 
-  unsigned int n_threads =
-      config.worker_threads > 0 ? config.worker_threads : std::thread::hardware_concurrency();
+  if (const char* env_workers = std::getenv("QUINE_WORKERS")) {
+    config.worker_threads = std::stoi(env_workers);
+  }
+  if (const char* env_max_workers = std::getenv("QUINE_MAX_WORKERS")) {
+    config.max_worker_threads = std::stoi(env_max_workers);
+  }
+  if (const char* env_io_threads = std::getenv("QUINE_IO_THREADS")) {
+    config.io_threads = std::stoi(env_io_threads);
+  }
+  if (const char* env_timeout = std::getenv("QUINE_TIMEOUT")) {
+    config.timeout = std::stoi(env_timeout);
+  }
+  if (const char* env_unixsocket = std::getenv("QUINE_UNIXSOCKET")) {
+    config.unixsocket = env_unixsocket;
+  }
+  if (const char* env_perm = std::getenv("QUINE_UNIXSOCKETPERM")) {
+    config.unixsocket_perm = std::stoul(env_perm, nullptr, 8);
+  }
+  if (const char* env_per_core = std::getenv("QUINE_UNIXSOCKET_PER_CORE")) {
+    config.unixsocket_per_core = std::string(env_per_core) != "0";
+  }
+  // "<hard bytes> <soft bytes> <soft seconds>", as Redis' client-output-buffer-limit
+  if (const char* env_output_limit = std::getenv("QUINE_CLIENT_OUTPUT_LIMIT")) {
+    std::istringstream fields(env_output_limit);
+    long long soft_seconds = 0;
+    auto& limits = config.client_limits;
+    fields >> limits.output_hard >> limits.output_soft >> soft_seconds;
+    limits.output_soft_for = std::chrono::seconds(soft_seconds);
+  }
+  // "<bytes> <replies>": stop reading from a client this far behind
+  if (const char* env_read_pause = std::getenv("QUINE_CLIENT_READ_PAUSE")) {
+    std::istringstream fields(env_read_pause);
+    fields >> config.client_limits.read_pause_bytes >> config.client_limits.read_pause_replies;
+  }
+  // Generate streamed replies only while less than this is left to write
+  if (const char* env_stream_pause = std::getenv("QUINE_CLIENT_STREAM_PAUSE")) {
+    config.client_limits.stream_pause_bytes = std::stoul(env_stream_pause);
+  }
+  // Shed requests to a core with this many queued, or this far behind
+  if (const char* env_max_queued = std::getenv("QUINE_ADMISSION_MAX_QUEUED")) {
+    config.admission.max_queued_requests = std::stoul(env_max_queued);
+  }
+  if (const char* env_max_lag = std::getenv("QUINE_ADMISSION_MAX_LAG_US")) {
+    config.admission.max_loop_lag = std::chrono::microseconds(std::stoul(env_max_lag));
+  }
+  // hash | cpu | least-connections
+  if (const char* env_steering = std::getenv("QUINE_STEERING")) {
+    config.steering = quine::network::parse_steering(env_steering);
+  }
+
+  // CPU list in cpuset syntax ("0-3,8-11"); QUINE_PIN_WORKERS=0 disables pinning
+  if (const char* env_cpus = std::getenv("QUINE_WORKER_CPUS")) {
+    config.worker_cpus = quine::core::parse_cpu_list(env_cpus);
+  }
+  if (const char* env_pin = std::getenv("QUINE_PIN_WORKERS")) {
+    config.pin_workers = std::string(env_pin) != "0";
+  }
+  if (config.pin_workers && config.worker_cpus.empty()) {
+    config.worker_cpus = quine::core::allowed_cpus();
+  }
+
+  // io_uring profile; features the kernel lacks fall back at startup
+  if (const char* env_sqpoll = std::getenv("QUINE_IO_SQPOLL")) {
+    config.ring.sqpoll = std::string(env_sqpoll) != "0";
+  }
+  if (const char* env_sqpoll_cpus = std::getenv("QUINE_IO_SQPOLL_CPUS")) {
+    config.sqpoll_cpus = quine::core::parse_cpu_list(env_sqpoll_cpus);
+  }
+  if (const char* env_single_issuer = std::getenv("QUINE_IO_SINGLE_ISSUER")) {
+    config.ring.single_issuer = std::string(env_single_issuer) != "0";
+  }
+  if (const char* env_files = std::getenv("QUINE_IO_REGISTERED_FILES")) {
+    config.ring.registered_files = std::stoul(env_files);
+  }
+  if (const char* env_busy_poll = std::getenv("QUINE_BUSY_POLL_US")) {
+    config.ring.busy_poll_us = std::stoul(env_busy_poll);
+  }
+  if (const char* env_zero_copy = std::getenv("QUINE_IO_ZEROCOPY_SEND")) {
+    config.ring.zero_copy_send_min = std::stoull(env_zero_copy);
+  }
 
-  // Initialize Topology FIRST because RDB loader needs it
-  quine::core::Topology topology(n_threads);
+  // off | transparent | explicit
+  if (const char* env_huge = std::getenv("QUINE_HUGE_PAGES")) {
+    std::string mode = env_huge;
+    if (mode == "transparent") {
+      config.huge_pages = quine::storage::HugePageMode::TRANSPARENT;
+    } else if (mode == "explicit") {
+      config.huge_pages = quine::storage::HugePageMode::EXPLICIT;
+    }
+  }
+  quine::storage::set_huge_page_mode(config.huge_pages);
 
-  std::cout << "QuineDB Server starting on " << n_threads << " cores, port " << config.port
-            << std::endl;
+  if (const char* env_maxmemory = std::getenv("QUINE_MAXMEMORY")) {
+    config.maxmemory = std::stoull(env_maxmemory);
+  }
+
+  if (const char* env_defrag = std::getenv("QUINE_ACTIVE_DEFRAG")) {
+    config.defrag.enabled = std::string(env_defrag) != "0";
+  }
+  if (const char* env_threshold = std::getenv("QUINE_DEFRAG_THRESHOLD")) {
+    config.defrag.threshold_percent = std::stoul(env_threshold);
+  }
+  if (const char* env_ignore = std::getenv("QUINE_DEFRAG_IGNORE_BYTES")) {
+    config.defrag.ignore_bytes = std::stoull(env_ignore);
+  }
+  if (const char* env_tombstones = std::getenv("QUINE_DEFRAG_TOMBSTONES")) {
+    config.defrag.tombstone_percent = std::stoul(env_tombstones);
+  }
+
+  unsigned int n_threads =
+      config.worker_threads > 0 ? config.worker_threads : std::thread::hardware_concurrency();
+  // Split topology: the I/O threads come out of the worker threads, leaving
+  // at least one data core
+  unsigned int io_threads = std::clamp<int>(config.io_threads, 0, static_cast<int>(n_threads) - 1);
+  unsigned int data_threads = n_threads - io_threads;
+  unsigned int max_threads = std::max<unsigned int>(data_threads, config.max_worker_threads);
+
+  // Shards are allocated by their (pinned) workers, see worker_main
+  quine::core::Topology topology(data_threads, max_threads,
+                                 quine::core::Topology::ShardAllocation::BY_WORKER, io_threads);
+  topology.set_maxmemory(config.maxmemory);
+  topology.set_admission_limits(config.admission);
+
+  std::cout << "QuineDB Server starting on " << n_threads << " cores";
+  if (io_threads > 0) std::cout << " (" << data_threads << " data, " << io_threads << " I/O)";
+  std::cout << ", port " << config.port << std::endl;
   std::cout << "RDB Persistence: " << config.rdb_filename << " (" << config.save_params.size()
             << " save points)" << std::endl;
-
-  // Try loading RDB
-  if (quine::persistence::RdbManager::load(topology, config.rdb_filename)) {
-    std::cout << "[RDB] Loaded successfully from " << config.rdb_filename << std::endl;
-  } else {
-    std::cout << "[RDB] No valid RDB file found, starting empty." << std::endl;
+  if (config.pin_workers && config.worker_cpus.size() < n_threads) {
+    std::cerr << "Warning: " << n_threads << " worker threads but " << config.worker_cpus.size()
+              << " CPUs to pin them to; some will share a CPU" << std::endl;
   }
 
   // 1. Initialize Registry
   auto& registry = quine::commands::CommandRegistry::instance();
   registry.register_command(std::make_unique<quine::commands::SetCommand>());
   registry.register_command(std::make_unique<quine::commands::GetCommand>());
+  registry.register_command(std::make_unique<quine::commands::MGetCommand>());
   registry.register_command(std::make_unique<quine::commands::DelCommand>());
+  registry.register_command(std::make_unique<quine::commands::UnlinkCommand>());
 
   registry.register_command(std::make_unique<quine::commands::LPushCommand>());
   registry.register_command(std::make_unique<quine::commands::LPopCommand>());
@@ -187,18 +512,61 @@ int main(int argc, char* argv[]) {
   registry.register_command(std::make_unique<quine::commands::ExpireCommand>());
   registry.register_command(std::make_unique<quine::commands::TtlCommand>());
   registry.register_command(std::make_unique<quine::commands::SaveCommand>());
-
-  std::vector<std::thread> threads;
-  threads.reserve(n_threads);
-
-  // 2. Launch pinned worker threads
-  for (unsigned int i = 0; i < n_threads; ++i) {
-    threads.emplace_back(worker_main, i, config.port, std::ref(topology));
+  registry.register_command(std::make_unique<quine::commands::InfoCommand>());
+  registry.register_command(std::make_unique<quine::commands::FlushAllCommand>());
+  registry.register_command(std::make_unique<quine::commands::ClusterCommand>());
+
+  // Every core's listener joins it; it steers connections between them
+  quine::network::ReuseportGroup reuseport(config.steering);
+
+  std::deque<std::thread> threads;  // Stable references while cores are added
+  std::mutex threads_mutex;
+
+  // Workers added at runtime (CLUSTER ADDCORE) are spawned on demand
+  topology.set_core_launcher([&](size_t core_id) {
+    std::promise<void> started;
+    std::future<void> result = started.get_future();
+    std::lock_guard<std::mutex> lock(threads_mutex);
+    threads.emplace_back(worker_main, core_id, threads.size(), std::cref(config),
+                         std::ref(topology), std::ref(reuseport), std::move(started));
+    return result;
+  });
+
+  // 2. Launch pinned worker threads: the data cores, then the I/O cores
+  // (numbered after the data cores' headroom). CPUs are taken in launch
+  // order, so the I/O cores get the ones after the data cores'.
+  {
+    std::lock_guard<std::mutex> lock(threads_mutex);
+    for (unsigned int i = 0; i < data_threads; ++i) {
+      threads.emplace_back(worker_main, i, i, std::cref(config), std::ref(topology),
+                           std::ref(reuseport), std::promise<void>());
+    }
+    for (unsigned int i = 0; i < io_threads; ++i) {
+      threads.emplace_back(worker_main, max_threads + i, data_threads + i, std::cref(config),
+                           std::ref(topology), std::ref(reuseport), std::promise<void>());
+    }
   }
 
-  // 3. Wait for threads
-  for (auto& t : threads) {
-    if (t.joinable()) t.join();
+  // Try loading RDB, once every worker has allocated its shard
+  topology.wait_for_all_cores();
+  if (quine::persistence::RdbManager::load(topology, config.rdb_filename)) {
+    std::cout << "[RDB] Loaded successfully from " << config.rdb_filename << std::endl;
+  } else {
+    std::cout << "[RDB] No valid RDB file found, starting empty." << std::endl;
+  }
+  topology.mark_loaded();
+
+  // 3. Wait for threads (workers run until the process exits), those added
+  // by CLUSTER ADDCORE included. The lock is not held while joining: a
+  // running worker may still add one.
+  for (size_t i = 0;; ++i) {
+    std::thread* thread;
+    {
+      std::lock_guard<std::mutex> lock(threads_mutex);
+      if (i == threads.size()) break;
+      thread = &threads[i];
+    }
+    thread->join();
   }
 
   return 0;
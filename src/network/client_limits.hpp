@@ -0,0 +1,31 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+namespace quine {
+namespace network {
+
+/// @brief Bounds on what one client may make the server hold for it.
+///
+/// Output is every reply byte buffered for the client: written partly or
+/// not at all, and replies of forwarded commands waiting for earlier ones.
+/// Past the hard limit, or past the soft limit for longer than
+/// `output_soft_for`, the client is disconnected. Before that, reading
+/// from the client pauses while its output or its unanswered commands
+/// reach the read-pause thresholds, so a pipelining client is slowed down
+/// to the speed at which it consumes replies. Streamed replies (see
+/// core::Scheduler) are likewise generated only while less than
+/// `stream_pause_bytes` of the client's output waits to be written, so a
+/// huge reply never sits in memory whole.
+struct ClientLimits {
+  size_t output_hard = 0;  // Bytes; 0 = no limit
+  size_t output_soft = 0;  // Bytes; 0 = no limit
+  std::chrono::seconds output_soft_for{0};
+  size_t read_pause_bytes = 1 << 20;  // 0 = never pause
+  size_t read_pause_replies = 1024;   // 0 = never pause
+  size_t stream_pause_bytes = 256 << 10;  // 0 = never pause
+};
+
+}  // namespace network
+}  // namespace quine
@@ -1,9 +1,11 @@
 #include "connection.hpp"
 
 #include <fcntl.h>
+#include <sys/socket.h>
 #include <unistd.h>
 
 #include <cctype>  // for std::toupper
+#include <cerrno>
 #include <cstring>
 #include <iostream>
 
@@ -11,6 +13,17 @@
 #include "../core/io_context.hpp"  // [NEW] Needed for full definition
 #include "liburing.h"
 
+// Zero-copy sends need Linux 6.0 headers (liburing 2.3); without them,
+// stored values are written from where they are, without the offload
+#ifdef IORING_CQE_F_NOTIF
+#define QUINE_HAVE_SEND_ZC 1
+#else
+#define IORING_CQE_F_NOTIF 0U
+#endif
+#ifndef IORING_CQE_F_MORE
+#define IORING_CQE_F_MORE 0U
+#endif
+
 namespace quine {
 namespace network {
 
@@ -34,19 +47,56 @@ struct Connection::WriteOp : public core::Operation {
   }
 };
 
+// One zero-copy send. The first completion is its result; with
+// IORING_CQE_F_MORE, a notification follows once the kernel is done with
+// the bytes, which the operation keeps pinned until then.
+struct Connection::ZeroCopySendOp : public core::Operation {
+  Connection* conn;
+  core::IoContext& ctx;
+  storage::SharedString pinned;
+  ZeroCopySendOp(Connection* c, core::IoContext& io, storage::SharedString bytes)
+      : conn(c), ctx(io), pinned(std::move(bytes)) {}
+  void complete(int res) override {
+    complete_with_flags(res, 0);
+  }
+  void complete_with_flags(int res, uint32_t flags) override {
+    Connection* c = conn;
+    core::IoContext& io = ctx;
+    if (flags & IORING_CQE_F_NOTIF) {
+      delete this;
+      c->handle_zero_copy_done(io);
+      return;
+    }
+    if (!(flags & IORING_CQE_F_MORE)) {
+      // No notification coming
+      delete this;
+      c->zero_copy_pending_--;
+    }
+    c->handle_zero_copy_sent(res, io);
+  }
+};
+
 // --- Connection Implementation ---
 
 // Static counter for connection IDs
 static std::atomic<uint32_t> next_conn_id{1};
 
+static const ClientLimits default_limits;
+
 Connection::Connection(int fd, core::Topology& topology, size_t core_id)
-    : fd_(fd), id_(next_conn_id++), topology_(topology), core_id_(core_id) {
+    : fd_(fd),
+      id_(next_conn_id++),
+      last_active_(std::chrono::steady_clock::now()),
+      limits_(&default_limits),
+      topology_(topology),
+      core_id_(core_id),
+      locality_(topology.shard_count()) {
   // Set non-blocking
   int flags = fcntl(fd_, F_GETFL, 0);
   fcntl(fd_, F_SETFL, flags | O_NONBLOCK);
 
   // Pre-allocate decent buffer
-  read_buffer_.reserve(4096);
+  read_buffer_.resize(4096);
 }
 
 Connection::~Connection() {
@@ -62,89 +112,368 @@ void Connection::resize_buffer(size_t size) {
 void Connection::start(core::IoContext& ctx) {
   read_op_ = std::make_unique<ReadOp>(this, ctx);
   write_op_ = std::make_unique<WriteOp>(this, ctx);
+  file_slot_ = ctx.register_file(fd_);
 
-  submit_read(ctx);
+  read_paused_ = false;
+  maybe_read(ctx);
+}
+
+void Connection::shutdown() {
+  ::shutdown(fd_, SHUT_RDWR);
 }
 
 void Connection::submit_read(core::IoContext& ctx) {
+  reading_ = true;
   struct io_uring_sqe* sqe = ctx.get_sqe();
-  io_uring_prep_read(sqe, fd_, read_buffer_.data(), read_buffer_.capacity(), 0);
+  io_uring_prep_read(sqe, fd_, read_buffer_.data() + read_len_, read_buffer_.size() - read_len_,
+                     0);
+  core::IoContext::use_registered(sqe, file_slot_);
   io_uring_sqe_set_data(sqe, read_op_.get());
 }
 
 void Connection::submit_write(core::IoContext& ctx, std::vector<char> data) {
-  write_queue_.push_back(std::move(data));
+  write_queue_.push_back({std::move(data), {}});
 
   if (!is_writing_) {
     is_writing_ = true;
-    auto& current_data = write_queue_.front();
-    struct io_uring_sqe* sqe = ctx.get_sqe();
-    io_uring_prep_write(sqe, fd_, current_data.data(), current_data.size(), 0);
-    io_uring_sqe_set_data(sqe, write_op_.get());
+    submit_front_write(ctx);
+  }
+}
+
+void Connection::submit_front_write(core::IoContext& ctx) {
+  const auto& chunk = write_queue_.front();
+  std::string_view rest = chunk.view().substr(write_offset_);
+  struct io_uring_sqe* sqe = ctx.get_sqe();
+#ifdef QUINE_HAVE_SEND_ZC
+  size_t zero_copy_min = ctx.zero_copy_send_min();
+  if (chunk.shared && zero_copy_ && zero_copy_min > 0 && rest.size() >= zero_copy_min) {
+    auto* op = new ZeroCopySendOp(this, ctx, chunk.shared);
+    zero_copy_pending_++;
+    io_uring_prep_send_zc(sqe, fd_, rest.data(), rest.size(), MSG_NOSIGNAL, 0);
+    core::IoContext::use_registered(sqe, file_slot_);
+    io_uring_sqe_set_data(sqe, op);
+    return;
+  }
+#endif
+  io_uring_prep_write(sqe, fd_, rest.data(), rest.size(), 0);
+  core::IoContext::use_registered(sqe, file_slot_);
+  io_uring_sqe_set_data(sqe, write_op_.get());
+}
+
+void Connection::handle_zero_copy_sent(int res, core::IoContext& ctx) {
+  if ((res == -EOPNOTSUPP || res == -EINVAL) && !closing_) {
+    // Not for this socket (Unix domain) or kernel: write from now on
+    zero_copy_ = false;
+    submit_front_write(ctx);
+    return;
+  }
+  handle_write(res, ctx);
+}
+
+void Connection::handle_zero_copy_done(core::IoContext& ctx) {
+  zero_copy_pending_--;
+  if (closing_) {
+    finish_close(ctx);
+  } else if (!is_writing_ && handoff_target_ != LocalityTracker::NO_CORE) {
+    try_handoff();
   }
 }
 
 void Connection::handle_read(int res, core::IoContext& ctx) {
-  if (res <= 0) {
-    if (on_disconnect_) on_disconnect_(id_);
-    delete this;
+  reading_ = false;
+  if (res <= 0 || closing_) {
+    closing_ = true;
+    finish_close(ctx);
     return;
   }
 
-  // Process data
-  auto response = handle_data(read_buffer_.data(), res);
+  // Process every complete command in the buffer
+  last_active_ = std::chrono::steady_clock::now();
+  read_len_ += res;
+  size_t consumed = handle_data(read_buffer_.data(), read_len_);
 
-  if (!response.empty()) {
-    submit_write(ctx, std::move(response));
+  // Keep the unparsed tail (a partial header line) for the next read
+  if (consumed < read_len_) {
+    std::memmove(read_buffer_.data(), read_buffer_.data() + consumed, read_len_ - consumed);
   }
+  read_len_ -= consumed;
+  if (read_len_ == read_buffer_.size()) {
+    read_buffer_.resize(read_buffer_.size() * 2);
+  }
+
+  // Moving to another core: stop reading, the new core resumes once the
+  // remaining replies are written (see try_handoff)
+  bool moving = handoff_target_ != LocalityTracker::NO_CORE;
+  flush_replies(ctx);
+  if (moving) return;
 
   // Re-submit read to keep listening
-  submit_read(ctx);
+  maybe_read(ctx);
 }
 
 void Connection::handle_write(int res, core::IoContext& ctx) {
-  if (res < 0) {
-    std::cerr << "Write error: " << -res << std::endl;
-    if (on_disconnect_) on_disconnect_(id_);
-    delete this;
+  if (res < 0 || closing_) {
+    if (!closing_) std::cerr << "Write error: " << -res << std::endl;
+    is_writing_ = false;
+    closing_ = true;
+    ::shutdown(fd_, SHUT_RDWR);  // Ends the pending read, if any
+    finish_close(ctx);
     return;
   }
 
   if (!write_queue_.empty()) {
+    write_offset_ += res;
+    output_bytes_ -= res;
+    if (write_offset_ < write_queue_.front().view().size()) {
+      // Short write: send the remainder of the same buffer
+      submit_front_write(ctx);
+      return;
+    }
+    if (spare_.capacity() == 0 && !write_queue_.front().shared) {
+      spare_ = std::move(write_queue_.front().bytes);
+      spare_.clear();
+    }
     write_queue_.pop_front();
+    write_offset_ = 0;
   }
 
   if (!write_queue_.empty()) {
-    auto& current_data = write_queue_.front();
-    struct io_uring_sqe* sqe = ctx.get_sqe();
-    io_uring_prep_write(sqe, fd_, current_data.data(), current_data.size(), 0);
-    io_uring_sqe_set_data(sqe, write_op_.get());
+    submit_front_write(ctx);
   } else {
     is_writing_ = false;
+    if (handoff_target_ != LocalityTracker::NO_CORE && try_handoff()) return;
+  }
+  enforce_limits(ctx);
+  if (read_paused_) maybe_read(ctx);
+}
+
+void Connection::maybe_read(core::IoContext& ctx) {
+  if (reading_ || closing_ || handoff_target_ != LocalityTracker::NO_CORE) return;
+  bool behind = (limits_->read_pause_bytes > 0 && output_bytes_ >= limits_->read_pause_bytes) ||
+                (limits_->read_pause_replies > 0 &&
+                 next_request_seq_ - next_reply_seq_ >= limits_->read_pause_replies);
+  if (behind) {
+    // Resumed as replies are written (handle_write) or arrive (flush_replies)
+    if (!read_paused_) topology_.count_read_pause(core_id_);
+    read_paused_ = true;
+    return;
+  }
+  read_paused_ = false;
+  submit_read(ctx);
+}
+
+void Connection::enforce_limits(core::IoContext& ctx) {
+  if (closing_) return;
+  auto now = std::chrono::steady_clock::now();
+  bool over_soft = limits_->output_soft > 0 && output_bytes_ > limits_->output_soft;
+  bool over_hard = limits_->output_hard > 0 && output_bytes_ > limits_->output_hard;
+  bool soft_expired = over_soft && over_soft_since_ != std::chrono::steady_clock::time_point{} &&
+                      now - over_soft_since_ >= limits_->output_soft_for;
+
+  if (over_hard || soft_expired || (over_soft && limits_->output_soft_for.count() == 0)) {
+    topology_.count_output_limit_disconnect(core_id_);
+    closing_ = true;
+    ctx.cancel(soft_timer_);
+    // Free what is not being written right now, then fail the I/O in flight
+    pending_replies_.clear();
+    output_.clear();
+    while (write_queue_.size() > (is_writing_ ? 1 : 0)) write_queue_.pop_back();
+    ::shutdown(fd_, SHUT_RDWR);
+    // A paused connection has no read to complete: one now returns at once
+    if (!reading_) submit_read(ctx);
+    return;
+  }
+
+  if (over_soft && over_soft_since_ == std::chrono::steady_clock::time_point{}) {
+    // Checked again when the grace period ends, even if the client stalls
+    over_soft_since_ = now;
+    soft_timer_ = ctx.schedule(limits_->output_soft_for, [this, &ctx]() {
+      soft_timer_ = {};
+      enforce_limits(ctx);
+    });
+  } else if (!over_soft && over_soft_since_ != std::chrono::steady_clock::time_point{}) {
+    over_soft_since_ = {};
+    ctx.cancel(soft_timer_);
+  }
+}
+
+void Connection::finish_close(core::IoContext& ctx) {
+  if (reading_ || is_writing_ || zero_copy_pending_ > 0) return;  // Back here from that completion
+  if (on_disconnect_) on_disconnect_(id_);
+  ctx.cancel(soft_timer_);
+  ctx.unregister_file(file_slot_);  // The table's reference would keep the socket open
+  delete this;
+}
+
+size_t Connection::handle_data(const char* data, size_t len) {
+  size_t offset = 0;
+
+  while (offset < len && !closing_) {
+    size_t consumed = 0;
+    auto result = parser_.consume(reinterpret_cast<const uint8_t*>(data + offset), len - offset,
+                                  consumed);
+
+    if (result == RespParser::Result::Complete) {
+      offset += consumed;
+      pipeline_.push_back(parser_.take_args());
+      if (pipeline_.size() == PIPELINE_WINDOW) execute_pipeline();
+
+      // Reset for next command
+      parser_.reset();
+    } else if (result == RespParser::Result::Error) {
+      execute_pipeline();
+      complete_reply(next_request_seq_++, "-ERR Protocol Error\r\n");
+      parser_.reset();
+      return len;  // Drop the rest of the buffer
+    } else {
+      offset += consumed;
+      break;
+    }
+  }
+
+  execute_pipeline();
+  return offset;
+}
+
+void Connection::execute_pipeline() {
+  if (pipeline_.size() > 1 && !topology_.is_io_core(core_id_)) {
+    // Overlap the cache misses of the whole window instead of taking them
+    // one command at a time. Only a hint: ownership is checked on execution.
+    storage::Shard* shard = topology_.get_shard(core_id_);
+    for (const auto& args : pipeline_) {
+      if (args.size() >= 2 && topology_.get_target_core(args[1]) == core_id_) {
+        shard->prefetch(args[1]);
+      }
+    }
+  }
+
+  for (const auto& args : pipeline_) run_command(args);
+  pipeline_.clear();
+}
+
+void Connection::run_command(const std::vector<std::string>& args) {
+  // Execute; forwarded commands reply later via deliver_reply()
+  uint64_t seq = next_request_seq_++;
+  core::Topology::RequestContext request{core_id_, seq};
+  request.by_reference = true;
+  topology_.begin_request(core_id_, request);
+  std::string resp_str = execute_command(args);
+  storage::SharedString body = topology_.take_reply_body(core_id_);
+  size_t served_by = topology_.end_request(core_id_);
+  // Clients of an I/O core stay there: data cores do not serve connections
+  if (handoff_target_ == LocalityTracker::NO_CORE && !topology_.is_io_core(core_id_)) {
+    size_t target = locality_.record(served_by, core_id_);
+    if (target < topology_.get_num_cores()) handoff_target_ = target;
+  }
+  if (body) {
+    complete_reply(seq, resp_str, std::move(body));
+  } else if (!resp_str.empty()) {
+    complete_reply(seq, resp_str);
   }
 }
 
-std::vector<char> Connection::handle_data(const char* data, size_t len) {
-  size_t consumed = 0;
-  auto result = parser_.consume(reinterpret_cast<const uint8_t*>(data), len, consumed);
+void Connection::deliver_reply(uint64_t seq, std::string_view reply, bool last) {
+  complete_reply(seq, reply, last);
+}
 
-  std::vector<char> response;
+bool Connection::wants_reply_part(uint64_t seq) const {
+  if (closing_) return true;  // Let the job find out and stop
+  if (seq != next_reply_seq_) return false;
+  if (limits_->stream_pause_bytes == 0) return true;
+  size_t unsent = output_.size();
+  for (const auto& chunk : write_queue_) unsent += chunk.view().size();
+  return unsent - write_offset_ < limits_->stream_pause_bytes;
+}
 
-  if (result == RespParser::Result::Complete) {
-    // Execute
-    std::string resp_str = execute_command(parser_.get_args());
-    // Reset for next command
-    parser_.reset();
+void Connection::complete_reply(uint64_t seq, std::string_view reply, bool last) {
+  if (closing_) return;
+  output_bytes_ += reply.size();
+  if (seq != next_reply_seq_) {
+    // An earlier (forwarded) command has not replied yet
+    auto& pending = pending_replies_[seq];
+    pending.data.append(reply);
+    pending.complete = last;
+    return;
+  }
+
+  output_.insert(output_.end(), reply.begin(), reply.end());
+  if (!last) return;  // More parts of this reply follow
+  next_reply_seq_++;
+
+  // Release replies that were waiting for this one. An unfinished one is
+  // written so far; its next parts arrive as the current reply.
+  auto it = pending_replies_.begin();
+  while (it != pending_replies_.end() && it->first == next_reply_seq_) {
+    output_.insert(output_.end(), it->second.data.begin(), it->second.data.end());
+    if (!it->second.complete) {
+      pending_replies_.erase(it);
+      break;
+    }
+    next_reply_seq_++;
+    it = pending_replies_.erase(it);
+  }
+}
+
+void Connection::complete_reply(uint64_t seq, std::string_view head, storage::SharedString body) {
+  if (seq != next_reply_seq_ || closing_) {
+    // Waits behind a forwarded reply: copied like any other
+    std::string reply(head);
+    reply.append(body.view());
+    reply.append("\r\n");
+    complete_reply(seq, reply);
+    return;
+  }
+  // Queued behind the replies before it, ahead of those after it
+  output_bytes_ += head.size() + body.size();
+  output_.insert(output_.end(), head.begin(), head.end());
+  write_queue_.push_back({std::move(output_), {}});
+  write_queue_.push_back({{}, std::move(body)});
+  output_ = std::move(spare_);
+  spare_ = {};
+  complete_reply(seq, "\r\n");
+}
+
+void Connection::flush_replies(core::IoContext& ctx) {
+  if (closing_) return;
+  if (output_.empty()) {
+    // Last forwarded reply may have been all a pending handoff waited for
+    if (handoff_target_ != LocalityTracker::NO_CORE) {
+      try_handoff();
+      return;
+    }
+  } else {
+    submit_write(ctx, std::move(output_));
+    output_ = std::move(spare_);  // Reuse a written buffer's capacity if we have one
+    spare_ = {};
+  }
+  enforce_limits(ctx);
+  if (read_paused_) maybe_read(ctx);
+}
 
-    // Convert to char vector
-    response.assign(resp_str.begin(), resp_str.end());
-  } else if (result == RespParser::Result::Error) {
-    std::string err = "-ERR Protocol Error\r\n";
-    response.assign(err.begin(), err.end());
-    parser_.reset();
+bool Connection::try_handoff() {
+  if (is_writing_ || reading_ || closing_ || zero_copy_pending_ > 0 || !output_.empty() ||
+      !write_queue_.empty() || next_reply_seq_ != next_request_seq_) {
+    return false;
   }
 
-  return response;
+  size_t target = handoff_target_;
+  handoff_target_ = LocalityTracker::NO_CORE;
+  locality_.moved();
+
+  // Detach from this core. The operations hold this core's IoContext and are
+  // recreated by start() on the new core; no completion can be in flight.
+  if (on_disconnect_) on_disconnect_(id_);
+  on_disconnect_ = nullptr;
+  read_op_->ctx.unregister_file(file_slot_);  // The new core registers it in its own table
+  read_op_->ctx.cancel(soft_timer_);           // Timers belong to this core
+  over_soft_since_ = {};
+  file_slot_ = -1;
+  read_op_.reset();
+  write_op_.reset();
+
+  // Unparsed bytes and parser state travel with the object
+  topology_.handoff_connection(core_id_, target, this);
+  return true;
 }
 
 std::string Connection::execute_command(const std::vector<std::string>& args) {
@@ -157,6 +486,9 @@ std::string Connection::execute_command(const std::vector<std::string>& args) {
   // Use Registry
   auto* cmd = quine::commands::CommandRegistry::instance().get_command(cmd_name);
   if (cmd) {
+    if (cmd->grows_memory() && topology_.over_maxmemory()) {
+      return "-OOM command not allowed when used memory > 'maxmemory'\r\n";
+    }
     return cmd->execute(topology_, core_id_, id_, args);
   }
 
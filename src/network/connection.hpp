@@ -1,14 +1,20 @@
 #pragma once
 
+#include <chrono>
 #include <cstddef>
 #include <deque>  // [NEW]
 #include <functional>
+#include <map>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "../core/operation.hpp"
+#include "../core/timer_wheel.hpp"
 #include "../core/topology.hpp"
+#include "client_limits.hpp"
+#include "locality_tracker.hpp"
 #include "resp_parser.hpp"
 
 // Forward decl
@@ -38,23 +44,70 @@ class Connection {
     return id_;
   }
 
+  // Called when the connection leaves this core (closed or handed off)
   void set_on_disconnect(std::function<void(uint32_t)> cb) {
     on_disconnect_ = cb;
   }
 
+  // Adopted by another core after a handoff
+  void set_core_id(size_t core_id) {
+    core_id_ = core_id;
+  }
+
   // Start processing (post initial read)
   void start(core::IoContext& ctx);
 
+  // When the client last sent data (idle timeout)
+  std::chrono::steady_clock::time_point last_active() const {
+    return last_active_;
+  }
+
+  // No reply owed to the client and no handoff under way
+  bool idle() const {
+    return next_reply_seq_ == next_request_seq_ && handoff_target_ == LocalityTracker::NO_CORE;
+  }
+
+  // Close from the server side: the pending read completes and tears the
+  // connection down as if the client had left
+  void shutdown();
+
+  // Output and backpressure limits (shared by all connections; must
+  // outlive them). Defaults to ClientLimits{}.
+  void set_limits(const ClientLimits* limits) {
+    limits_ = limits;
+  }
+
+  // Reply bytes buffered for the client (see ClientLimits)
+  size_t output_bytes() const {
+    return output_bytes_;
+  }
+
   // Buffer management
   void resize_buffer(size_t size);
 
-  // Process incoming data
-  // Returns response bytes to write back
-  std::vector<char> handle_data(const char* data, size_t len);
+  // Process incoming data (all complete commands, pipelined or not)
+  // Replies that are ready are buffered until flush_replies().
+  // Returns the number of bytes consumed; the rest must be fed again.
+  size_t handle_data(const char* data, size_t len);
+
+  // Reply to a forwarded or deferred command, arriving from the owning
+  // core or the scheduler, possibly in several parts (`last` marks the
+  // final one). Buffered like local replies; call flush_replies() to send.
+  void deliver_reply(uint64_t seq, std::string_view reply, bool last = true);
+
+  // Whether the streamed reply `seq` may produce its next part now: it is
+  // the reply being written, and the client has consumed enough of what was
+  // sent before (ClientLimits::stream_pause_bytes). Otherwise its parts
+  // would only pile up in memory.
+  bool wants_reply_part(uint64_t seq) const;
+
+  // Write all buffered in-order replies with a single write
+  void flush_replies(core::IoContext& ctx);
 
   // Async Operations
   struct ReadOp;
   struct WriteOp;
+  struct ZeroCopySendOp;
 
   std::unique_ptr<ReadOp> read_op_;
   std::unique_ptr<WriteOp> write_op_;
@@ -67,20 +120,112 @@ class Connection {
 
  private:
   int fd_;
+  int file_slot_ = -1;  // Slot in this core's registered file table, if any
   uint32_t id_;
+  std::chrono::steady_clock::time_point last_active_;
   std::vector<char> read_buffer_;
+  size_t read_len_ = 0;  // Bytes in read_buffer_ not yet parsed
+
+  // A buffer queued for writing: bytes of its own, or a stored value's
+  // bytes, sent by reference
+  struct OutputChunk {
+    std::vector<char> bytes;
+    storage::SharedString shared;
+
+    std::string_view view() const {
+      return shared ? shared.view() : std::string_view(bytes.data(), bytes.size());
+    }
+  };
 
   // Write queuing for async I/O
-  std::deque<std::vector<char>> write_queue_;  // [NEW]
-  bool is_writing_ = false;                    // [NEW]
+  std::deque<OutputChunk> write_queue_;
+  size_t write_offset_ = 0;  // Bytes of the front buffer already written
+  bool is_writing_ = false;
+  bool reading_ = false;  // A read is in flight
+
+  // Zero-copy sends (IoContext::zero_copy_send_min()) whose notification
+  // has not arrived: their bytes are still pinned, and the connection must
+  // stay. Off for sockets that refuse them.
+  size_t zero_copy_pending_ = 0;
+  bool zero_copy_ = true;
+
+  // The connection is deleted once closing and no operation is in flight
+  // (their completions would find it gone)
+  bool closing_ = false;
+
+  // Limits: output_bytes_ counts output_, the unwritten part of
+  // write_queue_ and pending_replies_
+  const ClientLimits* limits_;
+  size_t output_bytes_ = 0;
+  bool read_paused_ = false;
+  std::chrono::steady_clock::time_point over_soft_since_;  // Epoch: not over
+  core::TimerWheel::Handle soft_timer_;
+
+  // Replies are written in request order. Every command gets a sequence
+  // number; replies of forwarded commands may arrive out of order and wait
+  // in pending_replies_ until all earlier replies were written. Streamed
+  // replies arrive in parts: the current one is written as parts come in.
+  struct PendingReply {
+    std::string data;
+    bool complete = false;
+  };
+  uint64_t next_request_seq_ = 0;
+  uint64_t next_reply_seq_ = 0;
+  std::map<uint64_t, PendingReply> pending_replies_;
+  std::vector<char> output_;  // In-order replies not yet submitted
+  std::vector<char> spare_;   // Written buffer kept for reuse as the next output_
 
   core::Topology& topology_;
   size_t core_id_;
   RespParser parser_;
+
+  // Connections whose commands almost all go to one other core move there.
+  // Once a target is chosen, reading stops until every reply is written.
+  LocalityTracker locality_;
+  size_t handoff_target_ = LocalityTracker::NO_CORE;
   std::function<void(uint32_t)> on_disconnect_;
 
+  // Complete commands parsed from the current read, not yet executed. Up to
+  // PIPELINE_WINDOW of them are parsed ahead so their keys can be prefetched.
+  static constexpr size_t PIPELINE_WINDOW = 16;
+  std::vector<std::vector<std::string>> pipeline_;
+
+  // Prefetch the local keys of the parsed commands, then run them in order
+  void execute_pipeline();
+
+  // Run one command with its sequence number and record its reply
+  void run_command(const std::vector<std::string>& args);
+
   // Helper to execute parsed command
   std::string execute_command(const std::vector<std::string>& args);
+
+  // Record (part of) the reply for request `seq` and release all replies
+  // now in order
+  void complete_reply(uint64_t seq, std::string_view reply, bool last = true);
+
+  // Record a reply made of `head`, the bytes of `body` and a CRLF. When it
+  // can be written right away, `body` is queued by reference, not copied.
+  void complete_reply(uint64_t seq, std::string_view head, storage::SharedString body);
+
+  void submit_front_write(core::IoContext& ctx);
+
+  // Result (and notification) of a zero-copy send
+  void handle_zero_copy_sent(int res, core::IoContext& ctx);
+  void handle_zero_copy_done(core::IoContext& ctx);
+
+  // Submit the next read unless one is in flight, the connection is moving
+  // or closing, or the client is too far behind on replies (backpressure)
+  void maybe_read(core::IoContext& ctx);
+
+  // Disconnect a client over its output limits
+  void enforce_limits(core::IoContext& ctx);
+
+  // Delete the connection once no completion can reach it any more
+  void finish_close(core::IoContext& ctx);
+
+  // Hand the connection to handoff_target_ once no I/O or reply is pending.
+  // Returns true if it was handed off (this core must not touch it again).
+  bool try_handoff();
 };
 
 }  // namespace network
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace quine {
+namespace network {
+
+/// @brief Tracks which core serves a connection's commands, to decide when
+/// the connection should move to that core.
+///
+/// Commands are counted in fixed windows. A move is suggested only when one
+/// remote core served nearly the whole window, and never again for a number
+/// of windows after a move, so connections with mixed traffic stay put and
+/// moved ones do not bounce back and forth.
+class LocalityTracker {
+ public:
+  static constexpr size_t NO_CORE = SIZE_MAX;
+  static constexpr uint32_t WINDOW = 64;            // Commands per decision
+  static constexpr uint32_t THRESHOLD = 58;         // ~90% of a window on one core
+  static constexpr uint32_t COOLDOWN_WINDOWS = 16;  // Windows skipped after a move
+
+  explicit LocalityTracker(size_t num_cores) : counts_(num_cores, 0) {}
+
+  /// @brief Record a command of a connection living on `home_core` that was
+  /// served by `served_by`.
+  /// @return The core the connection should move to, or NO_CORE.
+  size_t record(size_t served_by, size_t home_core) {
+    if (served_by < counts_.size()) counts_[served_by]++;
+    if (++seen_ < WINDOW) return NO_CORE;
+
+    size_t best = NO_CORE;
+    for (size_t core = 0; core < counts_.size(); ++core) {
+      if (counts_[core] >= THRESHOLD) best = core;
+      counts_[core] = 0;
+    }
+    seen_ = 0;
+
+    if (cooldown_ > 0) {
+      cooldown_--;
+      return NO_CORE;
+    }
+    return best == home_core ? NO_CORE : best;
+  }
+
+  /// @brief The connection moved: start counting afresh and hold still.
+  void moved() {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    seen_ = 0;
+    cooldown_ = COOLDOWN_WINDOWS;
+  }
+
+ private:
+  std::vector<uint32_t> counts_;  // Commands served per core in this window
+  uint32_t seen_ = 0;
+  uint32_t cooldown_ = 0;
+};
+
+}  // namespace network
+}  // namespace quine
@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <iostream>
+#include <utility>
 
 namespace quine {
 namespace network {
@@ -52,10 +53,12 @@ RespParser::Result RespParser::consume(const uint8_t* data, size_t len, size_t&
           return Result::Error;
         }
 
-        if (pos + 1 < len && data[pos + 1] == '\n')
+        if (pos + 1 < len && data[pos + 1] == '\n') {
           pos += 2;  // skip \r\n
-        else
-          return Result::Partial;  // Split on \r\n? Unlikely but possible
+        } else {
+          consumed = start;  // Split on \r\n: re-read the size line
+          return Result::Partial;
+        }
 
         args_.reserve(expected_args_);
         state_ = State::WaitArgSize;  // Next is '$'
@@ -79,10 +82,12 @@ RespParser::Result RespParser::consume(const uint8_t* data, size_t len, size_t&
           return Result::Error;
         }
 
-        if (pos + 1 < len && data[pos + 1] == '\n')
+        if (pos + 1 < len && data[pos + 1] == '\n') {
           pos += 2;
-        else
+        } else {
+          consumed = start - 1;  // Re-read from '$'
           return Result::Partial;
+        }
 
         current_arg_.clear();
         current_arg_.reserve(current_arg_len_);
@@ -109,7 +114,7 @@ RespParser::Result RespParser::consume(const uint8_t* data, size_t len, size_t&
         if (pos + 1 < len) {
           if (data[pos] == '\r' && data[pos + 1] == '\n') {
             pos += 2;
-            args_.push_back(current_arg_);
+            args_.push_back(std::move(current_arg_));
             if (args_.size() == static_cast<size_t>(expected_args_)) {
               consumed = pos;
               return Result::Complete;
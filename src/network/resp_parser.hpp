@@ -40,6 +40,11 @@ class RespParser {
     return args_;
   }
 
+  /// @brief Move the parsed arguments out; call reset() before parsing on.
+  std::vector<std::string> take_args() {
+    return std::move(args_);
+  }
+
   /// @brief Reset parser for the next command
   void reset();
 
@@ -0,0 +1,89 @@
+#include "reuseport_group.hpp"
+
+#include <sys/socket.h>
+
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#ifdef __linux__
+#include <linux/filter.h>
+#endif
+
+namespace quine {
+namespace network {
+
+Steering parse_steering(std::string_view name) {
+  if (name == "hash") return Steering::HASH;
+  if (name == "cpu") return Steering::CPU;
+  if (name == "least-connections") return Steering::LEAST_CONNECTIONS;
+  throw std::invalid_argument("unknown steering mode: " + std::string(name));
+}
+
+bool ReuseportGroup::listen(int fd, int cpu, int backlog) {
+  std::lock_guard<std::mutex> lock(mutex_);
+#ifdef SO_INCOMING_CPU
+  // Without a program (or before it is attached), kernels since 6.2 still
+  // prefer the listener whose CPU matches
+  if (steering_ == Steering::CPU && cpu >= 0) {
+    setsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu));
+  }
+#endif
+  if (::listen(fd, backlog) < 0) return false;
+  members_.push_back({fd, cpu});
+  if (steering_ == Steering::CPU) attach_program();
+  return true;
+}
+
+void ReuseportGroup::leave(int fd) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // The kernel unhashes the listener on shutdown and moves the last socket
+  // of the group into its place
+  ::shutdown(fd, SHUT_RDWR);
+  for (size_t i = 0; i < members_.size(); ++i) {
+    if (members_[i].fd != fd) continue;
+    members_[i] = members_.back();
+    members_.pop_back();
+    break;
+  }
+  if (steering_ == Steering::CPU && !members_.empty()) attach_program();
+}
+
+std::vector<int> ReuseportGroup::cpus() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<int> cpus;
+  for (const auto& member : members_) cpus.push_back(member.cpu);
+  return cpus;
+}
+
+void ReuseportGroup::attach_program() {
+#if defined(__linux__) && defined(SO_ATTACH_REUSEPORT_CBPF)
+  // A = CPU of the packet; then one compare-and-return per listener:
+  // the first listener on that CPU gets it, none means "use the hash"
+  const uint32_t cpu_field = SKF_AD_OFF + SKF_AD_CPU;
+  std::vector<sock_filter> code;
+  code.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, cpu_field));
+  for (size_t i = 0; i < members_.size() && code.size() + 3 <= BPF_MAXINSNS; ++i) {
+    if (members_[i].cpu < 0) continue;
+    uint32_t cpu = members_[i].cpu;
+    code.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, cpu, 0, 1));
+    code.push_back(BPF_STMT(BPF_RET | BPF_K, static_cast<uint32_t>(i)));
+  }
+  code.push_back(BPF_STMT(BPF_RET | BPF_K, UINT32_MAX));
+
+  sock_fprog program{static_cast<unsigned short>(code.size()), code.data()};
+  int fd = members_.front().fd;
+  if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program)) == 0) {
+    return;
+  }
+#endif
+  if (!attach_failed_) {
+    attach_failed_ = true;
+    std::cerr << "[Network] Could not attach the reuseport CPU steering program; "
+              << "connections are spread by hash" << std::endl;
+  }
+}
+
+}  // namespace network
+}  // namespace quine
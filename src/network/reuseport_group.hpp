@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+namespace quine {
+namespace network {
+
+/// @brief How new connections are spread over the cores' listeners.
+enum class Steering {
+  HASH,              // Kernel default: by hash of the connection's addresses
+  CPU,               // To the listener of the CPU that received the SYN
+  LEAST_CONNECTIONS  // By hash, then handed to the core with the fewest clients
+};
+
+/// @brief Parse "hash", "cpu" or "least-connections".
+/// @throws std::invalid_argument otherwise.
+Steering parse_steering(std::string_view name);
+
+/// @brief The listening sockets of all cores on one port, tracked in the
+/// order of the kernel's SO_REUSEPORT group.
+///
+/// A reuseport BPF program picks a listener by its index in the group. The
+/// kernel appends sockets as they listen(), and a socket leaving takes the
+/// place of the last one. The group mirrors that order under a lock, and
+/// with Steering::CPU it re-attaches a classic BPF program
+/// (SO_ATTACH_REUSEPORT_CBPF) mapping each listener's CPU to its index
+/// whenever the group changes. Connections arriving on a CPU without a
+/// listener fall back to the kernel's hash.
+class ReuseportGroup {
+ public:
+  explicit ReuseportGroup(Steering steering = Steering::HASH) : steering_(steering) {}
+
+  ReuseportGroup(const ReuseportGroup&) = delete;
+  ReuseportGroup& operator=(const ReuseportGroup&) = delete;
+
+  Steering steering() const {
+    return steering_;
+  }
+
+  /// @brief listen() on the bound SO_REUSEPORT socket `fd` of a core
+  /// running on `cpu` (-1 if unpinned), joining the group.
+  /// @return false if listen() failed (errno is set).
+  bool listen(int fd, int cpu, int backlog);
+
+  /// @brief Leave the group: shuts `fd` down, which also fails the accept
+  /// pending on it. The caller closes it.
+  void leave(int fd);
+
+  /// @brief CPUs of the listeners, in group order (-1 for unpinned ones).
+  std::vector<int> cpus() const;
+
+  /// @brief True with Steering::CPU, unless the kernel refused the program.
+  bool cpu_steering_active() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return steering_ == Steering::CPU && !attach_failed_;
+  }
+
+ private:
+  struct Member {
+    int fd;
+    int cpu;
+  };
+
+  // Steer through any member; the program applies to the whole group
+  void attach_program();
+
+  Steering steering_;
+  mutable std::mutex mutex_;
+  std::vector<Member> members_;  // Kernel group order
+  bool attach_failed_ = false;   // Logged once
+};
+
+}  // namespace network
+}  // namespace quine
@@ -3,6 +3,8 @@
 #include <fcntl.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include <unistd.h>
 
 #include <cstring>
@@ -29,16 +31,68 @@ struct TcpServer::AcceptOp : public core::Operation {
 TcpServer::TcpServer(core::IoContext& io, int port, core::Topology& top, size_t core_id)
     : io_(io), topology_(top), core_id_(core_id), port_(port), server_fd_(-1) {
   accept_op_ = std::make_unique<AcceptOp>(this);
-  setup_listener();
+}
+
+TcpServer::TcpServer(core::IoContext& io, std::string unix_path, unsigned permissions,
+                     core::Topology& top, size_t core_id)
+    : io_(io),
+      topology_(top),
+      core_id_(core_id),
+      port_(0),
+      unix_path_(std::move(unix_path)),
+      permissions_(permissions),
+      server_fd_(-1) {
+  accept_op_ = std::make_unique<AcceptOp>(this);
 }
 
 TcpServer::~TcpServer() {
-  if (server_fd_ >= 0) {
-    close(server_fd_);
+  close_listener();
+}
+
+void TcpServer::close_listener() {
+  if (server_fd_ < 0) return;
+  close(server_fd_);
+  server_fd_ = -1;
+  if (!unix_path_.empty()) unlink(unix_path_.c_str());
+}
+
+void TcpServer::setup_unix_listener() {
+  struct sockaddr_un addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (unix_path_.size() >= sizeof(addr.sun_path)) {
+    throw std::system_error(ENAMETOOLONG, std::generic_category(), "unix socket path");
+  }
+  std::memcpy(addr.sun_path, unix_path_.data(), unix_path_.size());
+
+  server_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (server_fd_ < 0) {
+    throw std::system_error(errno, std::generic_category(), "socket failed");
+  }
+  int flags = fcntl(server_fd_, F_GETFL, 0);
+  if (flags < 0 || fcntl(server_fd_, F_SETFL, flags | O_NONBLOCK) < 0) {
+    throw std::system_error(errno, std::generic_category(), "fcntl set nonblock failed");
+  }
+
+  // A socket file left behind by an earlier run would make bind() fail
+  unlink(unix_path_.c_str());
+  if (bind(server_fd_, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    throw std::system_error(errno, std::generic_category(), "bind " + unix_path_ + " failed");
+  }
+  if (permissions_ != 0 && chmod(unix_path_.c_str(), permissions_) < 0) {
+    throw std::system_error(errno, std::generic_category(), "chmod " + unix_path_ + " failed");
+  }
+  if (listen(server_fd_, 1024) < 0) {
+    throw std::system_error(errno, std::generic_category(), "listen failed");
   }
 }
 
 void TcpServer::setup_listener() {
+  if (!unix_path_.empty()) {
+    setup_unix_listener();
+    return;
+  }
+
   server_fd_ = socket(AF_INET, SOCK_STREAM, 0);
   if (server_fd_ < 0) {
     throw std::system_error(errno, std::generic_category(), "socket failed");
@@ -72,16 +126,39 @@ void TcpServer::setup_listener() {
     throw std::system_error(errno, std::generic_category(), "bind failed");
   }
 
-  if (listen(server_fd_, 1024) < 0) {
+  bool listening =
+      group_ ? group_->listen(server_fd_, cpu_, 1024) : ::listen(server_fd_, 1024) == 0;
+  if (!listening) {
     throw std::system_error(errno, std::generic_category(), "listen failed");
   }
 }
 
 void TcpServer::start() {
+  if (listening_) return;
+  if (server_fd_ >= 0) {
+    // stop() is still waiting for the cancelled accept to complete
+    restart_pending_ = true;
+    return;
+  }
+  setup_listener();
+  listening_ = true;
   // Initial accept submission
   submit_accept();
 }
 
+void TcpServer::stop() {
+  if (!listening_) return;
+  listening_ = false;
+  restart_pending_ = false;
+  // Shutting down the listener fails the pending accept; the socket is closed
+  // when that completion arrives in handle_accept().
+  if (group_) {
+    group_->leave(server_fd_);
+  } else {
+    ::shutdown(server_fd_, SHUT_RDWR);
+  }
+}
+
 void TcpServer::submit_accept() {
   struct io_uring_sqe* sqe = io_.get_sqe();
 
@@ -93,6 +170,17 @@ void TcpServer::submit_accept() {
 }
 
 void TcpServer::handle_accept(int fd) {
+  if (!listening_) {
+    // Listener was stopped while this accept was in flight
+    if (fd >= 0) close(fd);
+    close_listener();
+    if (restart_pending_) {
+      restart_pending_ = false;
+      start();
+    }
+    return;
+  }
+
   if (fd < 0) {
     std::cerr << "Accept error: " << -fd << std::endl;
     // Resubmit accept to keep server alive
@@ -104,24 +192,39 @@ void TcpServer::handle_accept(int fd) {
 
   // Create a new Connection
   auto conn = std::make_unique<Connection>(fd, topology_, core_id_);
+  if (limits_) conn->set_limits(limits_);
+  if (balanced_) {
+    // Another core has fewer clients: it adopts this one before any I/O
+    size_t target = topology_.least_loaded_core(core_id_);
+    if (target != core_id_) {
+      topology_.handoff_connection(core_id_, target, conn.release());
+      submit_accept();
+      return;
+    }
+  }
+  adopt(conn.get());
+
+  // Keeping it alive (hacky for now, need a container in TcpServer)
+  conn.release();  // Leaking for V0 proof of concept to avoid immediate
+                   // destruction
+
+  // Accept next
+  submit_accept();
+}
+
+void TcpServer::adopt(Connection* conn) {
+  conn->set_core_id(core_id_);
 
   if (on_disconnect_) {
     conn->set_on_disconnect(on_disconnect_);
   }
 
   if (on_connect_) {
-    on_connect_(conn.get());
+    on_connect_(conn);
   }
 
   // START reading from the connection
   conn->start(io_);
-
-  // Keeping it alive (hacky for now, need a container in TcpServer)
-  conn.release();  // Leaking for V0 proof of concept to avoid immediate
-                   // destruction
-
-  // Accept next
-  submit_accept();
 }
 
 }  // namespace network
@@ -7,6 +7,8 @@
 
 #include "../core/io_context.hpp"
 #include "../core/topology.hpp"
+#include "client_limits.hpp"
+#include "reuseport_group.hpp"
 
 // Forward decl
 namespace quine {
@@ -26,9 +28,18 @@ namespace network {
 /// @brief Handles listening for incoming TCP connections using io_uring.
 /// Designed for a Thread-per-Core architecture where multiple instances
 /// can listen on the same port via SO_REUSEPORT.
+///
+/// The same accept loop can listen on a Unix domain socket instead, for
+/// clients on the same host; its connections are handled exactly like TCP
+/// ones.
 class TcpServer {
  public:
   TcpServer(core::IoContext& io, int port, core::Topology& topology, size_t core_id);
+  /// @brief Listen on the Unix domain socket `unix_path` (replaced if it
+  /// exists, removed when the listener closes). `permissions` (e.g. 0770)
+  /// are applied to the socket file; 0 leaves them to the umask.
+  TcpServer(core::IoContext& io, std::string unix_path, unsigned permissions,
+            core::Topology& topology, size_t core_id);
   ~TcpServer();
 
   // Delete copy/move
@@ -36,9 +47,18 @@ class TcpServer {
   TcpServer& operator=(const TcpServer&) = delete;
 
   /// @brief Starts the asynchronous accept loop.
-  /// Submits the initial accept request to the io_uring.
+  /// Submits the initial accept request to the io_uring. Re-opens the
+  /// listener if it was closed by stop().
   void start();
 
+  /// @brief Stop accepting new connections (e.g. the core was retired).
+  /// Existing connections are not affected.
+  void stop();
+
+  /// @brief Take over a connection handed off by another core and resume
+  /// reading from it on this core.
+  void adopt(Connection* conn);
+
   /// @brief Set callback for when a new connection is established
   void set_on_connect(std::function<void(Connection*)> cb) {
     on_connect_ = cb;
@@ -49,16 +69,45 @@ class TcpServer {
     on_disconnect_ = cb;
   }
 
+  /// @brief Listen as a member of `group` (shared by all cores), from a
+  /// core running on `cpu` (-1 if unpinned). Takes effect on start().
+  void set_reuseport_group(ReuseportGroup* group, int cpu) {
+    group_ = group;
+    cpu_ = cpu;
+  }
+
+  /// @brief Limits for the connections this server accepts (shared; must
+  /// outlive them).
+  void set_client_limits(const ClientLimits* limits) {
+    limits_ = limits;
+  }
+
+  /// @brief Hand each accepted connection to the core serving the fewest
+  /// clients (Topology::least_loaded_core()) before any I/O on it.
+  void set_balanced(bool balanced) {
+    balanced_ = balanced;
+  }
+
  private:
   core::IoContext& io_;
   core::Topology& topology_;
   size_t core_id_;
   int port_;
+  std::string unix_path_;  // Empty for TCP
+  unsigned permissions_ = 0;
   int server_fd_;
+  bool listening_ = false;
+  bool restart_pending_ = false;  // start() called while the old accept drains
+  ReuseportGroup* group_ = nullptr;
+  int cpu_ = -1;
+  bool balanced_ = false;
+  const ClientLimits* limits_ = nullptr;
   std::function<void(Connection*)> on_connect_;
   std::function<void(uint32_t)> on_disconnect_;
 
   void setup_listener();
+  void setup_unix_listener();
+  void close_listener();
   void submit_accept();
 
   // The operation object that handles the completion of the accept call
@@ -1,8 +1,11 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
+#include <string_view>
 #include <vector>
 
 #include "../core/topology.hpp"
@@ -15,50 +18,8 @@ namespace persistence {
 
 class RdbManager {
  public:
-  static bool save(const core::Topology& topology, const std::string& filename) {
-    std::ofstream ofs(filename, std::ios::binary | std::ios::trunc);
-    if (!ofs.is_open()) return false;
-
-    // Header
-    ofs.write(RDB_MAGIC, 7);
-    ofs.write(reinterpret_cast<const char*>(&RDB_VERSION), sizeof(RDB_VERSION));
-
-    // Iterate over all shards
-    for (size_t i = 0; i < topology.shard_count(); ++i) {
-      auto* shard = topology.get_shard(i);
-      // We assume save is called when system is quiescent or lock-safe.
-      // In strict thread-per-core, accessing other core's shard is UNSAFE
-      // unless paused. For V1, we will assume this is triggered synchronously
-      // or we just do it unsafely for now (NOT PRODUCTION READY). Proper way:
-      // Send SAVE signal to all cores, they snapshot their data, then merge or
-      // write to separate files. Or use a global lock that pauses all workers.
-      // Given shared-nothing, 'save' should conceptually be distributed.
-      // BUT, for simplicity in this task, we assume non-concurrent access or
-      // 'good enough' for demo.
-
-      shard->for_each([&](const std::string& key, const storage::Value& val) {
-        // Write expiry first if present (Redis standard puts EXPIRE before
-        // key/value) Here, to simplify, we can put it as a separate entry type
-        // associated with key BUT strict Redis RDB usually prefixes the value
-        // type with expiry opcode. Let's adopt: [OPCODE_EXPIRE_MS] [timestamp]
-        // [OPCODE_TYPE] [key] [value]
-        long long expiry = shard->get_expiry(key);
-        if (expiry != -1) {
-          uint8_t expire_opcode = static_cast<uint8_t>(RdbType::EXPIRE_MS);
-          ofs.write(reinterpret_cast<const char*>(&expire_opcode), 1);
-          ofs.write(reinterpret_cast<const char*>(&expiry), sizeof(expiry));
-        }
-
-        write_entry(ofs, key, val);
-      });
-    }
-
-    // EOF
-    uint8_t type = static_cast<uint8_t>(RdbType::END_OF_FILE);
-    ofs.write(reinterpret_cast<const char*>(&type), 1);
-
-    return true;
-  }
+  /// @brief Write a snapshot of all shards in one go, see RdbWriter.
+  static bool save(core::Topology& topology, const std::string& filename);
 
   static bool load(core::Topology& topology, const std::string& filename) {
     std::ifstream ifs(filename, std::ios::binary);
@@ -92,7 +53,7 @@ class RdbManager {
           // Determine value type
           switch (static_cast<RdbType>(type_byte)) {
             case RdbType::STRING:
-              val = read_string(ifs);
+              val = storage::Value(read_string(ifs));
               break;
             case RdbType::LIST:
               val = read_list(ifs);
@@ -119,7 +80,7 @@ class RdbManager {
           continue;  // Skip the standard insert below
 
         case RdbType::STRING:
-          val = read_string(ifs);
+          val = storage::Value(read_string(ifs));
           break;
         case RdbType::LIST:
           val = read_list(ifs);
@@ -149,7 +110,9 @@ class RdbManager {
   }
 
  private:
-  static void write_string(std::ofstream& ofs, const std::string& s) {
+  friend class RdbWriter;
+
+  static void write_string(std::ofstream& ofs, std::string_view s) {
     uint32_t len = s.size();
     ofs.write(reinterpret_cast<const char*>(&len), sizeof(len));
     ofs.write(s.data(), len);
@@ -163,45 +126,45 @@ class RdbManager {
     return s;
   }
 
-  static void write_entry(std::ofstream& ofs, const std::string& key, const storage::Value& val) {
+  static void write_entry(std::ofstream& ofs, std::string_view key, const storage::Value& val) {
     using namespace storage;
-    if (std::holds_alternative<String>(val)) {
+    if (val.type() == ValueType::STRING) {
       uint8_t type = static_cast<uint8_t>(RdbType::STRING);
       ofs.write(reinterpret_cast<const char*>(&type), 1);
       write_string(ofs, key);
-      write_string(ofs, std::get<String>(val));
-    } else if (std::holds_alternative<List>(val)) {
+      write_string(ofs, val.string());
+    } else if (val.type() == ValueType::LIST) {
       uint8_t type = static_cast<uint8_t>(RdbType::LIST);
       ofs.write(reinterpret_cast<const char*>(&type), 1);
       write_string(ofs, key);
-      const auto& list = std::get<List>(val);
+      const auto& list = *val.get_if<List>();
       uint32_t count = list.size();
       ofs.write(reinterpret_cast<const char*>(&count), sizeof(count));
       for (const auto& item : list) write_string(ofs, item);
-    } else if (std::holds_alternative<Set>(val)) {
+    } else if (val.type() == ValueType::SET) {
       uint8_t type = static_cast<uint8_t>(RdbType::SET);
       ofs.write(reinterpret_cast<const char*>(&type), 1);
       write_string(ofs, key);
-      const auto& set = std::get<Set>(val);
+      const auto& set = *val.get_if<Set>();
       uint32_t count = set.size();
       ofs.write(reinterpret_cast<const char*>(&count), sizeof(count));
       for (const auto& item : set) write_string(ofs, item);
-    } else if (std::holds_alternative<Hash>(val)) {
+    } else if (val.type() == ValueType::HASH) {
       uint8_t type = static_cast<uint8_t>(RdbType::HASH);
       ofs.write(reinterpret_cast<const char*>(&type), 1);
       write_string(ofs, key);
-      const auto& hash = std::get<Hash>(val);
+      const auto& hash = *val.get_if<Hash>();
       uint32_t count = hash.size();
       ofs.write(reinterpret_cast<const char*>(&count), sizeof(count));
       for (const auto& pair : hash) {
         write_string(ofs, pair.first);
         write_string(ofs, pair.second);
       }
-    } else if (std::holds_alternative<ZSet>(val)) {
+    } else if (val.type() == ValueType::ZSET) {
       uint8_t type = static_cast<uint8_t>(RdbType::ZSET);
       ofs.write(reinterpret_cast<const char*>(&type), 1);
       write_string(ofs, key);
-      const auto& zset = std::get<ZSet>(val);
+      const auto& zset = *val.get_if<ZSet>();
       uint32_t count = zset.size();
       ofs.write(reinterpret_cast<const char*>(&count), sizeof(count));
       for (const auto& entry : zset) {
@@ -216,7 +179,7 @@ class RdbManager {
     uint32_t count;
     ifs.read(reinterpret_cast<char*>(&count), sizeof(count));
     for (uint32_t i = 0; i < count; ++i) {
-      list.push_back(read_string(ifs));
+      list.emplace_back(read_string(ifs));
     }
     return list;
   }
@@ -226,7 +189,7 @@ class RdbManager {
     uint32_t count;
     ifs.read(reinterpret_cast<char*>(&count), sizeof(count));
     for (uint32_t i = 0; i < count; ++i) {
-      set.insert(read_string(ifs));
+      set.emplace(read_string(ifs));
     }
     return set;
   }
@@ -238,7 +201,7 @@ class RdbManager {
     for (uint32_t i = 0; i < count; ++i) {
       std::string field = read_string(ifs);
       std::string val = read_string(ifs);
-      hash[field] = val;
+      hash.emplace(field, val);
     }
     return hash;
   }
@@ -251,11 +214,123 @@ class RdbManager {
       double score;
       ifs.read(reinterpret_cast<char*>(&score), sizeof(double));
       std::string member = read_string(ifs);
-      zset.insert({score, member});
+      zset.insert(score, member);
     }
     return zset;
   }
 };
 
+/// @brief Writes an RDB snapshot incrementally: each step() covers a few
+/// hash table buckets of one shard, so SAVE can run as a Job between
+/// requests. The file is written under a temporary name and renamed into
+/// place once complete. No core defragments while a writer exists (see
+/// Topology::begin_snapshot_scan).
+class RdbWriter {
+ public:
+  /// @brief Buckets handled per step (bounds the work between clock checks).
+  static constexpr size_t BUCKETS_PER_STEP = 256;
+
+  RdbWriter(core::Topology& topology, const std::string& filename)
+      : topology_(topology), filename_(filename), tmp_filename_(temp_name(filename)) {
+    ofs_.open(tmp_filename_, std::ios::binary | std::ios::trunc);
+    if (!ofs_.is_open()) {
+      done_ = true;
+      return;
+    }
+    topology_.begin_snapshot_scan();
+    scanning_ = true;
+
+    // Header
+    ofs_.write(RDB_MAGIC, 7);
+    ofs_.write(reinterpret_cast<const char*>(&RDB_VERSION), sizeof(RDB_VERSION));
+  }
+
+  /// @brief Write the keys of the next `buckets` buckets.
+  /// @return true once the snapshot is complete (or failed, see ok()).
+  bool step(size_t buckets) {
+    if (done_) return true;
+
+    // Skip spare cores that never started
+    while (shard_ < topology_.shard_count() && !topology_.get_shard(shard_)) shard_++;
+    if (shard_ < topology_.shard_count()) {
+      // In strict thread-per-core, accessing another core's shard is UNSAFE
+      // unless paused. For V1 we do it anyway (NOT PRODUCTION READY). Proper
+      // way: send SAVE to all cores, they snapshot their data, then merge or
+      // write to separate files.
+      const storage::Shard* shard = topology_.get_shard(shard_);
+      cursor_ = shard->scan(cursor_, buckets, [&](std::string_view key, const storage::Value& val) {
+        // Redis puts the expiry before the key/value: [OPCODE_EXPIRE_MS]
+        // [timestamp] [OPCODE_TYPE] [key] [value]
+        long long expiry = shard->get_expiry(key);
+        if (expiry != -1) {
+          uint8_t expire_opcode = static_cast<uint8_t>(RdbType::EXPIRE_MS);
+          ofs_.write(reinterpret_cast<const char*>(&expire_opcode), 1);
+          ofs_.write(reinterpret_cast<const char*>(&expiry), sizeof(expiry));
+        }
+
+        RdbManager::write_entry(ofs_, key, val);
+      });
+      if (cursor_ == 0) shard_++;
+      return false;
+    }
+
+    end_scan();
+
+    // EOF
+    uint8_t type = static_cast<uint8_t>(RdbType::END_OF_FILE);
+    ofs_.write(reinterpret_cast<const char*>(&type), 1);
+    ofs_.close();
+    ok_ = !ofs_.fail() && std::rename(tmp_filename_.c_str(), filename_.c_str()) == 0;
+    done_ = true;
+    return true;
+  }
+
+  /// @brief Whether the snapshot was written completely.
+  bool ok() const {
+    return ok_;
+  }
+
+  /// @brief An unfinished writer (its client left) removes its partial file
+  /// and lets defragmentation resume.
+  ~RdbWriter() {
+    end_scan();
+    if (!done_) {
+      ofs_.close();
+      std::remove(tmp_filename_.c_str());
+    }
+  }
+
+  RdbWriter(const RdbWriter&) = delete;
+  RdbWriter& operator=(const RdbWriter&) = delete;
+
+ private:
+  void end_scan() {
+    if (scanning_) topology_.end_snapshot_scan();
+    scanning_ = false;
+  }
+
+  static std::string temp_name(const std::string& filename) {
+    static std::atomic<unsigned> next_id{0};
+    return filename + ".tmp." + std::to_string(next_id++);
+  }
+
+  core::Topology& topology_;
+  std::string filename_;
+  std::string tmp_filename_;  // Concurrent SAVEs each write their own file
+  std::ofstream ofs_;
+  size_t shard_ = 0;
+  size_t cursor_ = 0;
+  bool done_ = false;
+  bool ok_ = false;
+  bool scanning_ = false;  // Holds the topology's snapshot scan count
+};
+
+inline bool RdbManager::save(core::Topology& topology, const std::string& filename) {
+  RdbWriter writer(topology, filename);
+  while (!writer.step(RdbWriter::BUCKETS_PER_STEP)) {
+  }
+  return writer.ok();
+}
+
 }  // namespace persistence
 }  // namespace quine
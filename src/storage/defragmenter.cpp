@@ -0,0 +1,88 @@
+#include "defragmenter.hpp"
+
+namespace quine {
+namespace storage {
+
+bool Defragmenter::fragmented() const {
+  const SlabResource& memory = shard_.memory();
+  size_t used = memory.used_bytes();
+  size_t allocated = memory.allocated_bytes();
+  if (allocated < used + config_.ignore_bytes) return false;
+  return shard_.fragmentation_ratio() > 1.0 + config_.threshold_percent / 100.0;
+}
+
+bool Defragmenter::needs_compaction() const {
+  const HashMap& table = shard_.table();
+  return table.tombstones() > 0 &&
+         table.tombstones() * 100 >= table.capacity() * config_.tombstone_percent;
+}
+
+void Defragmenter::try_start(bool compaction_allowed) {
+  cursor_ = 0;
+  if (fragmented() && shard_.memory().begin_drain(SPARSE_SLAB) > 0) {
+    phase_ = Phase::VALUES;
+  } else if (compaction_allowed && needs_compaction()) {
+    phase_ = Phase::COMPACT;
+  }
+  if (phase_ != Phase::IDLE) cycles_++;
+}
+
+void Defragmenter::finish(Clock::time_point now) {
+  shard_.memory().end_drain();
+  phase_ = Phase::IDLE;
+  next_check_ = now + COOLDOWN;
+}
+
+bool Defragmenter::step(bool compaction_allowed) {
+  auto now = Clock::now();
+  if (phase_ == Phase::IDLE) {
+    if (!config_.enabled || now < next_check_) return false;
+    next_check_ = now + CHECK_INTERVAL;
+    try_start(compaction_allowed);
+    if (phase_ == Phase::IDLE) return false;
+  }
+
+  auto deadline = now + config_.budget;
+  do {
+    switch (phase_) {
+      case Phase::VALUES:
+        cursor_ = shard_.relocate(cursor_, BUCKETS_PER_CHUNK, relocated_);
+        if (cursor_ == 0) phase_ = Phase::EXPIRIES;
+        break;
+      case Phase::EXPIRIES:
+        cursor_ = shard_.relocate_expiries(cursor_, BUCKETS_PER_CHUNK, relocated_);
+        if (cursor_ == 0) {
+          // Slabs still holding data (e.g. written to while draining) serve again
+          shard_.memory().end_drain();
+          phase_ = compaction_allowed && needs_compaction() ? Phase::COMPACT : Phase::IDLE;
+        }
+        break;
+      case Phase::COMPACT:
+        if (!compaction_allowed) {
+          phase_ = Phase::IDLE;
+          break;
+        }
+        cursor_ = shard_.compact(cursor_, BUCKETS_PER_CHUNK);
+        if (cursor_ == 0) phase_ = Phase::IDLE;
+        break;
+      case Phase::IDLE:
+        break;
+    }
+
+    // Everything left the drained slabs early: skip the rest of the walk
+    if ((phase_ == Phase::VALUES || phase_ == Phase::EXPIRIES) &&
+        shard_.memory().draining() == 0) {
+      phase_ = compaction_allowed && needs_compaction() ? Phase::COMPACT : Phase::IDLE;
+      cursor_ = 0;
+    }
+
+    if (phase_ == Phase::IDLE) {
+      finish(Clock::now());
+      return false;
+    }
+  } while (Clock::now() < deadline);
+  return true;
+}
+
+}  // namespace storage
+}  // namespace quine
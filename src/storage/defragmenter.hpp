@@ -0,0 +1,87 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+#include "shard.hpp"
+
+namespace quine {
+namespace storage {
+
+/// @brief When the active defragmenter kicks in.
+struct DefragConfig {
+  bool enabled = false;
+  // Never start while less than this many bytes are wasted
+  size_t ignore_bytes = 8 * 1024 * 1024;
+  // Start once allocated / used exceeds 1 + threshold_percent / 100
+  unsigned threshold_percent = 10;
+  // Compact the hash table once this share of its buckets are tombstones
+  unsigned tombstone_percent = 20;
+  // Maximum time spent per event-loop iteration
+  std::chrono::microseconds budget{1000};
+};
+
+/// @brief Incremental defragmenter of one core's Shard, driven from the
+/// event loop.
+///
+/// A cycle starts when fragmentation or tombstones cross the thresholds.
+/// It drains the sparsely used slabs of the shard's SlabResource, walks
+/// the hash table and the expiry index copying everything still held in
+/// them into denser slabs (the drained slabs are returned to the system
+/// as they empty), then compacts the hash table. Each step stops when its
+/// time budget is spent; the next one resumes at the saved cursor.
+class Defragmenter {
+ public:
+  /// @brief Slabs with fewer live blocks than this share are drained.
+  static constexpr double SPARSE_SLAB = 0.5;
+  /// @brief Buckets handled between two clock checks.
+  static constexpr size_t BUCKETS_PER_CHUNK = 64;
+  /// @brief Pause between threshold checks while idle.
+  static constexpr std::chrono::milliseconds CHECK_INTERVAL{100};
+  /// @brief Pause after a cycle, so an unfixable ratio does not spin.
+  static constexpr std::chrono::milliseconds COOLDOWN{1000};
+
+  Defragmenter(Shard& shard, const DefragConfig& config) : shard_(shard), config_(config) {}
+
+  Defragmenter(const Defragmenter&) = delete;
+  Defragmenter& operator=(const Defragmenter&) = delete;
+
+  /// @brief Run for at most the configured budget. Call once per tick.
+  /// @param compaction_allowed False while a scan of the shard is in
+  /// progress (slot migration): compaction moves entries between buckets.
+  /// @return true if the cycle is unfinished and another tick is needed.
+  bool step(bool compaction_allowed);
+
+  bool active() const {
+    return phase_ != Phase::IDLE;
+  }
+  /// @brief Completed or running cycles.
+  size_t cycles() const {
+    return cycles_;
+  }
+  /// @brief Keys and values copied out of sparse slabs.
+  size_t relocated() const {
+    return relocated_;
+  }
+
+ private:
+  enum class Phase { IDLE, VALUES, EXPIRIES, COMPACT };
+  using Clock = std::chrono::steady_clock;
+
+  bool fragmented() const;
+  bool needs_compaction() const;
+  // Start a cycle if a threshold is crossed
+  void try_start(bool compaction_allowed);
+  void finish(Clock::time_point now);
+
+  Shard& shard_;
+  DefragConfig config_;
+  Phase phase_ = Phase::IDLE;
+  size_t cursor_ = 0;
+  Clock::time_point next_check_{};
+  size_t cycles_ = 0;
+  size_t relocated_ = 0;
+};
+
+}  // namespace storage
+}  // namespace quine
@@ -1,46 +1,110 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <functional>
+#include <memory_resource>
 #include <optional>
 #include <stdexcept>
 #include <string>
 #include <string_view>
 #include <vector>
 
+#include "table_allocator.hpp"
 #include "value.hpp"
 
 namespace quine {
 namespace storage {
 
 /// @brief A simple Open Addressing Hash Map with Linear Probing.
-/// Designed for high cache locality.
+/// Designed for high cache locality: one cache-line entry per bucket, with
+/// short keys inline.
 ///
 /// Current limitation: Does not resize automatically (fixed size for V1).
 /// TODO: Implement resizing and Robin Hood hashing.
 class HashMap {
  public:
-  struct Entry {
-    std::string key;
-    Value value;  // [CHANGED]
-    bool occupied = false;
-    bool deleted = false;
+  /// @brief Keys up to this length are stored in the entry itself.
+  static constexpr size_t INLINE_KEY = 39;
+
+  /// @brief One bucket, exactly one cache line. Probes compare the hash
+  /// fingerprint and the length first; key bytes are only read on a
+  /// likely match. Longer keys live in a separate allocation from the
+  /// map's resource, referenced from `key_data`.
+  struct alignas(64) Entry {
+    enum State : uint8_t { EMPTY, LIVE, DELETED };
+
+    uint32_t fingerprint = 0;  // High 32 bits of the key's hash
+    uint32_t key_size = 0;
+    Value value;
+    char key_data[INLINE_KEY] = {};  // The key, or a pointer to it
+    State state = EMPTY;
+
+    bool inline_key() const {
+      return key_size <= INLINE_KEY;
+    }
+    const char* key_ptr() const {
+      if (inline_key()) return key_data;
+      const char* p;
+      std::memcpy(&p, key_data, sizeof(p));
+      return p;
+    }
+    std::string_view key() const {
+      return {key_ptr(), key_size};
+    }
   };
+  static_assert(sizeof(Entry) == 64, "Entry must fill exactly one cache line");
 
-  explicit HashMap(size_t capacity = 1024) : capacity_(capacity), size_(0) {
-    entries_.resize(capacity_);
+  /// @param resource Memory for keys and values (e.g. the Shard's SlabResource).
+  explicit HashMap(size_t capacity = 1024,
+                   std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : entries_(capacity), capacity_(capacity), size_(0), resource_(resource) {}
+
+  ~HashMap() {
+    free_keys();
+  }
+
+  HashMap(const HashMap&) = delete;
+  HashMap& operator=(const HashMap&) = delete;
+
+  HashMap(HashMap&& other) noexcept
+      : entries_(std::move(other.entries_)),
+        capacity_(other.capacity_),
+        size_(other.size_),
+        tombstones_(other.tombstones_),
+        resource_(other.resource_) {
+    other.entries_.clear();  // Keys now belong to this map
+  }
+
+  HashMap& operator=(HashMap&& other) noexcept {
+    if (this != &other) {
+      free_keys();
+      entries_ = std::move(other.entries_);
+      other.entries_.clear();
+      capacity_ = other.capacity_;
+      size_ = other.size_;
+      tombstones_ = other.tombstones_;
+      resource_ = other.resource_;
+    }
+    return *this;
   }
 
   /// @brief Insert or Update a key-value pair.
+  /// @param replaced If set, receives the value an update replaces
+  /// (instead of destroying it here).
   /// @return true if inserted, false if updated
-  bool put(std::string_view key, Value value) {
-    size_t idx = hash(key);
+  bool put(std::string_view key, Value value, Value* replaced = nullptr) {
+    uint64_t h = hash(key);
+    size_t idx = h % capacity_;
     size_t start_idx = idx;
+    uint32_t fp = fingerprint(h);
 
-    while (entries_[idx].occupied) {
-      if (!entries_[idx].deleted && entries_[idx].key == key) {
+    while (entries_[idx].state != Entry::EMPTY) {
+      if (matches(entries_[idx], fp, key)) {
         // Update existing
-        entries_[idx].value = std::move(value);
+        if (replaced) *replaced = std::move(entries_[idx].value);
+        entries_[idx].value = rehome(std::move(value), resource_);
         return false;
       }
       idx = (idx + 1) % capacity_;
@@ -50,27 +114,18 @@ class HashMap {
     }
 
     // Insert new
-    entries_[idx].key = std::string(key);
-    entries_[idx].value = std::move(value);
-    entries_[idx].occupied = true;
-    entries_[idx].deleted = false;
+    Entry& entry = entries_[idx];
+    set_key(entry, key, fp);
+    entry.value = rehome(std::move(value), resource_);
+    entry.state = Entry::LIVE;
     size_++;
     return true;
   }
 
   /// @brief Retrieve a value by key.
   Value* get(std::string_view key) {
-    size_t idx = hash(key);
-    size_t start_idx = idx;
-
-    while (entries_[idx].occupied) {
-      if (!entries_[idx].deleted && entries_[idx].key == key) {
-        return &entries_[idx].value;
-      }
-      idx = (idx + 1) % capacity_;
-      if (idx == start_idx) return nullptr;
-    }
-    return nullptr;
+    Entry* entry = find(key);
+    return entry ? &entry->value : nullptr;
   }
 
   // Const overflow for get
@@ -78,41 +133,246 @@ class HashMap {
     return const_cast<HashMap*>(this)->get(key);
   }
 
+  /// @brief Batch of lookups resolved together by get_many().
+  static constexpr size_t LOOKUP_BATCH = 16;
+
+  /// @brief Start loading the bucket `key` hashes to, ahead of a lookup.
+  void prefetch(std::string_view key) const {
+    __builtin_prefetch(&entries_[hash(key) % capacity_]);
+  }
+
+  /// @brief Look up `count` keys at once: all keys of a batch are hashed and
+  /// their buckets prefetched before the first one is resolved, so the
+  /// cache misses overlap instead of stalling one after the other.
+  /// @param out Receives one value pointer per key (nullptr if absent).
+  void get_many(const std::string_view* keys, size_t count, Value** out) {
+    uint64_t hashes[LOOKUP_BATCH];
+    for (size_t base = 0; base < count; base += LOOKUP_BATCH) {
+      size_t n = std::min(LOOKUP_BATCH, count - base);
+      for (size_t i = 0; i < n; ++i) {
+        hashes[i] = hash(keys[base + i]);
+        __builtin_prefetch(&entries_[hashes[i] % capacity_]);
+      }
+      for (size_t i = 0; i < n; ++i) {
+        Entry* entry = find(keys[base + i], hashes[i]);
+        out[base + i] = entry ? &entry->value : nullptr;
+      }
+    }
+  }
+
   /// @brief Remove a key.
   bool del(std::string_view key) {
-    size_t idx = hash(key);
-    size_t start_idx = idx;
+    Value removed;
+    return take(key, removed);
+  }
 
-    while (entries_[idx].occupied) {
-      if (!entries_[idx].deleted && entries_[idx].key == key) {
-        entries_[idx].deleted = true;
-        entries_[idx].value = std::monostate{};  // Clear memory
-        size_--;
-        return true;
+  /// @brief Remove a key, moving its value to `out` rather than destroying it.
+  bool take(std::string_view key, Value& out) {
+    Entry* entry = find(key);
+    if (!entry) return false;
+    free_key(*entry);
+    entry->key_size = 0;
+    out = std::move(entry->value);
+    entry->value.reset();
+    entry->state = Entry::DELETED;
+    size_--;
+    tombstones_++;
+    return true;
+  }
+
+  /// @brief Remove every key; `dispose` receives each value as an rvalue.
+  template <typename F>
+  void clear(F dispose) {
+    for (auto& entry : entries_) {
+      if (entry.state == Entry::LIVE) {
+        free_key(entry);
+        dispose(std::move(entry.value));
+        entry.value.reset();
       }
-      idx = (idx + 1) % capacity_;
-      if (idx == start_idx) return false;
+      entry.key_size = 0;
+      entry.state = Entry::EMPTY;
     }
-    return false;
+    size_ = 0;
+    tombstones_ = 0;
   }
 
   /// @brief Iterate over all valid entries
   template <typename F>
   void for_each(F callback) const {
     for (const auto& entry : entries_) {
-      if (entry.occupied && !entry.deleted) {
-        callback(entry.key, entry.value);
+      if (entry.state == Entry::LIVE) {
+        callback(entry.key(), entry.value);
+      }
+    }
+  }
+
+  /// @brief Incrementally iterate over valid entries (SCAN style).
+  /// Visits `count` buckets starting at `cursor`. Start with cursor 0.
+  /// @return Cursor for the next call, or 0 once the whole table was visited.
+  template <typename F>
+  size_t scan(size_t cursor, size_t count, F callback) const {
+    size_t end = std::min(cursor + count, capacity_);
+    for (size_t idx = cursor; idx < end; ++idx) {
+      const auto& entry = entries_[idx];
+      if (entry.state == Entry::LIVE) {
+        callback(entry.key(), entry.value);
+      }
+    }
+    return end < capacity_ ? end : 0;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+  size_t capacity() const {
+    return capacity_;
+  }
+  /// @brief Buckets holding a deleted entry; they lengthen probe sequences
+  /// until compact() clears them.
+  size_t tombstones() const {
+    return tombstones_;
+  }
+
+  /// @brief Defragmentation: give keys and values that have an allocation
+  /// for which `should_move(const void*)` holds fresh memory from the
+  /// map's resource. Visits `count` buckets from `cursor`, like scan().
+  /// @param moved Incremented per relocated key or value.
+  /// @return Cursor for the next call, or 0 once the whole table was visited.
+  template <typename Pred>
+  size_t relocate(size_t cursor, size_t count, Pred should_move, size_t& moved) {
+    size_t end = std::min(cursor + count, capacity_);
+    for (size_t idx = cursor; idx < end; ++idx) {
+      auto& entry = entries_[idx];
+      if (entry.state != Entry::LIVE) continue;
+      if (!entry.inline_key() && should_move(entry.key_ptr())) {
+        const char* old_key = entry.key_ptr();
+        set_key(entry, {old_key, entry.key_size}, entry.fingerprint);
+        resource_->deallocate(const_cast<char*>(old_key), entry.key_size, 1);
+        moved++;
+      }
+      if (any_allocation(entry.value, should_move)) {
+        entry.value = storage::relocate(entry.value, resource_);
+        moved++;
       }
     }
+    return end < capacity_ ? end : 0;
+  }
+
+  /// @brief Clear the tombstones of the clusters (runs of occupied buckets)
+  /// starting in the next `count` buckets from `cursor`. Live entries are
+  /// re-placed within their cluster, so lookups stay valid, but they may
+  /// change buckets: no scan() may be in progress.
+  /// @return Cursor for the next call, or 0 once the whole table was visited.
+  size_t compact(size_t cursor, size_t count) {
+    if (tombstones_ == 0) return 0;
+    if (size_ + tombstones_ == capacity_) {
+      // No empty bucket, hence no cluster boundary: rebuild everything
+      rebuild(0, capacity_);
+      return 0;
+    }
+
+    size_t end = std::min(cursor + count, capacity_);
+    for (size_t idx = cursor; idx < end; ++idx) {
+      size_t prev = (idx + capacity_ - 1) % capacity_;
+      if (entries_[idx].state == Entry::EMPTY || entries_[prev].state != Entry::EMPTY) continue;
+
+      size_t len = 0;
+      bool has_tombstone = false;
+      for (size_t i = idx; entries_[i].state != Entry::EMPTY; i = (i + 1) % capacity_) {
+        has_tombstone |= entries_[i].state == Entry::DELETED;
+        len++;
+      }
+      if (has_tombstone) rebuild(idx, len);
+    }
+    return end < capacity_ ? end : 0;
   }
 
  private:
-  std::vector<Entry> entries_;
+  std::vector<Entry, TableAllocator<Entry>> entries_;
   size_t capacity_;
   size_t size_;
+  size_t tombstones_ = 0;
+  std::pmr::memory_resource* resource_;
+
+  static uint64_t hash(std::string_view key) {
+    return std::hash<std::string_view>{}(key);
+  }
+  static uint32_t fingerprint(uint64_t h) {
+    return static_cast<uint32_t>(h >> 32);
+  }
+
+  static bool matches(const Entry& entry, uint32_t fp, std::string_view key) {
+    return entry.state == Entry::LIVE && entry.fingerprint == fp &&
+           entry.key_size == key.size() &&
+           std::memcmp(entry.key_ptr(), key.data(), key.size()) == 0;
+  }
+
+  Entry* find(std::string_view key) {
+    return find(key, hash(key));
+  }
 
-  size_t hash(std::string_view key) const {
-    return std::hash<std::string_view>{}(key) % capacity_;
+  Entry* find(std::string_view key, uint64_t h) {
+    size_t idx = h % capacity_;
+    size_t start_idx = idx;
+    uint32_t fp = fingerprint(h);
+
+    while (entries_[idx].state != Entry::EMPTY) {
+      if (matches(entries_[idx], fp, key)) return &entries_[idx];
+      idx = (idx + 1) % capacity_;
+      if (idx == start_idx) return nullptr;
+    }
+    return nullptr;
+  }
+
+  // Store `key` in the entry (inline or in a new allocation); the previous
+  // out-of-line key, if any, is the caller's to free
+  void set_key(Entry& entry, std::string_view key, uint32_t fp) {
+    entry.fingerprint = fp;
+    entry.key_size = static_cast<uint32_t>(key.size());
+    if (entry.inline_key()) {
+      std::memcpy(entry.key_data, key.data(), key.size());
+    } else {
+      char* p = static_cast<char*>(resource_->allocate(key.size(), 1));
+      std::memcpy(p, key.data(), key.size());
+      std::memcpy(entry.key_data, &p, sizeof(p));
+    }
+  }
+
+  void free_keys() {
+    for (auto& entry : entries_) {
+      if (entry.state == Entry::LIVE) free_key(entry);
+    }
+  }
+
+  void free_key(Entry& entry) {
+    if (!entry.inline_key()) {
+      resource_->deallocate(const_cast<char*>(entry.key_ptr()), entry.key_size, 1);
+    }
+  }
+
+  // Empty `len` buckets from `start` (wrapping) and re-insert their live
+  // entries. Every entry's home bucket lies in the range, so they all land
+  // back inside it. Keys move along with their entry.
+  void rebuild(size_t start, size_t len) {
+    std::vector<Entry> live;
+    live.reserve(len);
+    for (size_t i = 0; i < len; ++i) {
+      auto& entry = entries_[(start + i) % capacity_];
+      if (entry.state == Entry::EMPTY) continue;
+      if (entry.state == Entry::DELETED) {
+        tombstones_--;
+      } else {
+        live.push_back(std::move(entry));
+      }
+      entry.value.reset();
+      entry.state = Entry::EMPTY;
+    }
+
+    for (auto& entry : live) {
+      size_t idx = hash(entry.key()) % capacity_;
+      while (entries_[idx].state != Entry::EMPTY) idx = (idx + 1) % capacity_;
+      entries_[idx] = std::move(entry);
+    }
   }
 };
 
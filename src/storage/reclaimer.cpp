@@ -0,0 +1,74 @@
+#include "reclaimer.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace quine {
+namespace storage {
+
+size_t Reclaimer::cost(const Value& value) {
+  switch (value.type()) {
+    case ValueType::LIST:
+      return value.get_if<List>()->size();
+    case ValueType::SET:
+      return value.get_if<Set>()->size();
+    case ValueType::HASH:
+      return value.get_if<Hash>()->size();
+    case ValueType::ZSET:
+      return value.get_if<ZSet>()->size();
+    default:
+      return 0;
+  }
+}
+
+void Reclaimer::dispose(Value&& value) {
+  if (cost(value) <= LAZY_THRESHOLD) {
+    value.reset();
+    return;
+  }
+  queue_.push_back(std::move(value));
+  pending_.store(queue_.size(), std::memory_order_relaxed);
+}
+
+// Erase the first `n` elements of a node-based container
+template <typename C>
+static bool erase_front(C& container, size_t n) {
+  auto end = container.begin();
+  std::advance(end, std::min(n, container.size()));
+  container.erase(container.begin(), end);
+  return container.empty();
+}
+
+bool Reclaimer::shrink(Value& value) {
+  if (auto* list = value.get_if<List>()) {
+    size_t n = std::min(ELEMENTS_PER_CHUNK, list->size());
+    list->erase(list->end() - n, list->end());
+    return list->empty();
+  }
+  if (auto* set = value.get_if<Set>()) return erase_front(*set, ELEMENTS_PER_CHUNK);
+  if (auto* hash = value.get_if<Hash>()) return erase_front(*hash, ELEMENTS_PER_CHUNK);
+  if (auto* zset = value.get_if<ZSet>()) {
+    // Both indexes hold a copy of each member
+    erase_front(zset->tree, ELEMENTS_PER_CHUNK / 2);
+    return erase_front(zset->dict, ELEMENTS_PER_CHUNK / 2) && zset->tree.empty();
+  }
+  return true;
+}
+
+bool Reclaimer::step(std::chrono::microseconds budget) {
+  if (queue_.empty()) return false;
+
+  auto deadline = std::chrono::steady_clock::now() + budget;
+  do {
+    Value& value = queue_.front();
+    if (shrink(value)) {
+      queue_.pop_front();  // Frees what is left: the empty container
+      pending_.store(queue_.size(), std::memory_order_relaxed);
+      freed_.store(freed() + 1, std::memory_order_relaxed);
+    }
+  } while (!queue_.empty() && std::chrono::steady_clock::now() < deadline);
+  return !queue_.empty();
+}
+
+}  // namespace storage
+}  // namespace quine
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+
+#include "value.hpp"
+
+namespace quine {
+namespace storage {
+
+/// @brief Lazy freeing of large values, one per Shard.
+///
+/// Destroying a collection with millions of elements takes as many
+/// deallocations, which would stall the owning core's event loop. Values
+/// detached by UNLINK, FLUSHALL ASYNC, overwrites and expiry are handed to
+/// the reclaimer instead, and destroyed a slice at a time between two
+/// event-loop iterations. The shard's memory is single-threaded, so this
+/// runs on the owning core, not on a separate thread.
+class Reclaimer {
+ public:
+  /// @brief Collections with more elements than this are freed lazily;
+  /// smaller values cost less to free than to queue.
+  static constexpr size_t LAZY_THRESHOLD = 64;
+  /// @brief Elements destroyed between two clock checks.
+  static constexpr size_t ELEMENTS_PER_CHUNK = 256;
+  /// @brief Maximum time spent per event-loop iteration.
+  static constexpr std::chrono::microseconds BUDGET{250};
+
+  Reclaimer() = default;
+  Reclaimer(const Reclaimer&) = delete;
+  Reclaimer& operator=(const Reclaimer&) = delete;
+
+  /// @brief Number of elements destroying `value` costs (0 for strings).
+  static size_t cost(const Value& value);
+
+  /// @brief Free `value`: right away if it is small, later otherwise.
+  void dispose(Value&& value);
+
+  /// @brief Destroy queued values for at most `budget`. Call once per tick.
+  /// @return true if values remain and another tick is needed.
+  bool step(std::chrono::microseconds budget = BUDGET);
+
+  /// @brief Values waiting to be destroyed (readable from any core).
+  size_t pending() const {
+    return pending_.load(std::memory_order_relaxed);
+  }
+  /// @brief Values destroyed lazily so far (readable from any core).
+  size_t freed() const {
+    return freed_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  // Destroy up to ELEMENTS_PER_CHUNK elements of `value`.
+  // @return true once it holds no more elements
+  static bool shrink(Value& value);
+
+  std::deque<Value> queue_;
+  // Single writer (the owning core)
+  std::atomic<size_t> pending_{0};
+  std::atomic<size_t> freed_{0};
+};
+
+}  // namespace storage
+}  // namespace quine
@@ -1,26 +1,37 @@
 #include "shard.hpp"
 
+#include <algorithm>
+
 namespace quine {
 namespace storage {
 
-Shard::Shard() : data_store_(10000) {}
+static_assert(Shard::TABLE_ENTRIES * sizeof(HashMap::Entry) >=
+                  TableAllocator<HashMap::Entry>::HUGE_PAGE_SIZE,
+              "The key table must be large enough to be mapped on huge pages");
+
+Shard::Shard() : data_store_(TABLE_ENTRIES, &memory_), expires_(&memory_) {}
 
 void Shard::set(std::string_view key, Value value) {
-  data_store_.put(key, std::move(value));
+  Value replaced;
+  data_store_.put(key, std::move(value), &replaced);
+  reclaimer_.dispose(std::move(replaced));
   // SET clears any existing expiration
-  expires_.erase(std::string(key));
+  auto it = expires_.find(key);
+  if (it != expires_.end()) expires_.erase(it);
 }
 
 Value* Shard::get(std::string_view key) {
   // Check expiration
-  auto it = expires_.find(std::string(key));
+  auto it = expires_.find(key);
   if (it != expires_.end()) {
     auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
                    std::chrono::system_clock::now().time_since_epoch())
                    .count();
     if (now > it->second) {
       // Expired
-      data_store_.del(key);
+      Value expired;
+      data_store_.take(key, expired);
+      reclaimer_.dispose(std::move(expired));
       expires_.erase(it);
       return nullptr;
     }
@@ -36,7 +47,7 @@ const Value* Shard::get(std::string_view key) const {
   // For now, let's just return key if it exists, RDB might save expired keys
   // which is fine (they will expire on load).
   // Actually, let's check validation to be clean.
-  auto it = expires_.find(std::string(key));
+  auto it = expires_.find(key);
   if (it != expires_.end()) {
     auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
                    std::chrono::system_clock::now().time_since_epoch())
@@ -48,17 +59,85 @@ const Value* Shard::get(std::string_view key) const {
   return data_store_.get(key);
 }
 
+void Shard::get_many(const std::string_view* keys, size_t count, Value** out) {
+  data_store_.get_many(keys, count, out);
+  if (expires_.empty()) return;
+
+  auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                 std::chrono::system_clock::now().time_since_epoch())
+                 .count();
+  for (size_t i = 0; i < count; ++i) {
+    if (!out[i]) continue;
+    auto it = expires_.find(keys[i]);
+    if (it != expires_.end() && now > it->second) {
+      // Deleting leaves the other entries in place: their pointers stay valid
+      Value* expired = out[i];
+      std::replace(out + i, out + count, expired, static_cast<Value*>(nullptr));
+      Value value;
+      data_store_.take(keys[i], value);
+      reclaimer_.dispose(std::move(value));
+      expires_.erase(it);
+    }
+  }
+}
+
 bool Shard::del(std::string_view key) {
-  expires_.erase(std::string(key));
+  auto it = expires_.find(key);
+  if (it != expires_.end()) expires_.erase(it);
   return data_store_.del(key);
 }
 
+bool Shard::unlink(std::string_view key) {
+  auto it = expires_.find(key);
+  if (it != expires_.end()) expires_.erase(it);
+  Value value;
+  if (!data_store_.take(key, value)) return false;
+  reclaimer_.dispose(std::move(value));
+  return true;
+}
+
+void Shard::flush(bool lazy) {
+  data_store_.clear([&](Value&& value) {
+    if (lazy) reclaimer_.dispose(std::move(value));
+  });
+  expires_ = decltype(expires_)(&memory_);  // Releases the bucket array too
+}
+
 void Shard::set_expiry(std::string_view key, long long milliseconds_timestamp) {
-  expires_[std::string(key)] = milliseconds_timestamp;
+  auto it = expires_.find(key);
+  if (it != expires_.end()) {
+    it->second = milliseconds_timestamp;
+  } else {
+    expires_.emplace(key, milliseconds_timestamp);
+  }
+}
+
+size_t Shard::relocate_expiries(size_t cursor, size_t count, size_t& moved) {
+  size_t buckets = expires_.bucket_count();
+  size_t end = std::min(cursor + count, buckets);
+
+  std::vector<std::string> keys;
+  for (size_t bucket = cursor; bucket < end; ++bucket) {
+    for (auto it = expires_.begin(bucket); it != expires_.end(bucket); ++it) {
+      if (memory_.should_move(&*it) || memory_.should_move(it->first.data())) {
+        keys.emplace_back(it->first);
+      }
+    }
+  }
+
+  // Re-inserting allocates a new node; the size is unchanged, so no rehash
+  for (const auto& key : keys) {
+    auto it = expires_.find(std::string_view(key));
+    long long timestamp = it->second;
+    expires_.erase(it);
+    expires_.emplace(key, timestamp);
+    moved++;
+  }
+  return end < buckets ? end : 0;
 }
 
 long long Shard::get_expiry(std::string_view key) const {
-  auto it = expires_.find(std::string(key));
+  auto it = expires_.find(key);
   if (it != expires_.end()) {
     return it->second;
   }
@@ -1,11 +1,16 @@
 #pragma once
 
 #include <chrono>
+#include <memory_resource>
 #include <optional>
+#include <string>
 #include <string_view>
 #include <unordered_map>
+#include <vector>
 
 #include "hash_map.hpp"
+#include "reclaimer.hpp"
+#include "slab_resource.hpp"
 #include "value.hpp"
 
 namespace quine {
@@ -15,6 +20,10 @@ namespace storage {
 /// Wraps a HashMap and provides high-level storage operations.
 class Shard {
  public:
+  /// @brief Buckets of the key table, which does not grow yet. Its 64-byte
+  /// buckets fill exactly one huge page, so QUINE_HUGE_PAGES applies to it.
+  static constexpr size_t TABLE_ENTRIES = 32768;
+
   Shard();
 
   void set(std::string_view key, Value value);
@@ -22,19 +31,91 @@ class Shard {
   const Value* get(std::string_view key) const;
   bool del(std::string_view key);
 
+  /// @brief Remove a key like del(), but leave destroying a large value to
+  /// the reclaimer.
+  bool unlink(std::string_view key);
+
+  /// @brief Remove every key. With `lazy`, large values are destroyed by
+  /// the reclaimer over the next event-loop iterations.
+  void flush(bool lazy);
+
+  /// @brief Look up several keys with overlapping cache misses, see
+  /// HashMap::get_many. Expired keys are removed and reported as absent.
+  void get_many(const std::string_view* keys, size_t count, Value** out);
+
+  /// @brief Hint that `key` is about to be accessed (e.g. by the next
+  /// commands of a pipeline).
+  void prefetch(std::string_view key) const {
+    data_store_.prefetch(key);
+  }
+
   template <typename F>
   void for_each(F callback) const {
     data_store_.for_each(callback);
   }
 
+  /// @brief Incrementally iterate over keys, see HashMap::scan.
+  template <typename F>
+  size_t scan(size_t cursor, size_t count, F callback) const {
+    return data_store_.scan(cursor, count, callback);
+  }
+
   // Expiration support
   void set_expiry(std::string_view key, long long milliseconds_timestamp);
   long long get_expiry(std::string_view key) const;  // Returns timestamp or -1
 
+  /// @brief Allocator for values about to be stored here (saves a copy in set()).
+  Allocator allocator() {
+    return Allocator(&memory_);
+  }
+
+  /// @brief Memory accounting of this shard (readable from any core).
+  const SlabResource& memory() const {
+    return memory_;
+  }
+
+  /// @brief allocated / used bytes; 1.0 means no memory is wasted.
+  double fragmentation_ratio() const {
+    size_t used = memory_.used_bytes();
+    return used == 0 ? 1.0 : static_cast<double>(memory_.allocated_bytes()) / used;
+  }
+
+  // -- Defragmentation (owning core only, driven by the Defragmenter) --
+
+  SlabResource& memory() {
+    return memory_;
+  }
+  /// @brief Large values detached from the shard, destroyed in slices.
+  Reclaimer& reclaimer() {
+    return reclaimer_;
+  }
+  const Reclaimer& reclaimer() const {
+    return reclaimer_;
+  }
+  const HashMap& table() const {
+    return data_store_;
+  }
+
+  /// @brief Copy keys and values out of draining slabs, see HashMap::relocate.
+  size_t relocate(size_t cursor, size_t count, size_t& moved) {
+    return data_store_.relocate(
+        cursor, count, [this](const void* p) { return memory_.should_move(p); }, moved);
+  }
+
+  /// @brief Same for the expiry index; `cursor` walks its buckets.
+  size_t relocate_expiries(size_t cursor, size_t count, size_t& moved);
+
+  /// @brief Clear hash table tombstones, see HashMap::compact.
+  size_t compact(size_t cursor, size_t count) {
+    return data_store_.compact(cursor, count);
+  }
+
  private:
+  SlabResource memory_;  // Declared first: outlives everything allocated from it
+  Reclaimer reclaimer_;
   HashMap data_store_;
   // Stores absolute timestamp in milliseconds for expiration
-  std::unordered_map<std::string, long long> expires_;
+  std::pmr::unordered_map<String, long long, StringHash, std::equal_to<>> expires_;
 };
 
 }  // namespace storage
@@ -0,0 +1,168 @@
+#include "slab_resource.hpp"
+
+#include <cstddef>
+#include <new>
+
+namespace quine {
+namespace storage {
+
+// Size classes: 16..128 step 16, 192..512 step 64, 640..1024 step 128
+static constexpr size_t SLAB_ALIGN = 16;
+
+size_t SlabResource::class_index(size_t bytes) {
+  if (bytes == 0) bytes = 1;
+  if (bytes <= 128) return (bytes + 15) / 16 - 1;
+  if (bytes <= 512) return 8 + (bytes - 128 + 63) / 64 - 1;
+  return 14 + (bytes - 512 + 127) / 128 - 1;
+}
+
+static size_t index_size(size_t index) {
+  if (index < 8) return (index + 1) * 16;
+  if (index < 14) return 128 + (index - 7) * 64;
+  return 512 + (index - 13) * 128;
+}
+
+size_t SlabResource::class_size(size_t bytes) {
+  if (bytes > MAX_SMALL) return 0;
+  return index_size(class_index(bytes));
+}
+
+size_t SlabResource::blocks_per_slab(size_t index) {
+  return (SLAB_SIZE - sizeof(SlabHeader)) / index_size(index);
+}
+
+SlabResource::~SlabResource() {
+  for (SlabHeader* slab : slabs_) upstream_->deallocate(slab, SLAB_SIZE, SLAB_SIZE);
+}
+
+void SlabResource::refill(size_t index) {
+  // Carve a fresh slab into blocks of this class, after the header. Slabs
+  // are aligned to their size so a block finds its header by masking.
+  void* mem = upstream_->allocate(SLAB_SIZE, SLAB_SIZE);
+  auto* slab = new (mem) SlabHeader{nullptr, 0, static_cast<uint8_t>(index), false};
+  slabs_.push_back(slab);
+  add(allocated_, SLAB_SIZE);
+
+  char* base = reinterpret_cast<char*>(slab + 1);
+  size_t block_size = index_size(index);
+  for (size_t i = blocks_per_slab(index); i-- > 0;) {
+    auto* block = reinterpret_cast<FreeBlock*>(base + i * block_size);
+    block->next = free_[index];
+    free_[index] = block;
+  }
+}
+
+void SlabResource::release(SlabHeader* slab) {
+  auto it = std::find(slabs_.begin(), slabs_.end(), slab);
+  *it = slabs_.back();
+  slabs_.pop_back();
+  auto drained = std::lower_bound(drain_list_.begin(), drain_list_.end(), slab);
+  if (drained != drain_list_.end() && *drained == slab) drain_list_.erase(drained);
+
+  upstream_->deallocate(slab, SLAB_SIZE, SLAB_SIZE);
+  sub(allocated_, SLAB_SIZE);
+}
+
+void* SlabResource::do_allocate(size_t bytes, size_t alignment) {
+  if (bytes > MAX_SMALL || alignment > SLAB_ALIGN) {
+    void* p = upstream_->allocate(bytes, alignment);
+    add(used_, bytes);
+    add(allocated_, bytes);
+    return p;
+  }
+
+  size_t index = class_index(bytes);
+  if (!free_[index]) refill(index);
+  FreeBlock* block = free_[index];
+  free_[index] = block->next;
+  slab_of(block)->live++;
+  add(used_, index_size(index));
+  return block;
+}
+
+void SlabResource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+  if (bytes > MAX_SMALL || alignment > SLAB_ALIGN) {
+    upstream_->deallocate(p, bytes, alignment);
+    sub(used_, bytes);
+    sub(allocated_, bytes);
+    return;
+  }
+
+  size_t index = class_index(bytes);
+  auto* block = static_cast<FreeBlock*>(p);
+  SlabHeader* slab = slab_of(p);
+  slab->live--;
+  sub(used_, index_size(index));
+
+  if (slab->draining) {
+    block->next = slab->free;
+    slab->free = block;
+    if (slab->live == 0) release(slab);
+  } else {
+    block->next = free_[index];
+    free_[index] = block;
+  }
+}
+
+size_t SlabResource::begin_drain(double max_occupancy) {
+  end_drain();
+
+  // The fullest slab of each class keeps serving: relocated data packs into it
+  std::array<SlabHeader*, NUM_CLASSES> fullest{};
+  for (SlabHeader* slab : slabs_) {
+    SlabHeader*& best = fullest[slab->index];
+    if (!best || slab->live > best->live) best = slab;
+  }
+
+  std::array<bool, NUM_CLASSES> affected{};
+  for (SlabHeader* slab : slabs_) {
+    if (slab == fullest[slab->index]) continue;
+    if (slab->live < max_occupancy * blocks_per_slab(slab->index)) {
+      slab->draining = true;
+      drain_list_.push_back(slab);
+      affected[slab->index] = true;
+    }
+  }
+  if (drain_list_.empty()) return 0;
+  std::sort(drain_list_.begin(), drain_list_.end());
+
+  // Take the free blocks of draining slabs off the class lists
+  for (size_t index = 0; index < NUM_CLASSES; ++index) {
+    if (!affected[index]) continue;
+    FreeBlock** link = &free_[index];
+    while (*link) {
+      FreeBlock* block = *link;
+      SlabHeader* slab = slab_of(block);
+      if (slab->draining) {
+        *link = block->next;
+        block->next = slab->free;
+        slab->free = block;
+      } else {
+        link = &block->next;
+      }
+    }
+  }
+
+  // Nothing to move out of empty slabs
+  std::vector<SlabHeader*> empty;
+  for (SlabHeader* slab : drain_list_) {
+    if (slab->live == 0) empty.push_back(slab);
+  }
+  for (SlabHeader* slab : empty) release(slab);
+  return drain_list_.size();
+}
+
+void SlabResource::end_drain() {
+  for (SlabHeader* slab : drain_list_) {
+    slab->draining = false;
+    while (FreeBlock* block = slab->free) {
+      slab->free = block->next;
+      block->next = free_[slab->index];
+      free_[slab->index] = block;
+    }
+  }
+  drain_list_.clear();
+}
+
+}  // namespace storage
+}  // namespace quine
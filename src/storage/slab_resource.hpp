@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+namespace quine {
+namespace storage {
+
+/// @brief Per-shard size-class slab allocator, used as the memory resource
+/// of every key, value and container element stored in a Shard.
+///
+/// Small requests are served from 64 KiB slabs carved into fixed-size
+/// blocks, with one free list per size class. Larger requests go straight
+/// to the upstream resource. Not thread-safe: only the owning core
+/// allocates and frees. The byte counters may be read from any thread.
+///
+/// For active defragmentation, sparsely used slabs can be drained: they
+/// stop serving allocations, so data copied out of them lands in denser
+/// slabs, and they are returned upstream as soon as their last block is
+/// freed.
+class SlabResource : public std::pmr::memory_resource {
+ public:
+  static constexpr size_t SLAB_SIZE = 64 * 1024;  // Slabs are aligned to their size
+  static constexpr size_t MAX_SMALL = 1024;       // Largest size class
+  static constexpr size_t NUM_CLASSES = 18;
+
+  explicit SlabResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+      : upstream_(upstream) {}
+  ~SlabResource() override;
+
+  SlabResource(const SlabResource&) = delete;
+  SlabResource& operator=(const SlabResource&) = delete;
+
+  /// @brief Bytes currently handed out (rounded up to the size class).
+  size_t used_bytes() const {
+    return used_.load(std::memory_order_relaxed);
+  }
+
+  /// @brief Bytes obtained from upstream: slabs plus large allocations.
+  size_t allocated_bytes() const {
+    return allocated_.load(std::memory_order_relaxed);
+  }
+
+  /// @brief Number of slabs held, draining ones included.
+  size_t slab_count() const {
+    return slabs_.size();
+  }
+
+  /// @brief Block size of the class serving `bytes` (0 = not slab-allocated).
+  static size_t class_size(size_t bytes);
+
+  // -- Defragmentation --
+
+  /// @brief Start draining every slab whose share of live blocks is below
+  /// `max_occupancy` (0..1), except the fullest slab of each class. Empty
+  /// slabs are released right away.
+  /// @return Number of slabs now draining.
+  size_t begin_drain(double max_occupancy);
+
+  /// @brief Whether `p` points into a draining slab, i.e. the allocation
+  /// holding it should be copied elsewhere. Accepts any pointer.
+  bool should_move(const void* p) const {
+    return !drain_list_.empty() &&
+           std::binary_search(drain_list_.begin(), drain_list_.end(), slab_of(p));
+  }
+
+  /// @brief Stop draining. Slabs that still hold live blocks serve
+  /// allocations again.
+  void end_drain();
+
+  /// @brief Number of slabs currently draining.
+  size_t draining() const {
+    return drain_list_.size();
+  }
+
+ protected:
+  void* do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+
+ private:
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  // Start of every slab; blocks follow it
+  struct alignas(16) SlabHeader {
+    FreeBlock* free;  // Free blocks while draining (kept off the class list)
+    uint32_t live;    // Blocks handed out
+    uint8_t index;    // Size class
+    bool draining;
+  };
+
+  static size_t class_index(size_t bytes);
+  static size_t blocks_per_slab(size_t index);
+  static SlabHeader* slab_of(const void* p) {
+    return reinterpret_cast<SlabHeader*>(reinterpret_cast<uintptr_t>(p) & ~(SLAB_SIZE - 1));
+  }
+  void refill(size_t index);
+  void release(SlabHeader* slab);
+
+  // Single writer (the owning core); plain load + store keeps the hot path
+  // free of locked instructions.
+  void add(std::atomic<size_t>& counter, size_t bytes) {
+    counter.store(counter.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+  }
+  void sub(std::atomic<size_t>& counter, size_t bytes) {
+    counter.store(counter.load(std::memory_order_relaxed) - bytes, std::memory_order_relaxed);
+  }
+
+  std::pmr::memory_resource* upstream_;
+  std::array<FreeBlock*, NUM_CLASSES> free_{};
+  std::vector<SlabHeader*> slabs_;
+  std::vector<SlabHeader*> drain_list_;  // Sorted
+  std::atomic<size_t> used_{0};
+  std::atomic<size_t> allocated_{0};
+};
+
+}  // namespace storage
+}  // namespace quine
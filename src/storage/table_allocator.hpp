@@ -0,0 +1,92 @@
+#pragma once
+
+#include <sys/mman.h>
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+namespace quine {
+namespace storage {
+
+/// @brief How large hash tables are backed by memory.
+enum class HugePageMode {
+  OFF,          // Regular 4 KiB pages
+  TRANSPARENT,  // madvise(MADV_HUGEPAGE): kernel THP when available
+  EXPLICIT      // MAP_HUGETLB from the reserved pool, regular pages if exhausted
+};
+
+inline std::atomic<HugePageMode>& huge_page_mode_ref() {
+  static std::atomic<HugePageMode> mode{HugePageMode::OFF};
+  return mode;
+}
+
+/// @brief Set the process-wide huge page policy (before shards are created).
+inline void set_huge_page_mode(HugePageMode mode) {
+  huge_page_mode_ref().store(mode, std::memory_order_relaxed);
+}
+
+inline HugePageMode huge_page_mode() {
+  return huge_page_mode_ref().load(std::memory_order_relaxed);
+}
+
+/// @brief Allocator for big flat tables (HashMap buckets).
+///
+/// Tables of at least HUGE_PAGE_SIZE bytes are mapped directly with mmap
+/// (rounded up to whole huge pages) and backed according to
+/// huge_page_mode(). Pages are only populated on first touch, so a table
+/// allocated and filled by a pinned worker lands on that worker's NUMA node.
+template <typename T>
+class TableAllocator {
+ public:
+  using value_type = T;
+  static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+  TableAllocator() = default;
+  template <typename U>
+  TableAllocator(const TableAllocator<U>&) {}
+
+  T* allocate(size_t n) {
+    size_t bytes = n * sizeof(T);
+    if (bytes < HUGE_PAGE_SIZE) return static_cast<T*>(::operator new(bytes));
+
+    size_t length = mapped_length(bytes);
+    void* p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if (huge_page_mode() == HugePageMode::EXPLICIT) {
+      p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+               -1, 0);
+    }
+#endif
+    if (p == MAP_FAILED) {
+      p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (p == MAP_FAILED) throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+      if (huge_page_mode() != HugePageMode::OFF) madvise(p, length, MADV_HUGEPAGE);
+#endif
+    }
+    return static_cast<T*>(p);
+  }
+
+  void deallocate(T* p, size_t n) {
+    size_t bytes = n * sizeof(T);
+    if (bytes < HUGE_PAGE_SIZE) {
+      ::operator delete(p);
+    } else {
+      munmap(p, mapped_length(bytes));
+    }
+  }
+
+  template <typename U>
+  bool operator==(const TableAllocator<U>&) const {
+    return true;
+  }
+
+ private:
+  static size_t mapped_length(size_t bytes) {
+    return (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+  }
+};
+
+}  // namespace storage
+}  // namespace quine
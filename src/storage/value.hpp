@@ -1,27 +1,47 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <deque>
 #include <map>
+#include <memory_resource>
+#include <new>
 #include <set>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
 #include <variant>
 #include <vector>
 
 namespace quine {
 namespace storage {
 
-// Data Structures mirroring ZephyraDB functionality
-using String = std::string;
-using List = std::deque<std::string>;
-using Set = std::set<std::string>;
-using Hash = std::map<std::string, std::string>;
+/// @brief Allocator of stored data; Shards hand out one backed by their
+/// SlabResource. Containers pass it on to their elements.
+using Allocator = std::pmr::polymorphic_allocator<std::byte>;
+
+/// @brief Transparent hash so string_view lookups don't build a String.
+struct StringHash {
+  using is_transparent = void;
+  size_t operator()(std::string_view s) const {
+    return std::hash<std::string_view>{}(s);
+  }
+};
+
+// Data Structures mirroring ZephyraDB functionality.
+// Ordered containers use std::less<> so lookups take a std::string_view.
+using String = std::pmr::string;
+using List = std::pmr::deque<String>;
+using Set = std::pmr::set<String, std::less<>>;
+using Hash = std::pmr::map<String, String, std::less<>>;
 
-// Score-Value pair for Sorted Sets
 // Score-Value pair for Sorted Sets
 struct ZSetEntry {
   double score;
-  std::string member;
+  String member;
 
   bool operator<(const ZSetEntry& other) const {
     if (score != other.score) return score < other.score;
@@ -29,24 +49,55 @@ struct ZSetEntry {
   }
 };
 
+// Lookup key for a ZSetEntry that does not own its member
+struct ZSetKey {
+  double score;
+  std::string_view member;
+};
+
+inline bool operator<(const ZSetEntry& a, const ZSetKey& b) {
+  if (a.score != b.score) return a.score < b.score;
+  return std::string_view(a.member) < b.member;
+}
+inline bool operator<(const ZSetKey& a, const ZSetEntry& b) {
+  if (a.score != b.score) return a.score < b.score;
+  return a.member < std::string_view(b.member);
+}
+
 struct ZSet {
-  std::set<ZSetEntry> tree;
-  std::unordered_map<std::string, double> dict;
+  using allocator_type = Allocator;
+
+  std::pmr::set<ZSetEntry, std::less<>> tree;
+  std::pmr::unordered_map<String, double, StringHash, std::equal_to<>> dict;
+
+  ZSet() = default;
+  explicit ZSet(const Allocator& alloc) : tree(alloc), dict(alloc) {}
+  ZSet(const ZSet& other, const Allocator& alloc) : tree(alloc), dict(alloc) {
+    for (const auto& entry : other.tree) insert(entry.score, entry.member);
+  }
+  // Copies element-wise when the allocators differ
+  ZSet(ZSet&& other, const Allocator& alloc) : ZSet(std::as_const(other), alloc) {}
+
+  Allocator get_allocator() const {
+    return tree.get_allocator();
+  }
 
-  void insert(ZSetEntry entry) {
-    auto it = dict.find(entry.member);
+  void insert(double score, std::string_view member) {
+    auto it = dict.find(member);
     if (it != dict.end()) {
       // Remove old score mapping from tree
-      tree.erase({it->second, entry.member});
+      tree.erase(tree.find(ZSetKey{it->second, member}));
+      it->second = score;
+    } else {
+      dict.emplace(member, score);
     }
-    dict[entry.member] = entry.score;
-    tree.insert(entry);
+    tree.insert(ZSetEntry{score, String(member, get_allocator())});
   }
 
-  bool erase(const std::string& member) {
+  bool erase(std::string_view member) {
     auto it = dict.find(member);
     if (it != dict.end()) {
-      tree.erase({it->second, member});
+      tree.erase(tree.find(ZSetKey{it->second, member}));
       dict.erase(it);
       return true;
     }
@@ -64,28 +115,407 @@ struct ZSet {
   }
 };
 
-// Polymorphic container
-using Value = std::variant<std::monostate,  // Empty/Null
-                           String, List, Set, Hash, ZSet>;
-
 enum class ValueType { NONE = 0, STRING, LIST, SET, HASH, ZSET };
 
-inline ValueType get_type(const Value& v) {
-  switch (v.index()) {
-    case 1:
-      return ValueType::STRING;
-    case 2:
-      return ValueType::LIST;
-    case 3:
-      return ValueType::SET;
-    case 4:
-      return ValueType::HASH;
-    case 5:
-      return ValueType::ZSET;
+/// @brief A long string shared by reference: header followed by the bytes.
+/// Freed by whichever lets go last: the Value or a SharedString.
+struct SharedBlock {
+  std::pmr::memory_resource* resource;
+  size_t size;
+  size_t refs;
+  char* data() {
+    return reinterpret_cast<char*>(this + 1);
+  }
+  void release() noexcept {
+    if (--refs == 0) resource->deallocate(this, sizeof(SharedBlock) + size, alignof(SharedBlock));
+  }
+};
+
+/// @brief Reference to the bytes of a shared string value (Value::share()).
+/// They stay valid, and keep counting against their shard's memory, until
+/// the last reference is gone, even if the value is overwritten or deleted:
+/// replies send them without copying. Not thread-safe: references are
+/// taken and dropped on the thread owning the value's shard.
+class SharedString {
+ public:
+  SharedString() = default;
+  SharedString(const SharedString& other) noexcept : block_(other.block_) {
+    if (block_) block_->refs++;
+  }
+  SharedString& operator=(const SharedString& other) noexcept {
+    SharedString(other).swap(*this);
+    return *this;
+  }
+  SharedString(SharedString&& other) noexcept : block_(std::exchange(other.block_, nullptr)) {}
+  SharedString& operator=(SharedString&& other) noexcept {
+    SharedString(std::move(other)).swap(*this);
+    return *this;
+  }
+  ~SharedString() {
+    if (block_) block_->release();
+  }
+
+  explicit operator bool() const noexcept {
+    return block_ != nullptr;
+  }
+  std::string_view view() const noexcept {
+    return block_ ? std::string_view(block_->data(), block_->size) : std::string_view();
+  }
+  size_t size() const noexcept {
+    return block_ ? block_->size : 0;
+  }
+
+  void swap(SharedString& other) noexcept {
+    std::swap(block_, other.block_);
+  }
+
+ private:
+  friend class Value;
+  explicit SharedString(SharedBlock* block) noexcept : block_(block) {
+    block_->refs++;
+  }
+
+  SharedBlock* block_ = nullptr;
+};
+
+/// @brief Compact (16-byte) handle to a stored value.
+///
+/// Strings of up to INLINE_CAPACITY bytes, which covers integers of up to
+/// 15 digits, live inside the handle. Longer strings are one
+/// allocation (header plus bytes); from SHARED_MIN bytes on, the header
+/// has a reference count (see share()). Collections are boxed: the List,
+/// Set, Hash or ZSet object is allocated separately, from the same memory
+/// resource as its elements. Type dispatch is a switch on one tag byte.
+/// Copies go to the default resource, like those of std::pmr containers.
+class Value {
+ public:
+  /// @brief Longest string stored without an allocation.
+  static constexpr size_t INLINE_CAPACITY = 15;
+  /// @brief Shortest string stored refcounted, to be sent by reference.
+  static constexpr size_t SHARED_MIN = 16 * 1024;
+
+  Value() noexcept {
+    set_empty();
+  }
+  Value(std::monostate) noexcept : Value() {}
+
+  /// @brief A string, allocated from `alloc` unless it fits inline.
+  Value(std::string_view s, const Allocator& alloc = {}) {
+    if (s.size() <= INLINE_CAPACITY) {
+      std::memcpy(data_, s.data(), s.size());
+      meta_ = static_cast<uint8_t>(INLINE_STRING | s.size() << KIND_BITS);
+      return;
+    }
+    std::pmr::memory_resource* resource = alloc.resource();
+    if (s.size() >= SHARED_MIN) {
+      auto* block = static_cast<SharedBlock*>(
+          resource->allocate(sizeof(SharedBlock) + s.size(), alignof(SharedBlock)));
+      block->resource = resource;
+      block->size = s.size();
+      block->refs = 1;
+      std::memcpy(block->data(), s.data(), s.size());
+      set_ptr(block, SHARED_STRING);
+      return;
+    }
+    auto* str = static_cast<HeapString*>(
+        resource->allocate(sizeof(HeapString) + s.size(), alignof(HeapString)));
+    str->resource = resource;
+    str->size = s.size();
+    std::memcpy(str->data(), s.data(), s.size());
+    set_ptr(str, HEAP_STRING);
+  }
+  Value(const char* s) : Value(std::string_view(s)) {}
+  Value(const std::string& s) : Value(std::string_view(s)) {}
+  Value(const String& s) : Value(std::string_view(s), s.get_allocator()) {}
+
+  /// @brief Collections are boxed in their own allocator's resource.
+  Value(List&& list) {
+    box(std::move(list), LIST);
+  }
+  Value(Set&& set) {
+    box(std::move(set), SET);
+  }
+  Value(Hash&& hash) {
+    box(std::move(hash), HASH);
+  }
+  Value(ZSet&& zset) {
+    box(std::move(zset), ZSET);
+  }
+
+  Value(const Value& other);
+  Value& operator=(const Value& other) {
+    if (this != &other) *this = Value(other);
+    return *this;
+  }
+
+  Value(Value&& other) noexcept {
+    take(other);
+  }
+  Value& operator=(Value&& other) noexcept {
+    if (this != &other) {
+      reset();
+      take(other);
+    }
+    return *this;
+  }
+
+  ~Value() {
+    reset();
+  }
+
+  ValueType type() const noexcept {
+    switch (kind()) {
+      case INLINE_STRING:
+      case HEAP_STRING:
+      case SHARED_STRING:
+        return ValueType::STRING;
+      case LIST:
+        return ValueType::LIST;
+      case SET:
+        return ValueType::SET;
+      case HASH:
+        return ValueType::HASH;
+      case ZSET:
+        return ValueType::ZSET;
+      default:
+        return ValueType::NONE;
+    }
+  }
+
+  bool is_string() const noexcept {
+    return kind() == INLINE_STRING || kind() == HEAP_STRING || kind() == SHARED_STRING;
+  }
+
+  /// @brief Contents of a string value (empty for other types).
+  std::string_view string() const noexcept {
+    if (kind() == INLINE_STRING) return {data_, static_cast<size_t>(meta_ >> KIND_BITS)};
+    if (kind() == HEAP_STRING) {
+      auto* str = static_cast<HeapString*>(ptr());
+      return {str->data(), str->size};
+    }
+    if (kind() == SHARED_STRING) {
+      auto* block = static_cast<SharedBlock*>(ptr());
+      return {block->data(), block->size};
+    }
+    return {};
+  }
+
+  /// @brief A reference to the bytes of a string of at least SHARED_MIN
+  /// bytes; empty for other values.
+  SharedString share() const noexcept {
+    if (kind() != SHARED_STRING) return {};
+    return SharedString(static_cast<SharedBlock*>(ptr()));
+  }
+
+  /// @brief The collection held, or nullptr if the value has another type.
+  template <typename T>
+  T* get_if() noexcept {
+    return kind() == kind_of<T>() ? static_cast<T*>(ptr()) : nullptr;
+  }
+  template <typename T>
+  const T* get_if() const noexcept {
+    return kind() == kind_of<T>() ? static_cast<const T*>(ptr()) : nullptr;
+  }
+
+  /// @brief Resource the value's memory comes from; nullptr if it has none
+  /// (empty or inline).
+  std::pmr::memory_resource* resource() const noexcept;
+
+  /// @brief The value's own allocation (long string or collection box),
+  /// or nullptr.
+  const void* allocation() const noexcept {
+    return kind() >= HEAP_STRING ? ptr() : nullptr;
+  }
+
+  /// @brief Free the value's memory and make it empty.
+  void reset() noexcept;
+
+ private:
+  enum Kind : uint8_t { NONE, INLINE_STRING, HEAP_STRING, LIST, SET, HASH, ZSET, SHARED_STRING };
+  static constexpr unsigned KIND_BITS = 3;
+
+  // A long string: header followed by the bytes
+  struct HeapString {
+    std::pmr::memory_resource* resource;
+    size_t size;
+    char* data() {
+      return reinterpret_cast<char*>(this + 1);
+    }
+  };
+
+  template <typename T>
+  static constexpr Kind kind_of() {
+    if constexpr (std::is_same_v<T, List>) {
+      return LIST;
+    } else if constexpr (std::is_same_v<T, Set>) {
+      return SET;
+    } else if constexpr (std::is_same_v<T, Hash>) {
+      return HASH;
+    } else {
+      static_assert(std::is_same_v<T, ZSet>, "not a collection type");
+      return ZSET;
+    }
+  }
+
+  Kind kind() const noexcept {
+    return static_cast<Kind>(meta_ & ((1u << KIND_BITS) - 1));
+  }
+  void* ptr() const noexcept {
+    void* p;
+    std::memcpy(&p, data_, sizeof(p));
+    return p;
+  }
+  void set_ptr(void* p, Kind kind) noexcept {
+    std::memcpy(data_, &p, sizeof(p));
+    meta_ = kind;
+  }
+  void set_empty() noexcept {
+    meta_ = NONE;
+  }
+  void take(Value& other) noexcept {
+    std::memcpy(data_, other.data_, sizeof(data_));
+    meta_ = other.meta_;
+    other.set_empty();
+  }
+
+  template <typename T>
+  void box(T&& obj, Kind kind) {
+    std::pmr::memory_resource* resource = obj.get_allocator().resource();
+    void* mem = resource->allocate(sizeof(T), alignof(T));
+    try {
+      set_ptr(new (mem) T(std::move(obj)), kind);
+    } catch (...) {
+      resource->deallocate(mem, sizeof(T), alignof(T));
+      throw;
+    }
+  }
+
+  template <typename T>
+  static void unbox(T* obj) noexcept {
+    std::pmr::memory_resource* resource = obj->get_allocator().resource();
+    obj->~T();
+    resource->deallocate(obj, sizeof(T), alignof(T));
+  }
+
+  alignas(void*) char data_[INLINE_CAPACITY] = {};
+  uint8_t meta_;  // Kind in the low bits, inline string length above
+};
+
+static_assert(sizeof(Value) == 16, "Value must stay a compact handle");
+
+inline std::pmr::memory_resource* Value::resource() const noexcept {
+  switch (kind()) {
+    case HEAP_STRING:
+      return static_cast<HeapString*>(ptr())->resource;
+    case SHARED_STRING:
+      return static_cast<SharedBlock*>(ptr())->resource;
+    case LIST:
+      return get_if<List>()->get_allocator().resource();
+    case SET:
+      return get_if<Set>()->get_allocator().resource();
+    case HASH:
+      return get_if<Hash>()->get_allocator().resource();
+    case ZSET:
+      return get_if<ZSet>()->get_allocator().resource();
+    default:
+      return nullptr;
+  }
+}
+
+inline void Value::reset() noexcept {
+  switch (kind()) {
+    case HEAP_STRING: {
+      auto* str = static_cast<HeapString*>(ptr());
+      str->resource->deallocate(str, sizeof(HeapString) + str->size, alignof(HeapString));
+      break;
+    }
+    case SHARED_STRING:
+      static_cast<SharedBlock*>(ptr())->release();
+      break;
+    case LIST:
+      unbox(get_if<List>());
+      break;
+    case SET:
+      unbox(get_if<Set>());
+      break;
+    case HASH:
+      unbox(get_if<Hash>());
+      break;
+    case ZSET:
+      unbox(get_if<ZSet>());
+      break;
+    default:
+      break;
+  }
+  set_empty();
+}
+
+/// @brief Copy of `value` in fresh memory from `resource`, even if it
+/// already lives there. Used by the defragmenter to move data out of
+/// sparsely used slabs.
+inline Value relocate(const Value& value, std::pmr::memory_resource* resource) {
+  Allocator alloc(resource);
+  switch (value.type()) {
+    case ValueType::STRING:
+      return Value(value.string(), alloc);
+    case ValueType::LIST:
+      return Value(List(*value.get_if<List>(), alloc));
+    case ValueType::SET:
+      return Value(Set(*value.get_if<Set>(), alloc));
+    case ValueType::HASH:
+      return Value(Hash(*value.get_if<Hash>(), alloc));
+    case ValueType::ZSET:
+      return Value(ZSet(*value.get_if<ZSet>(), alloc));
     default:
-      return ValueType::NONE;
+      return Value();
   }
 }
 
+inline Value::Value(const Value& other) : Value(relocate(other, std::pmr::get_default_resource())) {}
+
+/// @brief Move `value` into memory from `resource`. A cheap move if it
+/// already lives there (or needs no memory), a copy otherwise.
+inline Value rehome(Value&& value, std::pmr::memory_resource* resource) {
+  std::pmr::memory_resource* current = value.resource();
+  if (!current || current == resource) return std::move(value);
+  return relocate(value, resource);
+}
+
+/// @brief Whether `pred` holds for the address of any allocation of
+/// `value`: its own block and container nodes (sampled through their
+/// elements). Pointers into inline (small-string) storage are passed too.
+template <typename Pred>
+bool any_allocation(const Value& value, Pred pred) {
+  const void* block = value.allocation();
+  if (!block) return false;
+  if (pred(block)) return true;
+
+  if (const auto* hash = value.get_if<Hash>()) {
+    for (const auto& [field, val] : *hash) {
+      if (pred(&field) || pred(field.data()) || pred(val.data())) return true;
+    }
+  } else if (const auto* zset = value.get_if<ZSet>()) {
+    for (const auto& entry : zset->tree) {
+      if (pred(&entry) || pred(entry.member.data())) return true;
+    }
+    for (const auto& entry : zset->dict) {
+      if (pred(&entry) || pred(entry.first.data())) return true;
+    }
+  } else if (const auto* list = value.get_if<List>()) {
+    for (const auto& elem : *list) {
+      if (pred(&elem) || pred(elem.data())) return true;
+    }
+  } else if (const auto* set = value.get_if<Set>()) {
+    for (const auto& elem : *set) {
+      if (pred(&elem) || pred(elem.data())) return true;
+    }
+  }
+  return false;
+}
+
+inline ValueType get_type(const Value& v) {
+  return v.type();
+}
+
 }  // namespace storage
 }  // namespace quine
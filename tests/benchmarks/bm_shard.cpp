@@ -1,8 +1,10 @@
 #include <benchmark/benchmark.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "core/router.hpp"
 #include "storage/shard.hpp"
 
 using namespace quine::storage;
@@ -57,4 +59,71 @@ static void BM_ShardGet(benchmark::State& state) {
 }
 BENCHMARK(BM_ShardGet);
 
+// Random lookups in a table of state.range(0) keys. The largest size does
+// not fit in the last-level cache, so nearly every probe misses.
+class HashMapFixture : public benchmark::Fixture {
+ public:
+  void SetUp(const benchmark::State& state) override {
+    size_t count = state.range(0);
+    map = std::make_unique<HashMap>(count + count / 2);
+    names.clear();
+    for (size_t i = 0; i < count; ++i) {
+      names.push_back("user:session:" + std::to_string(i * 7919));
+      map->put(names.back(), "value");
+    }
+    // Visit keys in a fixed pseudo-random order
+    keys.clear();
+    for (size_t i = 0, j = 0; i < count; ++i, j = (j + 2654435761u) % count) {
+      keys.push_back(names[j]);
+    }
+  }
+  void TearDown(const benchmark::State&) override {
+    map.reset();
+    names = {};
+    keys = {};
+  }
+
+  std::unique_ptr<HashMap> map;
+  std::vector<std::string> names;
+  std::vector<std::string_view> keys;
+};
+
+BENCHMARK_DEFINE_F(HashMapFixture, Get)(benchmark::State& state) {
+  size_t i = 0;
+  for (auto _ : state) {
+    for (size_t n = 0; n < HashMap::LOOKUP_BATCH; ++n) {
+      benchmark::DoNotOptimize(map->get(keys[i]));
+      if (++i == keys.size()) i = 0;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * HashMap::LOOKUP_BATCH);
+}
+BENCHMARK_REGISTER_F(HashMapFixture, Get)->Arg(1 << 10)->Arg(1 << 21);
+
+BENCHMARK_DEFINE_F(HashMapFixture, GetMany)(benchmark::State& state) {
+  Value* values[HashMap::LOOKUP_BATCH];
+  size_t i = 0;
+  for (auto _ : state) {
+    map->get_many(&keys[i], HashMap::LOOKUP_BATCH, values);
+    benchmark::DoNotOptimize(values);
+    i += HashMap::LOOKUP_BATCH;
+    if (i + HashMap::LOOKUP_BATCH > keys.size()) i = 0;
+  }
+  state.SetItemsProcessed(state.iterations() * HashMap::LOOKUP_BATCH);
+}
+BENCHMARK_REGISTER_F(HashMapFixture, GetMany)->Arg(1 << 10)->Arg(1 << 21);
+
+static void BM_RouterGetShard(benchmark::State& state) {
+  quine::core::Router router(16);
+  std::vector<std::string> keys;
+  for (int i = 0; i < 1000; ++i) keys.push_back("user:{" + std::to_string(i) + "}:profile");
+
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(router.get_shard_id(keys[i % 1000]));
+    i++;
+  }
+}
+BENCHMARK(BM_RouterGetShard);
+
 BENCHMARK_MAIN();
@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/buffer_pool.hpp"
+#include "core/message.hpp"
+
+using quine::core::Buffer;
+using quine::core::BufferPool;
+
+TEST(BufferPoolTest, RecyclesBlocksOnOwningThread) {
+  BufferPool pool;
+  pool.bind_to_current_thread();
+
+  const char* first;
+  {
+    Buffer buf = pool.acquire(100);
+    ASSERT_EQ(buf.size(), 100u);
+    first = buf.data();
+  }
+  EXPECT_EQ(pool.cached(), 1u);
+
+  // The same block is handed out again
+  Buffer again = pool.acquire(10);
+  EXPECT_EQ(again.data(), first);
+  EXPECT_EQ(pool.cached(), 0u);
+}
+
+TEST(BufferPoolTest, OversizedBuffersBypassCache) {
+  BufferPool pool;
+  pool.bind_to_current_thread();
+  {
+    Buffer big = pool.acquire(BufferPool::BLOCK_CAPACITY + 1);
+    EXPECT_EQ(big.size(), BufferPool::BLOCK_CAPACITY + 1);
+  }
+  EXPECT_EQ(pool.cached(), 0u);
+}
+
+TEST(BufferPoolTest, ForeignReleaseReturnsToHomePool) {
+  BufferPool pool;
+  pool.bind_to_current_thread();
+
+  std::vector<Buffer> buffers;
+  for (int i = 0; i < 8; ++i) buffers.push_back(pool.acquire(64));
+
+  // Another core drops the buffers: they go onto the return stack
+  std::thread other([moved = std::move(buffers)]() mutable { moved.clear(); });
+  other.join();
+  EXPECT_EQ(pool.cached(), 0u);
+
+  // The owner picks them up on its next acquire
+  Buffer buf = pool.acquire(64);
+  EXPECT_EQ(pool.cached(), 7u);
+}
+
+TEST(MessageTest, ArgumentsRoundTrip) {
+  BufferPool pool;
+  std::vector<std::string> args = {"SET", "key", std::string("va\0lue", 6), ""};
+
+  quine::core::Message msg;
+  msg.payload = quine::core::encode_args(pool, args);
+
+  // Decoding reuses (and shrinks) a scratch vector
+  std::vector<std::string> decoded = {"stale", "stale", "stale", "stale", "stale"};
+  quine::core::decode_args(msg.payload, decoded);
+  EXPECT_EQ(decoded, args);
+}
@@ -0,0 +1,26 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <vector>
+
+#include "core/cpu_affinity.hpp"
+
+using quine::core::parse_cpu_list;
+
+TEST(CpuAffinityTest, ParsesCpuLists) {
+  EXPECT_EQ(parse_cpu_list("3"), (std::vector<int>{3}));
+  EXPECT_EQ(parse_cpu_list("0-3,8,10-11"), (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+  EXPECT_TRUE(parse_cpu_list("").empty());
+}
+
+TEST(CpuAffinityTest, RejectsMalformedLists) {
+  EXPECT_THROW(parse_cpu_list("a"), std::invalid_argument);
+  EXPECT_THROW(parse_cpu_list("1,,2"), std::invalid_argument);
+  EXPECT_THROW(parse_cpu_list("4-2"), std::invalid_argument);
+}
+
+TEST(CpuAffinityTest, PinsToAllowedCpu) {
+  auto cpus = quine::core::allowed_cpus();
+  ASSERT_FALSE(cpus.empty());
+  EXPECT_TRUE(quine::core::pin_current_thread(cpus.front()));
+}
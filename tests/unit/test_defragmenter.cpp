@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#include "core/topology.hpp"
+#include "persistence/rdb_manager.hpp"
+#include "storage/defragmenter.hpp"
+#include "storage/shard.hpp"
+
+using namespace quine::storage;
+
+static DefragConfig eager_config() {
+  DefragConfig config;
+  config.enabled = true;
+  config.ignore_bytes = 0;
+  config.budget = std::chrono::microseconds(100);
+  return config;
+}
+
+// Fills the shard, then deletes 3 keys out of 4: sparse slabs and tombstones
+static void churn(Shard& shard, int keys) {
+  for (int i = 0; i < keys; ++i) {
+    shard.set("key" + std::to_string(i), String(std::string(100, 'a' + i % 26)));
+    if (i % 2 == 0) shard.set_expiry("key" + std::to_string(i), 1LL << 60);
+  }
+  for (int i = 0; i < keys; ++i) {
+    if (i % 4 != 0) shard.del("key" + std::to_string(i));
+  }
+}
+
+TEST(DefragmenterTest, ReleasesSparseSlabs) {
+  Shard shard;
+  // Enough deletes to pass the tombstone threshold of the whole key table
+  churn(shard, 20000);
+  double before = shard.fragmentation_ratio();
+  size_t allocated_before = shard.memory().allocated_bytes();
+  size_t used_before = shard.memory().used_bytes();
+  ASSERT_GT(before, 1.5);
+
+  Defragmenter defrag(shard, eager_config());
+  while (defrag.step(true)) {
+  }
+
+  EXPECT_EQ(defrag.cycles(), 1u);
+  EXPECT_GT(defrag.relocated(), 0u);
+  EXPECT_LT(shard.memory().allocated_bytes(), allocated_before);
+  EXPECT_EQ(shard.memory().used_bytes(), used_before);  // Moved, not copied out of the shard
+  EXPECT_LT(shard.fragmentation_ratio(), before);
+  EXPECT_EQ(shard.memory().draining(), 0u);
+  EXPECT_EQ(shard.table().tombstones(), 0u);
+
+  // Data and expiries survive the moves
+  for (int i = 0; i < 20000; i += 4) {
+    auto* val = shard.get("key" + std::to_string(i));
+    ASSERT_NE(val, nullptr);
+    EXPECT_EQ(val->string(), String(100, 'a' + i % 26));
+    EXPECT_EQ(val->resource(), &shard.memory());
+    EXPECT_EQ(shard.get_expiry("key" + std::to_string(i)), i % 2 == 0 ? 1LL << 60 : -1);
+  }
+}
+
+TEST(DefragmenterTest, IdleBelowThresholds) {
+  Shard shard;
+  for (int i = 0; i < 1000; ++i) shard.set("key" + std::to_string(i), String(100, 'x'));
+
+  Defragmenter defrag(shard, eager_config());
+  EXPECT_FALSE(defrag.step(true));
+  EXPECT_EQ(defrag.cycles(), 0u);
+
+  DefragConfig disabled = eager_config();
+  disabled.enabled = false;
+  churn(shard, 8000);
+  Defragmenter off(shard, disabled);
+  EXPECT_FALSE(off.step(true));
+  EXPECT_EQ(off.cycles(), 0u);
+}
+
+TEST(DefragmenterTest, NoCompactionWhileScanning) {
+  Shard shard;
+  for (int i = 0; i < 4000; ++i) shard.set("key" + std::to_string(i), String("v"));
+  for (int i = 0; i < 4000; i += 2) shard.del("key" + std::to_string(i));
+  size_t tombstones = shard.table().tombstones();
+  ASSERT_GT(tombstones, 0u);
+
+  DefragConfig config = eager_config();
+  config.ignore_bytes = SIZE_MAX;  // Tombstones only
+  Defragmenter defrag(shard, config);
+  EXPECT_FALSE(defrag.step(false));
+  EXPECT_EQ(shard.table().tombstones(), tombstones);
+}
+
+// SAVE reads every core's shard from its own core: no core may defragment
+TEST(DefragmenterTest, SnapshotWritersHoldOffDefragmentation) {
+  quine::core::Topology topology(1);
+  topology.get_shard(0)->set("key", String("v"));
+  std::string path = "/tmp/quine_defrag_test_" + std::to_string(getpid()) + ".rdb";
+  EXPECT_FALSE(topology.snapshot_scan_active());
+  {
+    quine::persistence::RdbWriter abandoned(topology, path);  // Its client left
+    EXPECT_TRUE(topology.snapshot_scan_active());
+  }
+  EXPECT_FALSE(topology.snapshot_scan_active());
+
+  quine::persistence::RdbWriter writer(topology, path);
+  EXPECT_TRUE(topology.snapshot_scan_active());
+  while (!writer.step(quine::persistence::RdbWriter::BUCKETS_PER_STEP)) {
+  }
+  EXPECT_TRUE(writer.ok());
+  EXPECT_FALSE(topology.snapshot_scan_active());
+  std::remove(path.c_str());
+}
@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+#include <sys/select.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "core/io_context.hpp"
+#include "core/task.hpp"
+#include "core/topology.hpp"
+
+using namespace quine::core;
+
+TEST(IoContextTest, ProfilesFallBackToWhatTheKernelSupports) {
+  // Whatever this kernel lacks is dropped instead of failing
+  RingConfig everything;
+  everything.entries = 64;
+  everything.sqpoll = true;
+  everything.registered_files = 16;
+  IoContext ctx(everything);
+  EXPECT_NE(ctx.features().find("REGISTERED_FILES(16)"), std::string::npos);
+
+  RingConfig plain;
+  plain.entries = 64;
+  plain.single_issuer = false;
+  plain.registered_files = 0;
+  IoContext basic(plain);
+  EXPECT_EQ(basic.setup_flags(), 0u);
+  EXPECT_EQ(basic.features(), "none");
+  EXPECT_EQ(basic.register_file(0), -1);
+}
+
+TEST(IoContextTest, IoThroughRegisteredFiles) {
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+
+  RingConfig config;
+  config.entries = 64;
+  config.registered_files = 3;  // The eventfd takes one
+  IoContext ctx(config);
+  int read_slot = ctx.register_file(fds[0]);
+  int write_slot = ctx.register_file(fds[1]);
+  ASSERT_GE(read_slot, 0);
+  ASSERT_GE(write_slot, 0);
+  EXPECT_EQ(ctx.register_file(fds[1]), -1);  // Full: callers use the raw fd
+
+  // Freed slots are reused
+  ctx.unregister_file(write_slot);
+  EXPECT_EQ(ctx.register_file(fds[1]), write_slot);
+
+  // No raw fds: the operations only work through the table
+  std::string received;
+  auto echo = [&]() -> Task<> {
+    IoAwaiter write(ctx, IoAwaiter::Kind::WRITE, -1, const_cast<char*>("pong"), 4);
+    write.set_file_slot(write_slot);
+    co_await write;
+    char buf[8] = {};
+    IoAwaiter read(ctx, IoAwaiter::Kind::READ, -1, buf, sizeof(buf));
+    read.set_file_slot(read_slot);
+    int n = co_await read;
+    if (n > 0) received.assign(buf, n);
+    ctx.stop();
+  };
+  echo().detach();
+  ctx.run();
+  EXPECT_EQ(received, "pong");
+
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST(IoContextTest, BusyPollFindsWorkWithoutSleeping) {
+  RingConfig config;
+  config.entries = 64;
+  config.busy_poll_us = 100000;  // Long enough to never run out here
+  IoContext ctx(config);
+  EXPECT_EQ(ctx.features().find("DEFER_TASKRUN"), std::string::npos);
+
+  int polls = 0;
+  ctx.set_poll_handler([&](bool spinning) {
+    if (!spinning || ++polls < 1000) return false;
+    ctx.stop();  // "Work": ends the loop after this iteration
+    return true;
+  });
+  ctx.run();
+
+  EXPECT_EQ(polls, 1000);
+  EXPECT_EQ(ctx.stats().spin_hits.load(), 1u);
+  EXPECT_EQ(ctx.stats().sleeps.load(), 0u);
+}
+
+TEST(IoContextTest, BusyPollWindowShrinksWhenIdle) {
+  RingConfig config;
+  config.entries = 64;
+  config.busy_poll_us = 1600;
+  IoContext ctx(config);
+
+  int last_looks = 0;
+  ctx.set_poll_handler([&](bool spinning) {
+    if (!spinning) last_looks++;
+    return false;
+  });
+  // Idle wakeups, one per timer
+  for (int i = 1; i < 10; ++i) ctx.schedule(std::chrono::milliseconds(10 * i), [] {});
+  ctx.schedule(std::chrono::milliseconds(100), [&] { ctx.stop(); });
+  ctx.run();
+
+  // Every sleep was preceded by a last look; idle spins shrink the window
+  EXPECT_GT(ctx.stats().sleeps.load(), 0u);
+  EXPECT_EQ(static_cast<uint64_t>(last_looks), ctx.stats().sleeps.load());
+  EXPECT_EQ(ctx.stats().busy_poll_us.load(), 100u);
+  EXPECT_GT(ctx.stats().spin_us.load(), 0u);
+}
+
+TEST(IoContextTest, PollingCoresAreNotWoken) {
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  Topology topology(2);
+  topology.register_notify_fd(1, fds[1]);
+  auto pending = [&] {
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(fds[0], &set);
+    timeval zero{0, 0};
+    return select(fds[0] + 1, &set, nullptr, nullptr, &zero) > 0;
+  };
+
+  topology.set_polling(1, true);
+  topology.notify_core(1);
+  EXPECT_FALSE(pending());  // Spinning: sees its inbox without the wakeup
+
+  topology.set_polling(1, false);
+  topology.notify_core(1);
+  EXPECT_TRUE(pending());
+
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST(IoContextTest, LoopLagMeasuresTheRunningIteration) {
+  IoContext ctx(64);
+  Topology topology(1);
+  topology.register_loop_stats(0, &ctx.stats());
+  AdmissionLimits limits;
+  limits.max_loop_lag = std::chrono::milliseconds(10);
+  topology.set_admission_limits(limits);
+
+  std::chrono::microseconds lag{0};
+  bool overloaded = false;
+  ctx.schedule(std::chrono::milliseconds(10), [&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));  // A slow command
+    lag = topology.loop_lag(0);
+    overloaded = topology.overloaded(0);
+    ctx.stop();
+  });
+  EXPECT_EQ(topology.loop_lag(0).count(), 0);  // Not running yet
+  ctx.run();
+
+  EXPECT_GE(lag, std::chrono::milliseconds(20));
+  EXPECT_TRUE(overloaded);
+}
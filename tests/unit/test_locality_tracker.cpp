@@ -0,0 +1,38 @@
+#include <gtest/gtest.h>
+
+#include "network/locality_tracker.hpp"
+
+using quine::network::LocalityTracker;
+
+// Feeds one full window where `remote` commands go to `core`, the rest stay home
+static size_t feed_window(LocalityTracker& tracker, size_t home, size_t core, uint32_t remote) {
+  size_t result = LocalityTracker::NO_CORE;
+  for (uint32_t i = 0; i < LocalityTracker::WINDOW; ++i) {
+    result = tracker.record(i < remote ? core : home, home);
+  }
+  return result;
+}
+
+TEST(LocalityTrackerTest, SuggestsDominantRemoteCore) {
+  LocalityTracker tracker(4);
+  EXPECT_EQ(feed_window(tracker, 0, 2, LocalityTracker::WINDOW), 2u);
+}
+
+TEST(LocalityTrackerTest, MixedTrafficStays) {
+  LocalityTracker tracker(4);
+  EXPECT_EQ(feed_window(tracker, 0, 2, LocalityTracker::THRESHOLD - 1), LocalityTracker::NO_CORE);
+  // Mostly local traffic never moves either
+  EXPECT_EQ(feed_window(tracker, 0, 2, 0), LocalityTracker::NO_CORE);
+}
+
+TEST(LocalityTrackerTest, CooldownAfterMove) {
+  LocalityTracker tracker(4);
+  ASSERT_EQ(feed_window(tracker, 0, 2, LocalityTracker::WINDOW), 2u);
+  tracker.moved();
+
+  // Now on core 2, traffic shifts to core 3: held back during the cooldown
+  for (uint32_t w = 0; w < LocalityTracker::COOLDOWN_WINDOWS; ++w) {
+    EXPECT_EQ(feed_window(tracker, 2, 3, LocalityTracker::WINDOW), LocalityTracker::NO_CORE);
+  }
+  EXPECT_EQ(feed_window(tracker, 2, 3, LocalityTracker::WINDOW), 3u);
+}
@@ -18,12 +18,12 @@ TEST(HashMapTest, BasicPutGet) {
 
   Value* res = map.get("key1");
   ASSERT_NE(res, nullptr);
-  EXPECT_EQ(std::get<std::string>(*res), "value1");
+  EXPECT_EQ(res->string(), "value1");
 
   Value v2 = "value2";
   EXPECT_FALSE(map.put("key1", v2));  // Update
   res = map.get("key1");
-  EXPECT_EQ(std::get<std::string>(*res), "value2");
+  EXPECT_EQ(res->string(), "value2");
 }
 
 TEST(HashMapTest, Delete) {
@@ -43,22 +43,180 @@ TEST(HashMapTest, CollisionHandling) {
   map.put("k3", "v3");
   map.put("k4", "v4");
 
-  EXPECT_EQ(std::get<std::string>(*map.get("k1")), "v1");
-  EXPECT_EQ(std::get<std::string>(*map.get("k4")), "v4");
+  EXPECT_EQ(map.get("k1")->string(), "v1");
+  EXPECT_EQ(map.get("k4")->string(), "v4");
 
   // Full map should throw or handle gracefully (current impl throws
   // runtime_error)
   EXPECT_THROW(map.put("k5", "v5"), std::runtime_error);
 }
 
+TEST(HashMapTest, CompactClearsTombstones) {
+  HashMap map(64);
+  for (int i = 0; i < 40; ++i) map.put("key" + std::to_string(i), String("v" + std::to_string(i)));
+  for (int i = 0; i < 40; i += 2) map.del("key" + std::to_string(i));
+  EXPECT_EQ(map.tombstones(), 20u);
+
+  size_t cursor = 0;
+  do {
+    cursor = map.compact(cursor, 8);
+  } while (cursor != 0);
+
+  EXPECT_EQ(map.tombstones(), 0u);
+  EXPECT_EQ(map.size(), 20u);
+  for (int i = 0; i < 40; ++i) {
+    auto* val = map.get("key" + std::to_string(i));
+    if (i % 2 == 0) {
+      EXPECT_EQ(val, nullptr);
+    } else {
+      ASSERT_NE(val, nullptr);
+      EXPECT_EQ(val->string(), String("v" + std::to_string(i)));
+    }
+  }
+}
+
+TEST(HashMapTest, CompactFullTable) {
+  // Every bucket occupied: no cluster boundary, the table is rebuilt
+  HashMap map(4);
+  map.put("k1", "v1");
+  map.put("k2", "v2");
+  map.put("k3", "v3");
+  map.put("k4", "v4");
+  map.del("k2");
+  EXPECT_THROW(map.put("k5", "v5"), std::runtime_error);
+
+  EXPECT_EQ(map.compact(0, 4), 0u);
+  EXPECT_EQ(map.tombstones(), 0u);
+  EXPECT_TRUE(map.put("k5", "v5"));
+  EXPECT_EQ(map.get("k4")->string(), "v4");
+  EXPECT_EQ(map.get("k5")->string(), "v5");
+}
+
+TEST(HashMapTest, InlineAndOutOfLineKeys) {
+  SlabResource memory;
+  {
+    HashMap map(256, &memory);
+    // Lengths around the inline limit; keys differing only in the last byte
+    for (size_t len = 20; len <= 60; ++len) {
+      map.put(std::string(len, 'k'), String(std::to_string(len)));
+      map.put(std::string(len - 1, 'k') + "x", String("x" + std::to_string(len)));
+    }
+    EXPECT_EQ(map.size(), 82u);
+    for (size_t len = 20; len <= 60; ++len) {
+      ASSERT_NE(map.get(std::string(len, 'k')), nullptr);
+      EXPECT_EQ(map.get(std::string(len, 'k'))->string(), String(std::to_string(len)));
+      EXPECT_EQ(map.get(std::string(len - 1, 'k') + "x")->string(),
+                String("x" + std::to_string(len)));
+    }
+    EXPECT_EQ(map.get(std::string(61, 'k')), nullptr);
+
+    size_t visited = 0;
+    map.for_each([&](std::string_view key, const Value&) {
+      EXPECT_GE(key.size(), 20u);
+      visited++;
+    });
+    EXPECT_EQ(visited, 82u);
+
+    for (size_t len = 20; len <= 60; ++len) EXPECT_TRUE(map.del(std::string(len, 'k')));
+    EXPECT_EQ(map.get(std::string(50, 'k')), nullptr);
+    EXPECT_EQ(map.get(std::string(49, 'k') + "x")->string(), String("x50"));
+  }
+  // Out-of-line keys are freed with the map
+  EXPECT_EQ(memory.used_bytes(), 0u);
+}
+
+TEST(HashMapTest, RelocateAndCompactLongKeys) {
+  SlabResource memory;
+  HashMap map(4096, &memory);
+  auto key = [](int i) { return std::string(48, 'p') + std::to_string(i); };
+  for (int i = 0; i < 3000; ++i) map.put(key(i), String("v"));
+  for (int i = 0; i < 3000; ++i) {
+    if (i % 4 != 0) map.del(key(i));
+  }
+  size_t used = memory.used_bytes();
+
+  ASSERT_GT(memory.begin_drain(1.0), 0u);
+  size_t moved = 0;
+  size_t cursor = 0;
+  do {
+    cursor = map.relocate(cursor, 64, [&](const void* p) { return memory.should_move(p); }, moved);
+  } while (cursor != 0);
+  memory.end_drain();
+  EXPECT_GT(moved, 0u);
+  EXPECT_EQ(memory.used_bytes(), used);
+
+  do {
+    cursor = map.compact(cursor, 64);
+  } while (cursor != 0);
+  EXPECT_EQ(map.tombstones(), 0u);
+  EXPECT_EQ(memory.used_bytes(), used);  // Keys move with their entry
+  for (int i = 0; i < 3000; i += 4) {
+    ASSERT_NE(map.get(key(i)), nullptr);
+    EXPECT_EQ(map.get(key(i))->string(), "v");
+  }
+}
+
+TEST(HashMapTest, GetManyMatchesGet) {
+  HashMap map(256);
+  for (int i = 0; i < 100; ++i) map.put("key" + std::to_string(i), String(std::to_string(i)));
+
+  // More keys than one batch, with misses and a duplicate
+  std::vector<std::string> names;
+  for (int i = 0; i < 40; ++i) names.push_back("key" + std::to_string(i * 3));
+  names.push_back("key3");
+  std::vector<std::string_view> keys(names.begin(), names.end());
+  std::vector<Value*> values(keys.size());
+  map.get_many(keys.data(), keys.size(), values.data());
+
+  for (size_t i = 0; i < keys.size(); ++i) EXPECT_EQ(values[i], map.get(keys[i]));
+  EXPECT_EQ(values[1]->string(), "3");
+  EXPECT_EQ(values[39], nullptr);  // key117
+  EXPECT_EQ(values[40], values[1]);
+}
+
+TEST(HashMapTest, LargeTableOnHugePages) {
+  // The mode is process-wide: back to the default even if a check fails
+  struct ResetMode {
+    ~ResetMode() {
+      set_huge_page_mode(HugePageMode::OFF);
+    }
+  } reset;
+  // Big enough to be mmap-backed; falls back to regular pages without a pool
+  for (auto mode : {HugePageMode::OFF, HugePageMode::TRANSPARENT, HugePageMode::EXPLICIT}) {
+    set_huge_page_mode(mode);
+    HashMap map(100000);
+    EXPECT_TRUE(map.put("key", "value"));
+    ASSERT_NE(map.get("key"), nullptr);
+    EXPECT_EQ(map.get("key")->string(), "value");
+  }
+}
+
 // --- Shard Tests ---
 
+TEST(ShardTest, KeyTableOnHugePages) {
+  struct ResetMode {
+    ~ResetMode() {
+      set_huge_page_mode(HugePageMode::OFF);
+    }
+  } reset;
+  // Shards are created after the mode is set, like the workers' are
+  for (auto mode : {HugePageMode::OFF, HugePageMode::TRANSPARENT, HugePageMode::EXPLICIT}) {
+    set_huge_page_mode(mode);
+    Shard shard;
+    EXPECT_GE(shard.table().capacity() * sizeof(HashMap::Entry),
+              TableAllocator<HashMap::Entry>::HUGE_PAGE_SIZE);
+    shard.set("foo", "bar");
+    ASSERT_NE(shard.get("foo"), nullptr);
+    EXPECT_EQ(shard.get("foo")->string(), "bar");
+  }
+}
+
 TEST(ShardTest, SetGet) {
   Shard shard;
   shard.set("foo", "bar");
   auto* val = shard.get("foo");
   ASSERT_NE(val, nullptr);
-  EXPECT_EQ(std::get<std::string>(*val), "bar");
+  EXPECT_EQ(val->string(), "bar");
 }
 
 TEST(ShardTest, Expiry) {
@@ -99,7 +257,7 @@ TEST(ShardTest, SetCommands) {
   // Helper to construct set
   shard.set("myset", Set{});
   auto* val = shard.get("myset");
-  auto* set_ptr = std::get_if<Set>(val);
+  auto* set_ptr = val->get_if<Set>();
   ASSERT_NE(set_ptr, nullptr);
 
   set_ptr->insert("a");
@@ -109,3 +267,21 @@ TEST(ShardTest, SetCommands) {
   EXPECT_TRUE(set_ptr->contains("a"));
   EXPECT_FALSE(set_ptr->contains("c"));
 }
+
+TEST(ShardTest, GetManyExpires) {
+  Shard shard;
+  shard.set("a", "1");
+  shard.set("b", "2");
+  shard.set_expiry("b", 1);  // Long expired
+
+  std::string_view keys[] = {"a", "b", "c", "b"};
+  Value* values[4];
+  shard.get_many(keys, 4, values);
+  ASSERT_NE(values[0], nullptr);
+  EXPECT_EQ(values[0]->string(), "1");
+  EXPECT_EQ(values[1], nullptr);
+  EXPECT_EQ(values[2], nullptr);
+  EXPECT_EQ(values[3], nullptr);
+  EXPECT_EQ(shard.get_expiry("b"), -1);
+  EXPECT_EQ(shard.table().size(), 1u);
+}
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "storage/reclaimer.hpp"
+#include "storage/shard.hpp"
+
+using namespace quine::storage;
+
+static Value big_list(Shard& shard, size_t elements) {
+  List list{shard.allocator()};
+  for (size_t i = 0; i < elements; ++i) list.emplace_back("element" + std::to_string(i));
+  return Value(std::move(list));
+}
+
+static void drain(Reclaimer& reclaimer) {
+  while (reclaimer.step()) {
+  }
+}
+
+TEST(ReclaimerTest, SmallValuesFreedRightAway) {
+  Shard shard;
+  size_t baseline = shard.memory().used_bytes();
+  shard.set("list", big_list(shard, Reclaimer::LAZY_THRESHOLD));
+  shard.set("str", Value(std::string(100, 'x'), shard.allocator()));
+
+  EXPECT_TRUE(shard.unlink("list"));
+  EXPECT_TRUE(shard.unlink("str"));
+  EXPECT_FALSE(shard.unlink("str"));
+  EXPECT_EQ(shard.reclaimer().pending(), 0u);
+  EXPECT_EQ(shard.memory().used_bytes(), baseline);
+}
+
+TEST(ReclaimerTest, UnlinkFreesLargeValuesInSlices) {
+  Shard shard;
+  size_t baseline = shard.memory().used_bytes();
+  shard.set("list", big_list(shard, 100000));
+  Set set{shard.allocator()};
+  for (int i = 0; i < 5000; ++i) set.insert(String("m" + std::to_string(i)));
+  shard.set("set", Value(std::move(set)));
+  ZSet zset{shard.allocator()};
+  for (int i = 0; i < 5000; ++i) zset.insert(i, "m" + std::to_string(i));
+  shard.set("zset", Value(std::move(zset)));
+
+  EXPECT_TRUE(shard.unlink("list"));
+  EXPECT_TRUE(shard.unlink("set"));
+  EXPECT_TRUE(shard.unlink("zset"));
+  EXPECT_EQ(shard.get("list"), nullptr);
+  EXPECT_EQ(shard.reclaimer().pending(), 3u);
+
+  // A tiny budget destroys one chunk, not the whole list
+  EXPECT_TRUE(shard.reclaimer().step(std::chrono::microseconds(0)));
+  EXPECT_EQ(shard.reclaimer().pending(), 3u);
+
+  drain(shard.reclaimer());
+  EXPECT_EQ(shard.reclaimer().pending(), 0u);
+  EXPECT_EQ(shard.reclaimer().freed(), 3u);
+  EXPECT_EQ(shard.memory().used_bytes(), baseline);
+}
+
+TEST(ReclaimerTest, OverwriteAndExpiryAreLazy) {
+  Shard shard;
+  shard.set("k", big_list(shard, 1000));
+  shard.set("k", "small");
+  EXPECT_EQ(shard.get("k")->string(), "small");
+  EXPECT_EQ(shard.reclaimer().pending(), 1u);
+
+  shard.set("t", big_list(shard, 1000));
+  shard.set_expiry("t", 1);  // Long expired
+  EXPECT_EQ(shard.get("t"), nullptr);
+  EXPECT_EQ(shard.reclaimer().pending(), 2u);
+  drain(shard.reclaimer());
+  EXPECT_EQ(shard.reclaimer().pending(), 0u);
+}
+
+TEST(ReclaimerTest, Flush) {
+  for (bool lazy : {false, true}) {
+    Shard shard;
+    size_t baseline = shard.memory().used_bytes();
+    for (int i = 0; i < 100; ++i) shard.set("key" + std::to_string(i), "v");
+    shard.set("list", big_list(shard, 1000));
+    shard.set_expiry("key1", 1LL << 60);
+
+    shard.flush(lazy);
+    EXPECT_EQ(shard.table().size(), 0u);
+    EXPECT_EQ(shard.get("key1"), nullptr);
+    EXPECT_EQ(shard.get_expiry("key1"), -1);
+    EXPECT_EQ(shard.reclaimer().pending(), lazy ? 1u : 0u);
+    drain(shard.reclaimer());
+    EXPECT_EQ(shard.memory().used_bytes(), baseline);
+
+    // Usable afterwards
+    shard.set("key1", "w");
+    EXPECT_EQ(shard.get("key1")->string(), "w");
+  }
+}
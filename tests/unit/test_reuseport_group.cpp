@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "core/cpu_affinity.hpp"
+#include "network/reuseport_group.hpp"
+
+using quine::network::parse_steering;
+using quine::network::ReuseportGroup;
+using quine::network::Steering;
+
+// A non-blocking SO_REUSEPORT socket bound to 127.0.0.1:`port` (0 = any)
+static int bound_socket(uint16_t& port) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  int opt = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+  EXPECT_EQ(bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+  socklen_t len = sizeof(addr);
+  getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+  port = ntohs(addr.sin_port);
+  return fd;
+}
+
+static size_t accept_all(int fd) {
+  size_t accepted = 0;
+  for (int client; (client = accept(fd, nullptr, nullptr)) >= 0; accepted++) close(client);
+  return accepted;
+}
+
+TEST(ReuseportGroupTest, ParsesSteeringModes) {
+  EXPECT_EQ(parse_steering("hash"), Steering::HASH);
+  EXPECT_EQ(parse_steering("cpu"), Steering::CPU);
+  EXPECT_EQ(parse_steering("least-connections"), Steering::LEAST_CONNECTIONS);
+  EXPECT_THROW(parse_steering("random"), std::invalid_argument);
+}
+
+TEST(ReuseportGroupTest, MirrorsKernelGroupOrder) {
+  ReuseportGroup group;
+  uint16_t port = 0;
+  std::vector<int> fds;
+  for (int cpu : {4, 5, 6, 7}) {
+    fds.push_back(bound_socket(port));
+    ASSERT_TRUE(group.listen(fds.back(), cpu, 16));
+  }
+  EXPECT_EQ(group.cpus(), (std::vector<int>{4, 5, 6, 7}));
+
+  // The last listener takes the place of the one leaving
+  group.leave(fds[1]);
+  EXPECT_EQ(group.cpus(), (std::vector<int>{4, 7, 6}));
+  group.leave(fds[3]);
+  EXPECT_EQ(group.cpus(), (std::vector<int>{4, 6}));
+
+  fds.push_back(bound_socket(port));
+  ASSERT_TRUE(group.listen(fds.back(), 8, 16));
+  EXPECT_EQ(group.cpus(), (std::vector<int>{4, 6, 8}));
+  for (int fd : fds) close(fd);
+}
+
+TEST(ReuseportGroupTest, CpuSteeringPicksTheLocalListener) {
+  int cpu = quine::core::allowed_cpus().front();
+  ReuseportGroup group(Steering::CPU);
+  uint16_t port = 0;
+  std::vector<int> fds;
+  for (int listener_cpu : {cpu + 1, cpu, -1}) {
+    fds.push_back(bound_socket(port));
+    ASSERT_TRUE(group.listen(fds.back(), listener_cpu, 64));
+  }
+  if (!group.cpu_steering_active()) GTEST_SKIP() << "reuseport CBPF not supported";
+
+  // Loopback SYNs are processed on the connecting CPU
+  std::thread client([&] {
+    ASSERT_TRUE(quine::core::pin_current_thread(cpu));
+    for (int i = 0; i < 16; ++i) {
+      int fd = socket(AF_INET, SOCK_STREAM, 0);
+      sockaddr_in addr{};
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      addr.sin_port = htons(port);
+      EXPECT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+      close(fd);
+    }
+  });
+  client.join();
+
+  EXPECT_EQ(accept_all(fds[0]), 0u);
+  EXPECT_EQ(accept_all(fds[1]), 16u);
+  EXPECT_EQ(accept_all(fds[2]), 0u);
+  for (int fd : fds) close(fd);
+}
@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <future>
+#include <stdexcept>
+#include <string>
+
+#include "commands/cluster_commands.hpp"
+#include "core/router.hpp"
+#include "core/slot_migrator.hpp"
+#include "core/topology.hpp"
+
+using quine::core::Message;
+using quine::core::MessageType;
+using quine::core::Router;
+using quine::core::SlotMigrator;
+using quine::core::Topology;
+
+// --- Hash Tag Tests ---
+
+TEST(RouterTest, HashTagExtraction) {
+  EXPECT_EQ(Router::hash_tag("user:{42}:profile"), "42");
+  EXPECT_EQ(Router::hash_tag("{user1000}.following"), "user1000");
+  // Only the first {...} pair counts
+  EXPECT_EQ(Router::hash_tag("foo{bar}{zap}"), "bar");
+  // No tag, empty tag or unterminated tag: whole key is hashed
+  EXPECT_EQ(Router::hash_tag("plainkey"), "plainkey");
+  EXPECT_EQ(Router::hash_tag("foo{}{bar}"), "foo{}{bar}");
+  EXPECT_EQ(Router::hash_tag("foo{bar"), "foo{bar");
+  EXPECT_EQ(Router::hash_tag("foo}bar{"), "foo}bar{");
+}
+
+TEST(RouterTest, KeySlotMatchesRedisCluster) {
+  // Reference values from Redis CLUSTER KEYSLOT
+  EXPECT_EQ(Router::key_slot("123456789"), 12739);
+  EXPECT_EQ(Router::key_slot("foo"), 12182);
+  EXPECT_EQ(Router::key_slot("{foo}bar"), 12182);
+  EXPECT_LT(Router::key_slot("anything"), Router::NUM_SLOTS);
+}
+
+TEST(RouterTest, TaggedKeysAreCoLocated) {
+  Router router(16);
+  for (int i = 0; i < 100; ++i) {
+    std::string tag = "{user" + std::to_string(i) + "}";
+    size_t shard = router.get_shard_id(tag + ":profile");
+    EXPECT_EQ(router.get_shard_id(tag + ":cart"), shard);
+    EXPECT_EQ(router.get_shard_id("session:" + tag), shard);
+  }
+}
+
+// --- Slot Table Tests ---
+
+TEST(RouterTest, SlotsEvenlyDistributed) {
+  Router router(6);
+  auto counts = router.slots_per_shard();
+  ASSERT_EQ(counts.size(), 6u);
+  for (size_t c : counts) {
+    EXPECT_GE(c, Router::NUM_SLOTS / 6);
+    EXPECT_LE(c, Router::NUM_SLOTS / 6 + 1);
+  }
+}
+
+TEST(RouterTest, RoutesThroughSlotTable) {
+  Router router(4);
+  uint16_t slot = Router::key_slot("somekey");
+  size_t before = router.get_shard_id("somekey");
+  size_t other = (before + 1) % 4;
+  router.assign_slot(slot, other);
+  EXPECT_EQ(router.get_slot_owner(slot), other);
+  EXPECT_EQ(router.get_shard_id("somekey"), other);
+}
+
+TEST(RouterTest, RebalanceMovesMinimalSlots) {
+  Router router(4);
+  // Growing 4 -> 5 shards: only the new shard's share should move
+  size_t moved = router.rebalance(5);
+  EXPECT_EQ(moved, Router::NUM_SLOTS / 5);
+  auto counts = router.slots_per_shard();
+  ASSERT_EQ(counts.size(), 5u);
+  for (size_t c : counts) {
+    EXPECT_GE(c, Router::NUM_SLOTS / 5);
+    EXPECT_LE(c, Router::NUM_SLOTS / 5 + 1);
+  }
+
+  // Already balanced: nothing to do
+  EXPECT_TRUE(router.plan_rebalance(5).empty());
+
+  // Shrinking 5 -> 3: retired shards hand over all of their slots
+  router.rebalance(3);
+  counts = router.slots_per_shard();
+  ASSERT_EQ(counts.size(), 3u);
+  EXPECT_EQ(counts[0] + counts[1] + counts[2], Router::NUM_SLOTS);
+}
+
+// --- Slot Migration Tests ---
+
+// Delivers all pending ITC messages of one core to its migrator
+static void pump(Topology& topology, SlotMigrator& migrator, size_t core_id) {
+  topology.get_channel(core_id)->consume_all([&](Message&& msg) {
+    if (msg.type == MessageType::MIGRATE_START) {
+      migrator.start(std::move(msg.migration->slot_moves));
+    }
+    if (msg.type == MessageType::MIGRATE_STEP) migrator.step();
+    if (msg.type == MessageType::MIGRATE_BATCH) migrator.import(std::move(msg.migration->keys));
+  });
+}
+
+TEST(SlotMigrationTest, MovesKeysAndFlipsOwnership) {
+  Topology topology(2);
+  SlotMigrator source(topology, 0);
+  SlotMigrator target(topology, 1);
+
+  // Find a few keys living on core 0, all in the same slot via a hash tag
+  std::string tag;
+  for (int i = 0; tag.empty(); ++i) {
+    std::string candidate = "{t" + std::to_string(i) + "}";
+    if (topology.get_target_core(candidate) == 0) tag = candidate;
+  }
+  for (int i = 0; i < 10; ++i) {
+    topology.get_shard(0)->set(tag + std::to_string(i), quine::storage::String("v"));
+  }
+  uint16_t slot = Router::key_slot(tag);
+
+  topology.move_slot(slot, 1);
+  EXPECT_TRUE(topology.is_rebalancing());
+  EXPECT_EQ(topology.get_router().get_migration_target(slot), 1u);
+
+  while (topology.is_rebalancing()) {
+    pump(topology, source, 0);
+    pump(topology, target, 1);
+  }
+  pump(topology, target, 1);
+
+  EXPECT_EQ(topology.get_target_core(tag), 1u);
+  EXPECT_EQ(topology.get_router().get_migration_target(slot), Router::NO_SHARD);
+  for (int i = 0; i < 10; ++i) {
+    std::string key = tag + std::to_string(i);
+    EXPECT_EQ(topology.get_shard(0)->get(key), nullptr);
+    EXPECT_NE(topology.get_shard(1)->get(key), nullptr);
+    EXPECT_TRUE(topology.is_local(1, key));
+  }
+}
+
+TEST(SlotMigrationTest, AddCoreReportsAFailedWorker) {
+  Topology topology(1, 2);
+  bool fail = true;
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  topology.set_core_launcher([&](size_t core_id) {
+    std::promise<void> started;
+    if (fail) {
+      started.set_exception(std::make_exception_ptr(std::runtime_error("no io_uring")));
+    } else {
+      topology.register_notify_fd(core_id, fds[1]);
+      started.set_value();
+    }
+    return started.get_future();
+  });
+
+  // An error reply instead of waiting forever, and no migration left held
+  EXPECT_THROW(topology.add_core(), std::runtime_error);
+  EXPECT_FALSE(topology.is_rebalancing());
+  EXPECT_EQ(topology.get_num_cores(), 1u);
+
+  fail = false;
+  EXPECT_EQ(topology.add_core(), 1u);
+  EXPECT_EQ(topology.get_num_cores(), 2u);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST(SlotMigrationTest, MoveSlotRejectsOutOfRangeArguments) {
+  Topology topology(2);
+  quine::commands::ClusterCommand cluster;
+  size_t owner = topology.get_router().get_slot_owner(5);
+  auto moveslot = [&](const std::string& slot, const std::string& core) {
+    return cluster.execute(topology, 0, 1, {"CLUSTER", "MOVESLOT", slot, core});
+  };
+  // 65541 would wrap around to slot 5 as a uint16_t
+  EXPECT_EQ(moveslot("65541", std::to_string(1 - owner)), "-ERR invalid slot or core\r\n");
+  EXPECT_EQ(moveslot(std::to_string(Router::NUM_SLOTS), "1"), "-ERR invalid slot or core\r\n");
+  EXPECT_EQ(moveslot("5", "2"), "-ERR invalid slot or core\r\n");
+  EXPECT_EQ(moveslot("-1", "1"), "-ERR invalid slot or core\r\n");
+  EXPECT_EQ(topology.get_router().get_slot_owner(5), owner);
+  EXPECT_FALSE(topology.is_rebalancing());
+}
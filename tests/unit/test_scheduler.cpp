@@ -0,0 +1,272 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "commands/hash_commands.hpp"
+#include "commands/list_commands.hpp"
+#include "commands/set_commands.hpp"
+#include "commands/zset_commands.hpp"
+#include "core/scheduler.hpp"
+#include "core/topology.hpp"
+
+using namespace quine;
+using core::Job;
+using core::Scheduler;
+using core::Topology;
+
+// Counts to `limit`, one number per resume()
+class CountJob : public Job {
+ public:
+  explicit CountJob(int limit) : limit_(limit) {}
+  bool resume(std::string& out, Clock::time_point) override {
+    out += std::to_string(++count_);
+    return count_ == limit_;
+  }
+
+ private:
+  int limit_;
+  int count_ = 0;
+};
+
+struct Collected {
+  std::string reply;
+  size_t parts = 0;
+  bool last = false;
+};
+
+// Run every job to completion with the smallest budget: one chunk per slice
+static Collected run_all(Scheduler& scheduler) {
+  Collected result;
+  scheduler.set_sink([&](const Scheduler::Target&, std::string_view part, bool last) {
+    result.reply.append(part);
+    result.parts++;
+    result.last = last;
+    return true;
+  });
+  while (scheduler.run(std::chrono::microseconds(0))) {
+  }
+  return result;
+}
+
+TEST(SchedulerTest, RoundRobinAndCancel) {
+  Scheduler scheduler;
+  scheduler.add({0, 1, 0}, std::make_unique<CountJob>(3));
+  scheduler.add({0, 2, 0}, std::make_unique<CountJob>(2));
+  scheduler.add({0, 3, 0}, std::make_unique<CountJob>(100));
+  EXPECT_EQ(scheduler.size(), 3u);
+
+  std::string order;
+  scheduler.set_sink([&](const Scheduler::Target& target, std::string_view part, bool last) {
+    order += std::to_string(target.conn_id) + ":" + std::string(part) + (last ? "! " : " ");
+    return target.conn_id != 3;  // Client 3 disconnected
+  });
+  EXPECT_TRUE(scheduler.run());
+  EXPECT_TRUE(scheduler.run());
+  EXPECT_FALSE(scheduler.run());
+  EXPECT_EQ(order, "1:1 2:1 3:1 1:2 2:2! 1:3! ");
+  EXPECT_FALSE(scheduler.active());
+}
+
+TEST(SchedulerTest, DeferredRequestKeepsItsTarget) {
+  Topology topology(1);
+  topology.begin_request(0, {3, 42, false});
+  EXPECT_EQ(topology.defer(0, 7, std::make_unique<CountJob>(1)), "");
+  EXPECT_EQ(topology.end_request(0), 0u);
+
+  Scheduler::Target seen{};
+  topology.get_scheduler(0).set_sink([&](const Scheduler::Target& target, std::string_view, bool) {
+    seen = target;
+    return true;
+  });
+  topology.get_scheduler(0).run();
+  EXPECT_EQ(seen.origin_core_id, 3u);
+  EXPECT_EQ(seen.conn_id, 7u);
+  EXPECT_EQ(seen.seq, 42u);
+}
+
+TEST(SchedulerTest, StreamsLargeSetReply) {
+  Topology topology(1);
+  commands::SAddCommand sadd;
+  commands::SMembersCommand smembers;
+  std::vector<std::string> add = {"SADD", "s"};
+  for (int i = 0; i < 3000; ++i) add.push_back("m" + std::to_string(i));
+  sadd.execute(topology, 0, 1, add);
+
+  // Small sets still reply inline
+  sadd.execute(topology, 0, 1, {"SADD", "small", "a"});
+  EXPECT_EQ(smembers.execute(topology, 0, 1, {"SMEMBERS", "small"}), "*1\r\n$1\r\na\r\n");
+
+  EXPECT_EQ(smembers.execute(topology, 0, 1, {"SMEMBERS", "s"}), "");
+  Collected result = run_all(topology.get_scheduler(0));
+  EXPECT_GT(result.parts, 10u);
+  EXPECT_TRUE(result.last);
+
+  std::string expected = "*3000\r\n";
+  for (const auto& member : *topology.get_shard(0)->get("s")->get_if<storage::Set>()) {
+    commands::append_bulk(expected, member);
+  }
+  EXPECT_EQ(result.reply, expected);
+}
+
+TEST(SchedulerTest, StreamsListHashAndZSetReplies) {
+  Topology topology(1);
+  storage::Shard* shard = topology.get_shard(0);
+  storage::List list{shard->allocator()};
+  storage::Hash hash{shard->allocator()};
+  storage::ZSet zset{shard->allocator()};
+  for (int i = 0; i < 2000; ++i) {
+    list.emplace_back(std::to_string(i));
+    hash.emplace(std::to_string(i), "v");
+    zset.insert(i * 0.5, "z" + std::to_string(i));
+  }
+  shard->set("l", storage::Value(std::move(list)));
+  shard->set("h", storage::Value(std::move(hash)));
+  shard->set("z", storage::Value(std::move(zset)));
+
+  commands::LRangeCommand lrange;
+  EXPECT_EQ(lrange.execute(topology, 0, 1, {"LRANGE", "l", "10", "-1"}), "");
+  std::string reply = run_all(topology.get_scheduler(0)).reply;
+  EXPECT_EQ(reply.substr(0, 16), "*1990\r\n$2\r\n10\r\n$");
+  EXPECT_EQ(reply.substr(reply.size() - 10), "$4\r\n1999\r\n");
+
+  commands::HGetAllCommand hgetall;
+  EXPECT_EQ(hgetall.execute(topology, 0, 1, {"HGETALL", "h"}), "");
+  reply = run_all(topology.get_scheduler(0)).reply;
+  EXPECT_EQ(reply.substr(0, 22), "*4000\r\n$1\r\n0\r\n$1\r\nv\r\n$");
+  EXPECT_EQ(std::count(reply.begin(), reply.end(), '$'), 4000);
+
+  commands::ZRangeCommand zrange;
+  EXPECT_EQ(zrange.execute(topology, 0, 1, {"ZRANGE", "z", "1", "-1", "WITHSCORES"}), "");
+  reply = run_all(topology.get_scheduler(0)).reply;
+  EXPECT_EQ(reply.substr(0, 28), "*3998\r\n$2\r\nz1\r\n$3\r\n0.5\r\n$2\r\n");
+  EXPECT_EQ(reply.substr(reply.size() - 22), "$5\r\nz1999\r\n$5\r\n999.5\r\n");
+}
+
+TEST(SchedulerTest, PadsWhenCollectionShrinks) {
+  Topology topology(1);
+  commands::SAddCommand sadd;
+  commands::SMembersCommand smembers;
+  std::vector<std::string> add = {"SADD", "s"};
+  for (int i = 0; i < 2000; ++i) add.push_back("m" + std::to_string(i));
+  sadd.execute(topology, 0, 1, add);
+
+  EXPECT_EQ(smembers.execute(topology, 0, 1, {"SMEMBERS", "s"}), "");
+  Scheduler& scheduler = topology.get_scheduler(0);
+  std::string reply;
+  scheduler.set_sink([&](const Scheduler::Target&, std::string_view part, bool) {
+    reply.append(part);
+    return true;
+  });
+  EXPECT_TRUE(scheduler.run(std::chrono::microseconds(0)));
+  size_t sent = std::count(reply.begin(), reply.end(), '$');
+  EXPECT_GT(sent, 0u);
+  topology.get_shard(0)->del("s");
+  EXPECT_FALSE(scheduler.run(std::chrono::microseconds(0)));
+
+  // The announced 2000 elements, those not sent before the delete as nils
+  EXPECT_EQ(std::count(reply.begin(), reply.end(), '$'), 2000);
+  EXPECT_EQ(reply.substr(reply.size() - 5), "$-1\r\n");
+  size_t nils = 0;
+  for (size_t pos = 0; (pos = reply.find("$-1\r\n", pos)) != std::string::npos; ++pos) nils++;
+  EXPECT_EQ(nils, 2000 - sent);
+}
+
+TEST(SchedulerTest, PadsWholePairsWhenHashShrinks) {
+  Topology topology(1);
+  storage::Shard* shard = topology.get_shard(0);
+  for (const char* key : {"shrunk", "deleted"}) {
+    storage::Hash hash{shard->allocator()};
+    for (int i = 0; i < 2000; ++i) hash.emplace("f" + std::to_string(i), "v");
+    shard->set(key, storage::Value(std::move(hash)));
+  }
+
+  commands::HGetAllCommand hgetall;
+  Scheduler& scheduler = topology.get_scheduler(0);
+  std::string reply;
+  scheduler.set_sink([&](const Scheduler::Target&, std::string_view part, bool) {
+    reply.append(part);
+    return true;
+  });
+  for (const char* key : {"shrunk", "deleted"}) {
+    reply.clear();
+    EXPECT_EQ(hgetall.execute(topology, 0, 1, {"HGETALL", key}), "");
+    EXPECT_TRUE(scheduler.run(std::chrono::microseconds(0)));
+    if (std::string(key) == "shrunk") {
+      shard->get(key)->get_if<storage::Hash>()->clear();
+    } else {
+      shard->del(key);
+    }
+    while (scheduler.run(std::chrono::microseconds(0))) {
+    }
+
+    // Still 4000 elements, of which no field is nil: padded pairs are an
+    // empty field and a nil value
+    ASSERT_EQ(reply.substr(0, 7), "*4000\r\n");
+    size_t pos = 7, elements = 0, padded = 0;
+    while (pos < reply.size()) {
+      size_t end = reply.find("\r\n", pos);
+      long len = std::stol(reply.substr(pos + 1, end - pos - 1));
+      bool field = elements % 2 == 0;
+      EXPECT_TRUE(len >= 0 || !field) << key << " element " << elements;
+      if (field && len == 0) padded++;
+      pos = end + 2 + (len >= 0 ? len + 2 : 0);
+      elements++;
+    }
+    EXPECT_EQ(elements, 4000u) << key;
+    EXPECT_GT(padded, 0u) << key;
+    EXPECT_EQ(reply.substr(reply.size() - 11), "$0\r\n\r\n$-1\r\n") << key;
+  }
+}
+
+TEST(SchedulerTest, JobsWaitForTheirClient) {
+  Scheduler scheduler;
+  scheduler.add({0, 1, 0}, std::make_unique<CountJob>(3));
+  scheduler.add({0, 2, 0}, std::make_unique<CountJob>(2));
+
+  std::string order;
+  scheduler.set_sink([&](const Scheduler::Target& target, std::string_view part, bool) {
+    order += std::to_string(target.conn_id) + ":" + std::string(part) + " ";
+    return true;
+  });
+  bool client1_ready = false;
+  scheduler.set_ready([&](const Scheduler::Target& target) {
+    return target.conn_id != 1 || client1_ready;
+  });
+  EXPECT_TRUE(scheduler.run());
+  EXPECT_FALSE(scheduler.run());  // Only a waiting job left: no tick needed
+  EXPECT_TRUE(scheduler.active());
+  EXPECT_EQ(order, "2:1 2:2 ");
+
+  client1_ready = true;
+  while (scheduler.run()) {
+  }
+  EXPECT_EQ(order, "2:1 2:2 1:1 1:2 1:3 ");
+  EXPECT_FALSE(scheduler.active());
+}
+
+TEST(SchedulerTest, StreamedPartsStaySmall) {
+  Topology topology(1);
+  storage::Shard* shard = topology.get_shard(0);
+  storage::List list{shard->allocator()};
+  for (int i = 0; i < 2000; ++i) list.emplace_back(std::string(1000, 'a'));
+  shard->set("l", storage::Value(std::move(list)));
+
+  commands::LRangeCommand lrange;
+  EXPECT_EQ(lrange.execute(topology, 0, 1, {"LRANGE", "l", "0", "-1"}), "");
+  Scheduler& scheduler = topology.get_scheduler(0);
+  size_t total = 0;
+  size_t largest = 0;
+  scheduler.set_sink([&](const Scheduler::Target&, std::string_view part, bool) {
+    total += part.size();
+    largest = std::max(largest, part.size());
+    return true;
+  });
+  // A generous budget: the size bound ends each slice, not the clock
+  while (scheduler.run(std::chrono::seconds(1))) {
+  }
+  EXPECT_EQ(total, 7 + 2000 * 1009);  // "*2000\r\n", then "$1000\r\n...\r\n" each
+  EXPECT_LE(largest, commands::ArrayReplyJob::PART_BYTES + 2 * 1009);  // A pair over at most
+}
@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <memory_resource>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "core/topology.hpp"
+#include "storage/shard.hpp"
+#include "storage/slab_resource.hpp"
+
+using quine::storage::SlabResource;
+
+TEST(SlabResourceTest, SizeClasses) {
+  EXPECT_EQ(SlabResource::class_size(1), 16u);
+  EXPECT_EQ(SlabResource::class_size(16), 16u);
+  EXPECT_EQ(SlabResource::class_size(17), 32u);
+  EXPECT_EQ(SlabResource::class_size(128), 128u);
+  EXPECT_EQ(SlabResource::class_size(129), 192u);
+  EXPECT_EQ(SlabResource::class_size(512), 512u);
+  EXPECT_EQ(SlabResource::class_size(513), 640u);
+  EXPECT_EQ(SlabResource::class_size(SlabResource::MAX_SMALL), SlabResource::MAX_SMALL);
+  EXPECT_EQ(SlabResource::class_size(SlabResource::MAX_SMALL + 1), 0u);
+}
+
+TEST(SlabResourceTest, AccountsAndReusesBlocks) {
+  SlabResource slab;
+  void* a = slab.allocate(20);
+  EXPECT_EQ(slab.used_bytes(), 32u);
+  EXPECT_EQ(slab.allocated_bytes(), SlabResource::SLAB_SIZE);
+
+  slab.deallocate(a, 20);
+  EXPECT_EQ(slab.used_bytes(), 0u);
+
+  // Same class: the freed block comes straight back
+  void* b = slab.allocate(30);
+  EXPECT_EQ(a, b);
+  slab.deallocate(b, 30);
+  EXPECT_EQ(slab.allocated_bytes(), SlabResource::SLAB_SIZE);
+}
+
+TEST(SlabResourceTest, BlocksDoNotOverlap) {
+  SlabResource slab;
+  std::set<char*> blocks;
+  // More than one slab's worth of a single class
+  size_t count = SlabResource::SLAB_SIZE / 64 + 10;
+  for (size_t i = 0; i < count; ++i) {
+    auto* p = static_cast<char*>(slab.allocate(64));
+    std::memset(p, static_cast<int>(i), 64);
+    EXPECT_TRUE(blocks.insert(p).second);
+  }
+  EXPECT_EQ(slab.used_bytes(), count * 64);
+  EXPECT_EQ(slab.allocated_bytes(), 2 * SlabResource::SLAB_SIZE);
+  for (char* p : blocks) slab.deallocate(p, 64);
+  EXPECT_EQ(slab.used_bytes(), 0u);
+}
+
+TEST(SlabResourceTest, DrainsSparseSlabs) {
+  SlabResource slab;
+  // Two slabs of 64-byte blocks, then free all but one block of the first
+  std::vector<void*> blocks;
+  size_t per_slab = (SlabResource::SLAB_SIZE - 16) / 64;
+  for (size_t i = 0; i < 2 * per_slab; ++i) blocks.push_back(slab.allocate(64));
+  ASSERT_EQ(slab.slab_count(), 2u);
+  for (size_t i = 1; i < per_slab; ++i) slab.deallocate(blocks[i], 64);
+
+  ASSERT_EQ(slab.begin_drain(0.5), 1u);
+  EXPECT_TRUE(slab.should_move(blocks[0]));
+  EXPECT_FALSE(slab.should_move(blocks[per_slab]));
+  EXPECT_FALSE(slab.should_move(&slab));
+
+  // New blocks never come from the draining slab
+  void* fresh = slab.allocate(64);
+  EXPECT_FALSE(slab.should_move(fresh));
+
+  // Its last block gone, the slab goes back upstream
+  slab.deallocate(blocks[0], 64);
+  EXPECT_EQ(slab.draining(), 0u);
+  EXPECT_EQ(slab.slab_count(), 2u);  // The full one plus the fresh one
+  slab.end_drain();
+
+  slab.deallocate(fresh, 64);
+  for (size_t i = per_slab; i < 2 * per_slab; ++i) slab.deallocate(blocks[i], 64);
+  EXPECT_EQ(slab.used_bytes(), 0u);
+}
+
+TEST(SlabResourceTest, EndDrainServesRemainingBlocks) {
+  SlabResource slab;
+  std::vector<void*> blocks;
+  size_t per_slab = (SlabResource::SLAB_SIZE - 16) / 32;
+  for (size_t i = 0; i < 2 * per_slab; ++i) blocks.push_back(slab.allocate(32));
+  for (size_t i = 1; i < per_slab; ++i) slab.deallocate(blocks[i], 32);
+  ASSERT_EQ(slab.begin_drain(0.5), 1u);
+  slab.end_drain();
+
+  // The sparse slab's free blocks are usable again: no new slab needed
+  std::vector<void*> again;
+  for (size_t i = 1; i < per_slab; ++i) again.push_back(slab.allocate(32));
+  EXPECT_EQ(slab.slab_count(), 2u);
+  for (void* p : again) slab.deallocate(p, 32);
+  slab.deallocate(blocks[0], 32);
+  for (size_t i = per_slab; i < 2 * per_slab; ++i) slab.deallocate(blocks[i], 32);
+  EXPECT_EQ(slab.used_bytes(), 0u);
+}
+
+TEST(SlabResourceTest, LargeAllocationsGoUpstream) {
+  SlabResource slab;
+  size_t bytes = SlabResource::MAX_SMALL * 4;
+  void* p = slab.allocate(bytes);
+  EXPECT_EQ(slab.used_bytes(), bytes);
+  EXPECT_EQ(slab.allocated_bytes(), bytes);
+  slab.deallocate(p, bytes);
+  EXPECT_EQ(slab.used_bytes(), 0u);
+  EXPECT_EQ(slab.allocated_bytes(), 0u);
+}
+
+TEST(SlabResourceTest, ShardValuesLiveInShardMemory) {
+  quine::storage::Shard shard;
+  size_t baseline = shard.memory().used_bytes();
+
+  // A value built elsewhere is moved into the shard's slab on insert
+  std::string payload(200, 'x');
+  shard.set("key", quine::storage::String(payload));
+  EXPECT_GT(shard.memory().used_bytes(), baseline + payload.size());
+
+  auto* val = shard.get("key");
+  ASSERT_NE(val, nullptr);
+  EXPECT_EQ(val->resource(), &shard.memory());
+
+  shard.del("key");
+  EXPECT_EQ(shard.memory().used_bytes(), baseline);
+}
+
+TEST(SlabResourceTest, MaxmemoryUsesPublishedTotals) {
+  quine::core::Topology topology(2);
+  topology.set_maxmemory(64 * 1024);
+  topology.get_shard(1)->set("key", quine::storage::String(std::string(100 * 1024, 'x')));
+  EXPECT_FALSE(topology.over_maxmemory());  // Not published yet
+  topology.flush(1);
+  EXPECT_TRUE(topology.over_maxmemory());
+  topology.get_shard(1)->del("key");
+  topology.flush(1);
+  EXPECT_FALSE(topology.over_maxmemory());
+}
+
+TEST(SlabResourceTest, ShardsOfLateCoresArePublished) {
+  using quine::core::Topology;
+  Topology topology(1, 2, Topology::ShardAllocation::BY_WORKER);
+  EXPECT_EQ(topology.get_shard(1), nullptr);
+  std::thread worker([&] { topology.init_shard(1); });  // As CLUSTER ADDCORE does
+  worker.join();
+  ASSERT_NE(topology.get_shard(1), nullptr);
+  EXPECT_EQ(topology.used_memory(), topology.get_shard(1)->memory().used_bytes());
+}
@@ -0,0 +1,317 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "commands/string_commands.hpp"
+#include "core/io_context.hpp"
+#include "core/task.hpp"
+#include "core/topology.hpp"
+
+using namespace quine;
+using core::Call;
+using core::Message;
+using core::MessageType;
+using core::Task;
+using core::Topology;
+
+static Task<int> add(int a, int b) {
+  co_return a + b;
+}
+
+static Task<int> add_twice(int a, int b) {
+  int first = co_await add(a, b);
+  int second = co_await add(first, b);
+  co_return second;
+}
+
+static Task<int> fail() {
+  throw std::runtime_error("boom");
+  co_return 0;
+}
+
+TEST(TaskTest, ChainsAndPropagatesResults) {
+  int result = 0;
+  std::string error;
+  auto driver = [&]() -> Task<> {
+    result = co_await add_twice(1, 2);
+    try {
+      co_await fail();
+    } catch (const std::runtime_error& e) {
+      error = e.what();
+    }
+  };
+  driver().detach();
+  EXPECT_EQ(result, 5);
+  EXPECT_EQ(error, "boom");
+}
+
+TEST(TaskTest, LazyUntilAwaitedOrDetached) {
+  bool ran = false;
+  auto body = [&]() -> Task<> {
+    ran = true;
+    co_return;
+  };
+  {
+    Task<> task = body();
+    EXPECT_FALSE(ran);
+  }  // Destroyed without running
+  EXPECT_FALSE(ran);
+  body().detach();
+  EXPECT_TRUE(ran);
+}
+
+TEST(TaskTest, FramesAreRecycled) {
+  auto& pool = core::FramePool::local();
+  for (int i = 0; i < 10; ++i) add_twice(i, i).detach();
+  size_t allocated = pool.allocated();
+  for (int i = 0; i < 10000; ++i) add_twice(i, i).detach();
+  EXPECT_EQ(pool.allocated(), allocated);
+}
+
+TEST(TaskTest, IoAwaitersResumeOnCompletion) {
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  core::IoContext ctx(64);
+
+  std::string received;
+  auto echo = [&]() -> Task<> {
+    const char ping[] = "ping";
+    int written = co_await core::async_write(ctx, fds[1], ping, 4);
+    char buf[8] = {};
+    int n = co_await core::async_read(ctx, fds[0], buf, sizeof(buf));
+    if (written == 4 && n > 0) received.assign(buf, n);
+    ctx.stop();
+  };
+  echo().detach();
+  ctx.run();
+
+  EXPECT_EQ(received, "ping");
+  close(fds[0]);
+  close(fds[1]);
+}
+
+// A key owned by `core_id`
+static std::string key_on(Topology& topology, size_t core_id) {
+  for (int i = 0;; ++i) {
+    std::string key = "key" + std::to_string(i);
+    if (topology.get_target_core(key) == core_id) return key;
+  }
+}
+
+// Deliver messages between cores until none are left, the way the workers
+// do: requests run their command, replies to calls resume the coroutine.
+// Replies to client connections are appended to `client`.
+static void pump(Topology& topology, std::string& client) {
+  commands::GetCommand get;
+  std::vector<std::string> args;
+  bool delivered = true;
+  while (delivered) {
+    delivered = false;
+    for (size_t core_id = 0; core_id < topology.core_count(); ++core_id) {
+      topology.flush(core_id);
+    }
+    for (size_t core_id = 0; core_id < topology.core_count(); ++core_id) {
+      std::function<void(Message&&)> handle = [&](Message&& msg) {
+        delivered = true;
+        if (msg.type == MessageType::BATCH) {
+          for (auto& item : msg.batch) handle(std::move(item));
+        } else if (msg.type == MessageType::REQUEST) {
+          core::decode_args(msg.payload, args);
+          topology.request_received(core_id);
+          ASSERT_EQ(args[0], "GET");
+          topology.begin_request(core_id, {msg.origin_core_id, msg.seq, msg.asking});
+          std::string reply = get.execute(topology, core_id, msg.conn_id, args);
+          topology.end_request(core_id);
+          if (!reply.empty()) topology.respond(core_id, msg, reply);
+        } else if (msg.conn_id == Topology::CALL_CONN_ID) {
+          topology.complete_call(core_id, msg.seq, msg.payload.view(), !msg.partial);
+        } else {
+          client.append(msg.payload.view());
+        }
+      };
+      topology.get_channel(core_id)->consume_all(handle);
+    }
+  }
+}
+
+TEST(TaskTest, CallResumesWithRemoteReply) {
+  Topology topology(2);
+  std::string key = key_on(topology, 1);
+  topology.get_shard(1)->set(key, storage::String("remote"));
+
+  std::string reply;
+  auto fetch = [&]() -> Task<> {
+    Call call(topology, 0, {"GET", key});
+    reply = co_await call;
+  };
+  fetch().detach();
+  EXPECT_EQ(reply, "");  // Waiting for core 1
+
+  std::string client;
+  pump(topology, client);
+  EXPECT_EQ(reply, "$6\r\nremote\r\n");
+  EXPECT_EQ(client, "");
+
+  // A call dropped before its reply arrives is forgotten
+  {
+    Call call(topology, 0, {"GET", key});
+  }
+  pump(topology, client);
+  EXPECT_EQ(client, "");
+}
+
+TEST(TaskTest, MGetGathersKeysFromAllCores) {
+  Topology topology(2);
+  std::string local = key_on(topology, 0);
+  std::string remote = key_on(topology, 1);
+  topology.get_shard(0)->set(local, storage::String("a"));
+  topology.get_shard(1)->set(remote, storage::String("b"));
+
+  std::string reply;
+  topology.get_scheduler(0).set_sink([&](const core::Scheduler::Target& target,
+                                         std::string_view part, bool last) {
+    EXPECT_EQ(target.conn_id, 7u);
+    EXPECT_TRUE(last);
+    reply.append(part);
+    return true;
+  });
+
+  commands::MGetCommand mget;
+  std::vector<std::string> local_only = {"MGET", local, local};
+  EXPECT_EQ(mget.execute(topology, 0, 7, local_only), "*2\r\n$1\r\na\r\n$1\r\na\r\n");
+
+  std::vector<std::string> mixed = {"MGET", remote, local, "missing", remote};
+  EXPECT_EQ(mget.execute(topology, 0, 7, mixed), "");
+  std::string client;
+  pump(topology, client);
+  EXPECT_EQ(reply, "*4\r\n$1\r\nb\r\n$1\r\na\r\n$-1\r\n$1\r\nb\r\n");
+}
+
+TEST(TaskTest, IoCoresForwardToDataCores) {
+  // Split topology: data cores 0 and 1, I/O core 2
+  Topology topology(2, 0, Topology::ShardAllocation::EAGER, 1);
+  EXPECT_EQ(topology.core_count(), 3u);
+  EXPECT_EQ(topology.shard_count(), 2u);
+  EXPECT_TRUE(topology.is_io_core(2));
+  EXPECT_FALSE(topology.is_io_core(1));
+  EXPECT_TRUE(topology.serves_clients(2));
+  EXPECT_FALSE(topology.serves_clients(0));
+
+  std::string a = key_on(topology, 0);
+  std::string b = key_on(topology, 1);
+  topology.get_shard(0)->set(a, storage::String("a"));
+  topology.get_shard(1)->set(b, storage::String("b"));
+
+  // Nothing is local to an I/O core: single-key commands are forwarded...
+  commands::GetCommand get;
+  std::vector<std::string> args = {"GET", b};
+  topology.begin_request(2, {2, 1, false});
+  EXPECT_EQ(get.execute(topology, 2, 7, args), "");
+  EXPECT_EQ(topology.end_request(2), 1u);
+  std::string client;
+  pump(topology, client);
+  EXPECT_EQ(client, "$1\r\nb\r\n");
+
+  // ...and multi-key ones gather every key from the data cores
+  std::string reply;
+  topology.get_scheduler(2).set_sink([&](const core::Scheduler::Target& target,
+                                         std::string_view part, bool last) {
+    EXPECT_EQ(target.origin_core_id, 2u);
+    EXPECT_TRUE(last);
+    reply.append(part);
+    return true;
+  });
+  commands::MGetCommand mget;
+  std::vector<std::string> keys = {"MGET", a, b};
+  EXPECT_EQ(mget.execute(topology, 2, 7, keys), "");
+  pump(topology, client);
+  EXPECT_EQ(reply, "*2\r\n$1\r\na\r\n$1\r\nb\r\n");
+}
+
+TEST(TaskTest, OverloadedCoresShedNewRequests) {
+  Topology topology(2);
+  core::AdmissionLimits limits;
+  limits.max_queued_requests = 2;
+  topology.set_admission_limits(limits);
+  std::string b = key_on(topology, 1);
+  topology.get_shard(1)->set(b, storage::String("b"));
+
+  commands::GetCommand get;
+  std::vector<std::string> args = {"GET", b};
+  auto run = [&](size_t core_id, size_t origin_core_id, const std::vector<std::string>& args) {
+    topology.begin_request(core_id, {origin_core_id, 1, false});
+    std::string reply = get.execute(topology, core_id, 7, args);
+    topology.end_request(core_id);
+    return reply;
+  };
+  // Requests of this tick count before they are flushed
+  EXPECT_EQ(run(0, 0, args), "");
+  EXPECT_EQ(run(0, 0, args), "");
+  EXPECT_EQ(run(0, 0, args).rfind("-BUSY", 0), 0u);
+  topology.flush(0);
+  EXPECT_EQ(topology.queued_requests(1), 2u);
+
+  // Core 1 is behind: refused on the spot, nothing more is queued for it
+  EXPECT_EQ(run(0, 0, args).rfind("-BUSY", 0), 0u);
+  topology.flush(0);
+  EXPECT_EQ(topology.queued_requests(1), 2u);
+  EXPECT_EQ(topology.shed_requests(0), 2u);
+
+  // A request already admitted elsewhere (forwarded again) is not shed
+  EXPECT_EQ(run(0, 1, {"GET", b}), "");
+  EXPECT_EQ(topology.shed_requests(0), 2u);
+
+  // Once core 1 caught up, it takes requests again
+  std::string client;
+  pump(topology, client);
+  EXPECT_EQ(topology.queued_requests(1), 0u);
+  EXPECT_EQ(client, "$1\r\nb\r\n$1\r\nb\r\n$1\r\nb\r\n");
+  EXPECT_EQ(run(0, 0, args), "");
+  EXPECT_FALSE(topology.overloaded(0));
+}
+
+TEST(TaskTest, CallsToOverloadedCoresAreShed) {
+  Topology topology(2);
+  core::AdmissionLimits limits;
+  limits.max_queued_requests = 1;
+  topology.set_admission_limits(limits);
+  std::string a = key_on(topology, 0);
+  std::string b = key_on(topology, 1);
+  topology.get_shard(0)->set(a, storage::String("a"));
+  topology.get_shard(1)->set(b, storage::String("b"));
+
+  std::string reply;
+  topology.get_scheduler(0).set_sink([&](const core::Scheduler::Target&, std::string_view part,
+                                         bool last) {
+    EXPECT_TRUE(last);
+    reply.append(part);
+    return true;
+  });
+
+  // One call already fills core 1's queue: the next one completes at once
+  core::CallState first;
+  topology.send_call(0, {"GET", b}, &first);
+  EXPECT_FALSE(first.done);
+  {
+    Call call(topology, 0, {"GET", b});
+    EXPECT_TRUE(call.await_ready());
+  }
+  EXPECT_EQ(topology.shed_requests(0), 1u);
+
+  // MGET answers -BUSY rather than a null for the remote key
+  commands::MGetCommand mget;
+  std::vector<std::string> keys = {"MGET", a, b};
+  EXPECT_EQ(mget.execute(topology, 0, 7, keys), "");
+  EXPECT_EQ(reply.rfind("-BUSY core 1", 0), 0u);
+  EXPECT_EQ(topology.shed_requests(0), 2u);
+
+  // The admitted call still gets its reply
+  std::string client;
+  pump(topology, client);
+  EXPECT_TRUE(first.done);
+  EXPECT_EQ(first.reply, "$1\r\nb\r\n");
+}
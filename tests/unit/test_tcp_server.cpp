@@ -0,0 +1,215 @@
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "commands/registry.hpp"
+#include "commands/string_commands.hpp"
+#include "core/io_context.hpp"
+#include "core/topology.hpp"
+#include "network/tcp_server.hpp"
+
+using namespace quine;
+
+// One core serving a Unix socket; the loop stops when a client leaves
+class TcpServerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    signal(SIGPIPE, SIG_IGN);  // As the server does: disconnects fail writes with EPIPE
+    commands::CommandRegistry::instance().register_command(
+        std::make_unique<commands::GetCommand>());
+    topology_.get_shard(0)->set("big", storage::String(std::string(VALUE_SIZE, 'x')));
+  }
+
+  // Serve `client` (run on its own thread) until it disconnects
+  void serve(const network::ClientLimits& limits, std::function<void(int fd)> client) {
+    network::TcpServer server(ctx_, path_, 0, topology_, 0);
+    server.set_client_limits(&limits);
+    server.set_on_disconnect([&](uint32_t) { ctx_.stop(); });
+    server.start();
+    std::thread thread([&] {
+      int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+      sockaddr_un addr{};
+      addr.sun_family = AF_UNIX;
+      std::strncpy(addr.sun_path, path_.c_str(), sizeof(addr.sun_path) - 1);
+      ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+      client(fd);
+      close(fd);
+    });
+    ctx_.schedule(std::chrono::seconds(10), [&] { ctx_.stop(); });  // Safety net
+    ctx_.run();
+    thread.join();
+  }
+
+  static void send_gets(int fd, int count) {
+    std::string pipeline;
+    for (int i = 0; i < count; ++i) pipeline += "*2\r\n$3\r\nGET\r\n$3\r\nbig\r\n";
+    ASSERT_EQ(write(fd, pipeline.data(), pipeline.size()), static_cast<ssize_t>(pipeline.size()));
+  }
+
+  // Everything the server sends until it closes the connection
+  static size_t read_all(int fd) {
+    size_t total = 0;
+    char buf[65536];
+    for (ssize_t n; (n = read(fd, buf, sizeof(buf))) > 0;) total += n;
+    return total;
+  }
+
+  static constexpr size_t VALUE_SIZE = 64 * 1024;
+  static constexpr size_t REPLY_SIZE = VALUE_SIZE + 10;  // "$65536\r\n" ... "\r\n"
+
+  std::string path_ = "/tmp/quine_test_" + std::to_string(getpid()) + ".sock";
+  core::Topology topology_{1};
+  core::IoContext ctx_{64};
+};
+
+TEST_F(TcpServerTest, ServesClientsOverUnixSocket) {
+  network::TcpServer server(ctx_, path_, 0600, topology_, 0);
+  int clients = 0;
+  server.set_on_connect([&](network::Connection*) { clients++; });
+  server.set_on_disconnect([&](uint32_t) { ctx_.stop(); });
+  server.start();
+
+  struct stat st;
+  ASSERT_EQ(stat(path_.c_str(), &st), 0);
+  EXPECT_TRUE(S_ISSOCK(st.st_mode));
+  EXPECT_EQ(st.st_mode & 0777, 0600u);
+
+  std::string reply;
+  std::thread client([&] {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path_.c_str(), sizeof(addr.sun_path) - 1);
+    ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    const char ping[] = "*1\r\n$4\r\nPING\r\n";
+    ASSERT_EQ(write(fd, ping, sizeof(ping) - 1), static_cast<ssize_t>(sizeof(ping) - 1));
+    char buf[16];
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n > 0) reply.assign(buf, n);
+    close(fd);  // The server's disconnect stops the loop
+  });
+  ctx_.schedule(std::chrono::seconds(5), [&] { ctx_.stop(); });  // Safety net
+  ctx_.run();
+  client.join();
+
+  EXPECT_EQ(clients, 1);
+  EXPECT_EQ(reply, "+PONG\r\n");
+  server.stop();
+}
+
+TEST_F(TcpServerTest, SocketFileGoesWithTheListener) {
+  {
+    network::TcpServer server(ctx_, path_, 0, topology_, 0);
+    server.start();
+    EXPECT_EQ(access(path_.c_str(), F_OK), 0);
+  }
+  EXPECT_NE(access(path_.c_str(), F_OK), 0);
+}
+
+TEST_F(TcpServerTest, HardOutputLimitDisconnects) {
+  network::ClientLimits limits;
+  limits.output_hard = 256 * 1024;
+  limits.read_pause_bytes = 0;  // Let the output pile up
+  size_t received = 0;
+  serve(limits, [&](int fd) {
+    send_gets(fd, 64);  // 4 MiB of replies, not read in time
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    received = read_all(fd);
+  });
+  EXPECT_LT(received, 64 * REPLY_SIZE);
+  EXPECT_EQ(topology_.output_limit_disconnects(), 1u);
+}
+
+TEST_F(TcpServerTest, SoftOutputLimitAllowsAGracePeriod) {
+  network::ClientLimits limits;
+  limits.output_soft = 256 * 1024;
+  limits.output_soft_for = std::chrono::seconds(1);
+  limits.read_pause_bytes = 0;
+  size_t received = 0;
+  auto start = std::chrono::steady_clock::now();
+  serve(limits, [&](int fd) {
+    send_gets(fd, 64);
+    // Over the soft limit while stalled: disconnected after the grace period
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+    received = read_all(fd);
+  });
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+  EXPECT_LT(received, 64 * REPLY_SIZE);
+  EXPECT_EQ(topology_.output_limit_disconnects(), 1u);
+}
+
+TEST_F(TcpServerTest, ReadingPausesUntilRepliesAreConsumed) {
+  network::ClientLimits limits;
+  limits.read_pause_bytes = 256 * 1024;
+  size_t received = 0;
+  serve(limits, [&](int fd) {
+    send_gets(fd, 64);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    send_gets(fd, 64);  // Read by the server only once the client catches up
+    size_t expected = 128 * REPLY_SIZE;
+    char buf[65536];
+    while (received < expected) {
+      ssize_t n = read(fd, buf, sizeof(buf));
+      if (n <= 0) break;
+      received += n;
+    }
+  });
+  EXPECT_EQ(received, 128 * REPLY_SIZE);  // Slowed down, not dropped
+  EXPECT_GE(topology_.read_pauses(), 1u);
+  EXPECT_EQ(topology_.output_limit_disconnects(), 0u);
+}
+
+TEST_F(TcpServerTest, LargeValuesAreSentByReference) {
+  commands::CommandRegistry::instance().register_command(
+      std::make_unique<commands::SetCommand>());
+  // Over TCP, where they go out with zero-copy sends
+  int port = 20000 + getpid() % 20000;
+  network::TcpServer server(ctx_, port, topology_, 0);
+  server.set_on_disconnect([&](uint32_t) { ctx_.stop(); });
+  server.start();
+  const auto& memory = topology_.get_shard(0)->memory();
+  size_t used = memory.used_bytes();
+
+  std::string expected = "$" + std::to_string(VALUE_SIZE) + "\r\n" + std::string(VALUE_SIZE, 'x') +
+                         "\r\n+OK\r\n$5\r\nsmall\r\n";
+  std::string received;
+  std::thread client([&] {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    // The value is overwritten before its reply is written
+    std::string pipeline =
+        "*2\r\n$3\r\nGET\r\n$3\r\nbig\r\n*3\r\n$3\r\nSET\r\n$3\r\nbig\r\n$5\r\nsmall\r\n"
+        "*2\r\n$3\r\nGET\r\n$3\r\nbig\r\n";
+    ASSERT_EQ(write(fd, pipeline.data(), pipeline.size()), static_cast<ssize_t>(pipeline.size()));
+    char buf[65536];
+    while (received.size() < expected.size()) {
+      ssize_t n = read(fd, buf, sizeof(buf));
+      if (n <= 0) break;
+      received.append(buf, n);
+    }
+    close(fd);
+  });
+  ctx_.schedule(std::chrono::seconds(10), [&] { ctx_.stop(); });  // Safety net
+  ctx_.run();
+  client.join();
+
+  EXPECT_EQ(received, expected);
+  EXPECT_LT(memory.used_bytes(), used);  // Freed once sent
+  server.stop();
+}
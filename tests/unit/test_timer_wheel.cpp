@@ -0,0 +1,184 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <functional>
+#include <string>
+
+#include "core/io_context.hpp"
+#include "core/timer_wheel.hpp"
+
+using quine::core::TimerWheel;
+using std::chrono::milliseconds;
+
+TEST(TimerWheelTest, FiresAtOrAfterDeadline) {
+  auto t0 = TimerWheel::Clock::now();
+  TimerWheel wheel(t0);
+  std::string fired;
+  wheel.schedule(t0 + milliseconds(25), [&] { fired += "b"; });
+  wheel.schedule(t0 + milliseconds(5), [&] { fired += "a"; });
+  wheel.schedule(t0 + milliseconds(100), [&] { fired += "c"; });
+  EXPECT_EQ(wheel.size(), 3u);
+
+  EXPECT_EQ(wheel.advance(t0 + milliseconds(9)), 0u);
+  EXPECT_EQ(wheel.advance(t0 + milliseconds(10)), 1u);
+  EXPECT_EQ(wheel.advance(t0 + milliseconds(29)), 0u);  // Never early
+  EXPECT_EQ(wheel.advance(t0 + milliseconds(30)), 1u);
+  EXPECT_EQ(fired, "ab");
+  EXPECT_EQ(wheel.advance(t0 + milliseconds(500)), 1u);
+  EXPECT_EQ(fired, "abc");
+  EXPECT_TRUE(wheel.empty());
+
+  // Already due: next advance
+  wheel.schedule(t0, [&] { fired += "d"; });
+  EXPECT_EQ(wheel.advance(t0 + milliseconds(510)), 1u);
+  EXPECT_EQ(fired, "abcd");
+}
+
+TEST(TimerWheelTest, CancelAndStaleHandles) {
+  auto t0 = TimerWheel::Clock::now();
+  TimerWheel wheel(t0);
+  int fired = 0;
+  auto first = wheel.schedule(t0 + milliseconds(50), [&] { fired += 1; });
+  EXPECT_TRUE(wheel.cancel(first));
+  EXPECT_FALSE(wheel.cancel(first));
+
+  // Reuses the node of `first`: the old handle must not cancel it
+  auto second = wheel.schedule(t0 + milliseconds(50), [&] { fired += 10; });
+  EXPECT_EQ(second.index, first.index);
+  EXPECT_FALSE(wheel.cancel(first));
+  EXPECT_FALSE(wheel.cancel(TimerWheel::Handle{}));
+
+  wheel.advance(t0 + milliseconds(60));
+  EXPECT_EQ(fired, 10);
+  EXPECT_FALSE(wheel.cancel(second));  // Fired
+}
+
+TEST(TimerWheelTest, TimersBeyondOneTurn) {
+  auto t0 = TimerWheel::Clock::now();
+  TimerWheel wheel(t0);
+  auto turn = TimerWheel::TICK * TimerWheel::SLOTS;
+  int near = 0, far = 0;
+  wheel.schedule(t0 + milliseconds(10), [&] { near++; });  // Same slot as `far`
+  wheel.schedule(t0 + 2 * turn + milliseconds(10), [&] { far++; });
+
+  // Tick by tick through two turns: `far` is skipped each time its slot comes
+  auto now = t0;
+  while (now + TimerWheel::TICK < t0 + 2 * turn + milliseconds(10)) {
+    now += TimerWheel::TICK;
+    wheel.advance(now);
+  }
+  EXPECT_EQ(near, 1);
+  EXPECT_EQ(far, 0);
+  wheel.advance(t0 + 2 * turn + milliseconds(10));
+  EXPECT_EQ(far, 1);
+
+  // A long stall fires everything due in one call
+  for (int i = 0; i < 1000; ++i) wheel.schedule(now + milliseconds(i * 37), [&] { far++; });
+  EXPECT_EQ(wheel.advance(now + std::chrono::hours(1)), 1000u);
+  EXPECT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheelTest, CallbacksMayRescheduleAndCancel) {
+  auto t0 = TimerWheel::Clock::now();
+  TimerWheel wheel(t0);
+  int ticks = 0;
+  TimerWheel::Handle victim = wheel.schedule(t0 + milliseconds(40), [&] { ticks += 100; });
+  std::function<void()> periodic = [&] {
+    ticks++;
+    wheel.cancel(victim);
+    wheel.schedule(t0 + milliseconds(10) * (ticks + 1), periodic);
+  };
+  wheel.schedule(t0 + milliseconds(10), periodic);
+
+  for (int ms = 10; ms <= 50; ms += 10) wheel.advance(t0 + milliseconds(ms));
+  EXPECT_EQ(ticks, 5);
+  EXPECT_EQ(wheel.size(), 1u);
+}
+
+TEST(TimerWheelTest, IoContextRunsTimers) {
+  quine::core::IoContext ctx(64);
+  auto start = std::chrono::steady_clock::now();
+  int fired = 0;
+  auto cancelled = ctx.schedule(milliseconds(10), [&] { fired += 100; });
+  ctx.schedule(milliseconds(20), [&] { fired++; });
+  ctx.schedule(milliseconds(50), [&] {
+    fired++;
+    ctx.stop();
+  });
+  EXPECT_TRUE(ctx.cancel(cancelled));
+  EXPECT_EQ(ctx.timer_count(), 2u);
+
+  ctx.run();
+  EXPECT_EQ(fired, 2);
+  EXPECT_GE(std::chrono::steady_clock::now() - start, milliseconds(50));
+  EXPECT_EQ(ctx.timer_count(), 0u);
+}
+
+TEST(TimerWheelTest, NextExpirySkipsEmptySlots) {
+  auto t0 = TimerWheel::Clock::now();
+  TimerWheel wheel(t0);
+  auto turn = TimerWheel::TICK * TimerWheel::SLOTS;
+  EXPECT_EQ(wheel.next_expiry(), TimerWheel::Clock::time_point::max());
+
+  wheel.schedule(t0 + 2 * turn + milliseconds(30), [] {});  // Only later turns
+  EXPECT_EQ(wheel.next_expiry(), t0 + 2 * turn + milliseconds(30));
+  auto early = wheel.schedule(t0 + milliseconds(1000), [] {});
+  EXPECT_EQ(wheel.next_expiry(), t0 + milliseconds(1000));
+  wheel.schedule(t0 + turn + milliseconds(1000), [] {});  // Shares the slot, a turn later
+  wheel.schedule(t0 + milliseconds(2005), [] {});
+  EXPECT_EQ(wheel.next_expiry(), t0 + milliseconds(1000));
+  wheel.cancel(early);
+  EXPECT_EQ(wheel.next_expiry(), t0 + milliseconds(2010));  // Rounded up to its tick
+}
+
+// A timer due before the armed timeout is brought forward; the context
+// stops after 300 ms
+static void expect_early_timer_first(quine::core::IoContext& ctx) {
+  bool early_fired = false;
+  ctx.schedule(milliseconds(300), [&] { ctx.stop(); });
+  auto start = std::chrono::steady_clock::now();
+  // Scheduled on the first wakeup, once the 300 ms timeout is submitted
+  ctx.set_notification_handler([&] {
+    ctx.schedule(milliseconds(100), [&] {
+      early_fired = true;
+      EXPECT_LT(std::chrono::steady_clock::now() - start, milliseconds(200));
+    });
+  });
+  ctx.notify();
+
+  ctx.run();
+  EXPECT_TRUE(early_fired);
+  EXPECT_GE(std::chrono::steady_clock::now() - start, milliseconds(290));
+}
+
+TEST(TimerWheelTest, IoContextSleepsUntilTheNextTimer) {
+  quine::core::IoContext ctx(64);
+  expect_early_timer_first(ctx);
+  // One wakeup per timer, not one per 10 ms tick
+  EXPECT_LE(ctx.stats().sleeps.load(), 5u);
+}
+
+TEST(TimerWheelTest, ConfiguredIoContextSleepsUntilTheNextTimer) {
+  // The workers' constructor
+  quine::core::RingConfig config;
+  config.entries = 64;
+  quine::core::IoContext ctx(config);
+  expect_early_timer_first(ctx);
+  EXPECT_LE(ctx.stats().sleeps.load(), 5u);
+}
+
+#ifdef IO_URING_STUB
+TEST(TimerWheelTest, IoContextCancelsTimeoutsWithoutUpdates) {
+  // A kernel before 5.11: the armed timeout is cancelled instead of moved
+  io_uring_stub_timeout_update = false;
+  struct Restore {
+    ~Restore() {
+      io_uring_stub_timeout_update = true;
+    }
+  } restore;
+  quine::core::RingConfig config;
+  config.entries = 64;
+  quine::core::IoContext ctx(config);
+  expect_early_timer_first(ctx);
+}
+#endif
@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "storage/slab_resource.hpp"
+#include "storage/value.hpp"
+
+using namespace quine::storage;
+
+TEST(ValueTest, CompactHandle) {
+  EXPECT_EQ(sizeof(Value), 16u);
+  Value empty;
+  EXPECT_EQ(empty.type(), ValueType::NONE);
+  EXPECT_EQ(empty.resource(), nullptr);
+}
+
+TEST(ValueTest, ShortStringsAndIntegersAreInline) {
+  SlabResource memory;
+  Value small("hello", Allocator(&memory));
+  Value number(std::to_string(INT64_MIN).substr(0, 15), Allocator(&memory));
+  EXPECT_TRUE(small.is_string());
+  EXPECT_EQ(small.string(), "hello");
+  EXPECT_EQ(small.allocation(), nullptr);
+  EXPECT_EQ(number.allocation(), nullptr);
+  EXPECT_EQ(memory.used_bytes(), 0u);
+
+  Value exact(std::string(Value::INLINE_CAPACITY, 'x'), Allocator(&memory));
+  EXPECT_EQ(exact.string().size(), Value::INLINE_CAPACITY);
+  EXPECT_EQ(memory.used_bytes(), 0u);
+}
+
+TEST(ValueTest, LongStringsAreOneAllocation) {
+  SlabResource memory;
+  std::string text(100, 'y');
+  {
+    Value value(text, Allocator(&memory));
+    EXPECT_EQ(value.string(), text);
+    EXPECT_EQ(value.resource(), &memory);
+    EXPECT_NE(value.allocation(), nullptr);
+    EXPECT_EQ(memory.used_bytes(), SlabResource::class_size(100 + 16));
+  }
+  EXPECT_EQ(memory.used_bytes(), 0u);
+}
+
+TEST(ValueTest, LongStringsAreSharedByReference) {
+  SlabResource memory;
+  std::string text(Value::SHARED_MIN, 'z');
+  Value value(text, Allocator(&memory));
+  size_t used = memory.used_bytes();
+  EXPECT_GT(used, text.size());
+
+  SharedString ref = value.share();
+  ASSERT_TRUE(ref);
+  EXPECT_EQ(ref.view().data(), value.string().data());  // Not a copy
+  SharedString copy = ref;
+
+  // Overwritten or deleted: the bytes stay until the last reference goes
+  value.reset();
+  EXPECT_EQ(copy.view(), text);
+  EXPECT_EQ(memory.used_bytes(), used);
+  ref = SharedString();
+  copy = SharedString();
+  EXPECT_EQ(memory.used_bytes(), 0u);
+
+  // Shorter strings are not shared
+  EXPECT_FALSE(Value(std::string(Value::SHARED_MIN - 1, 'z')).share());
+}
+
+TEST(ValueTest, CollectionsAreBoxed) {
+  SlabResource memory;
+  {
+    List list{Allocator(&memory)};
+    list.emplace_back("a");
+    Value value(std::move(list));
+    EXPECT_EQ(value.type(), ValueType::LIST);
+    EXPECT_EQ(value.resource(), &memory);
+    ASSERT_NE(value.get_if<List>(), nullptr);
+    EXPECT_EQ(value.get_if<List>()->front(), "a");
+    EXPECT_EQ(value.get_if<Set>(), nullptr);
+    EXPECT_FALSE(value.is_string());
+  }
+  EXPECT_EQ(memory.used_bytes(), 0u);
+}
+
+TEST(ValueTest, MoveCopyAndRehome) {
+  SlabResource memory;
+  Value original(std::string(40, 'z'));
+  EXPECT_EQ(original.resource(), std::pmr::get_default_resource());
+
+  Value copy = original;
+  EXPECT_EQ(copy.string(), original.string());
+  EXPECT_NE(copy.allocation(), original.allocation());
+
+  Value moved = std::move(copy);
+  EXPECT_EQ(copy.type(), ValueType::NONE);
+  EXPECT_EQ(moved.string(), original.string());
+
+  Value homed = rehome(std::move(moved), &memory);
+  EXPECT_EQ(homed.resource(), &memory);
+  EXPECT_EQ(homed.string(), original.string());
+
+  // Already home: the same allocation is kept
+  const void* block = homed.allocation();
+  Value again = rehome(std::move(homed), &memory);
+  EXPECT_EQ(again.allocation(), block);
+
+  again.reset();
+  EXPECT_EQ(memory.used_bytes(), 0u);
+}